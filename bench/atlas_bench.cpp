@@ -0,0 +1,120 @@
+// Atlas packing: layers, efficiency and time of the skyline packer on
+// random image sizes, then a full build (composite + mips) from real images,
+// and a check that quads remapped by RemapQuadUVs sample their own image.
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "atlas.h"
+#include "render_queue.h"
+#include "bench.h"
+
+// Samples every texel center of every image through its remapped quad, as
+// the rasterizer interpolates the corners, nearest texel of level 0
+static bool CheckRemappedQuads(const std::vector<const Image *> &images, const Atlas &atlas)
+{
+	for(std::size_t i = 0; i < images.size(); ++i)
+	{
+		const Image &image = *images[i];
+		ArenaVertex corners[2] = {};
+		corners[0].uv = glm::vec2(0.0f, 0.0f);
+		corners[1].uv = glm::vec2(1.0f, 1.0f);
+		RemapQuadUVs(corners, 2, atlas.regions[i]);
+
+		const MipLevel &level = atlas.levels[atlas.regions[i].layer][0];
+		for(int y = 0; y < image.height; ++y)
+		{
+			for(int x = 0; x < image.width; ++x)
+			{
+				const float u = corners[0].uv.x + (x + 0.5f) / image.width * (corners[1].uv.x - corners[0].uv.x);
+				const float v = corners[0].uv.y + (y + 0.5f) / image.height * (corners[1].uv.y - corners[0].uv.y);
+				const unsigned char *texel = &level.rgba[(std::size_t(v * level.height) * level.width + std::size_t(u * level.width)) * 4];
+				const unsigned char *source = image.data.get() + (std::size_t(y) * image.width + x) * image.channels;
+				for(int c = 0; c < image.channels && c < 3; ++c)
+				{
+					if(texel[c] != source[image.channels >= 3 ? c : 0])
+					{
+						std::printf("remapped quad %zu samples the wrong texel at (%d, %d)\n", i, x, y);
+						return false;
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = argc > 1 ? argv[1] : "resources/images/wall.jpg";
+
+	AtlasOptions options;
+	std::printf("layers of %dx%d, %d mip levels, padding %d\n", options.size, options.size, options.mipLevels, options.padding);
+	// efficiency counts image texels, occupancy the padded cells the packer placed
+	std::printf("%8s %6s %8s %12s %12s %12s %10s\n", "images", "size", "layers", "efficiency", "occupancy", "pack (ms)", "binds");
+
+	std::mt19937 random(42);
+	for(const int maxSize : {64, 256})
+	{
+		std::uniform_int_distribution<int> extent(8, maxSize);
+		for(const int count : {100, 1000, 10000})
+		{
+			std::vector<AtlasRect> sizes(count);
+			std::size_t texels = 0, cells = 0;
+			for(auto &s : sizes)
+			{
+				s = {0, 0, extent(random), extent(random), 0};
+				texels += std::size_t(s.width) * s.height;
+				cells += std::size_t(AtlasCellExtent(s.width, options)) * AtlasCellExtent(s.height, options);
+			}
+
+			options.maxLayers = 2048;
+			int layers = 0;
+			Stopwatch watch;
+			const auto rects = PackRects(sizes, options, layers);
+			const double ms = watch.Seconds() * 1000.0;
+			DoNotOptimize(rects);
+
+			const double area = double(options.size) * options.size * layers;
+			std::printf("%8d %6d %8d %11.1f%% %11.1f%% %12.3f %4d -> %d\n", count, maxSize, layers,
+					texels / area * 100.0, cells / area * 100.0, ms, count, 1);
+		}
+	}
+
+	const Image image = LoadImage(path);
+	const std::vector<const Image *> images(64, &image);
+
+	options = AtlasOptions();
+	Stopwatch watch;
+	const Atlas atlas = BuildAtlas(images, options);
+	std::printf("\n64 x %s (%dx%d): %d layers, efficiency %.1f%%, build %.2f ms\n", path, image.width, image.height,
+			atlas.layers, atlas.efficiency * 100.0, watch.Seconds() * 1000.0);
+
+	// distinct noise images over several layers
+	std::vector<Image> noise;
+	std::uniform_int_distribution<int> extent(8, 300), byte(0, 255);
+	for(int i = 0; i < 200; ++i)
+	{
+		noise.push_back(AllocateImage(extent(random), extent(random), 1 + i % 4));
+		const Image &n = noise.back();
+		for(std::size_t b = 0; b < std::size_t(n.width) * n.height * n.channels; ++b)
+		{
+			n.data.get()[b] = (unsigned char)byte(random);
+		}
+	}
+	std::vector<const Image *> sources;
+	for(const Image &n : noise)
+	{
+		sources.push_back(&n);
+	}
+	options.size = 1024;
+	const Atlas check = BuildAtlas(sources, options);
+	if(!CheckRemappedQuads(sources, check))
+	{
+		return EXIT_FAILURE;
+	}
+	std::printf("remapped UVs of %zu images over %d layers: ok\n", sources.size(), check.layers);
+
+	return 0;
+}
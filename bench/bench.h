@@ -0,0 +1,28 @@
+#pragma once
+
+#include <chrono>
+
+// Wall clock stopwatch shared by the benchmarks
+struct Stopwatch
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	void Restart() { start = std::chrono::steady_clock::now(); }
+
+	double Seconds() const
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+};
+
+// Keeps the compiler from discarding a result we only compute for timing
+template<typename T>
+inline void DoNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "g"(&value) : "memory");
+#else
+	const void *volatile sink = &value;
+	(void)sink;
+#endif
+}
@@ -0,0 +1,343 @@
+// BVH over STL meshes: build time serial and on the pool, tree quality,
+// then ray, segment and sphere queries per second for the binary and the
+// 4-wide layouts, checked against each other and against a linear scan.
+// Runs on a generated terrain of 2 * N * N triangles (N from the command
+// line) and on any STL given after it.
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+#include "random.h"
+#include "stl.h"
+#include "thread_pool.h"
+#include "bench.h"
+
+static const std::size_t queryCount = 1 << 20;
+
+static std::vector<Triangle> MakeTerrain(int n)
+{
+	const auto height = [n](int x, int z) {
+		const float u = float(x) / n, v = float(z) / n;
+		return 0.1f * std::sin(u * 17.0f) * std::cos(v * 13.0f) + 0.03f * std::sin((u + v) * 71.0f);
+	};
+	const auto vertex = [&](int x, int z) { return glm::vec3(float(x) / n - 0.5f, height(x, z), float(z) / n - 0.5f); };
+
+	std::vector<Triangle> tris;
+	tris.reserve(std::size_t(n) * n * 2);
+	for(int z = 0; z < n; ++z)
+	{
+		for(int x = 0; x < n; ++x)
+		{
+			tris.push_back({vertex(x, z), vertex(x + 1, z), vertex(x, z + 1)});
+			tris.push_back({vertex(x + 1, z), vertex(x + 1, z + 1), vertex(x, z + 1)});
+		}
+	}
+	return tris;
+}
+
+static void WriteBinaryStl(const std::string &path, const std::vector<Triangle> &tris)
+{
+	FILE *f = std::fopen(path.c_str(), "wb");
+	char header[80] = "solid generated by bvh_bench";
+	std::fwrite(header, 1, 80, f);
+
+	const uint32_t count = uint32_t(tris.size());
+	std::fwrite(&count, 4, 1, f);
+
+	const float normal[3] = {0.0f, 0.0f, 1.0f};
+	const uint16_t attribute = 0;
+	for(const auto &t : tris)
+	{
+		std::fwrite(normal, 4, 3, f);
+		std::fwrite(&t, 4, 9, f);
+		std::fwrite(&attribute, 2, 1, f);
+	}
+	std::fclose(f);
+}
+
+static float Unit(uint32_t i, uint32_t stream, int lane)
+{
+	return ToUnitFloat(Philox4x32::Generate(i, stream, 0, 0, 0xb1ecu, 0).v[lane]);
+}
+
+struct Query
+{
+	glm::vec3 origin, direction;
+};
+
+// From a sphere around the mesh toward a point inside its box
+static std::vector<Query> MakeRays(const Bvh &bvh)
+{
+	const glm::vec3 low = bvh.Min(), high = bvh.Max();
+	const glm::vec3 center = (low + high) * 0.5f;
+	const float radius = glm::length(high - low);
+
+	std::vector<Query> rays(queryCount);
+	for(uint32_t i = 0; i < queryCount; ++i)
+	{
+		const float z = 2.0f * Unit(i, 0, 0) - 1.0f, phi = 6.2831853f * Unit(i, 0, 1);
+		const float r = std::sqrt(1.0f - z * z);
+		const glm::vec3 origin = center + radius * glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+		const glm::vec3 target = low + (high - low) * glm::vec3(Unit(i, 0, 2), Unit(i, 0, 3), Unit(i, 1, 0));
+		rays[i] = {origin, glm::normalize(target - origin)};
+	}
+	return rays;
+}
+
+// Short moves inside the box, as particles make in a step
+static std::vector<Query> MakeSegments(const Bvh &bvh, float length)
+{
+	const glm::vec3 low = bvh.Min(), high = bvh.Max();
+	std::vector<Query> segments(queryCount);
+	for(uint32_t i = 0; i < queryCount; ++i)
+	{
+		const glm::vec3 a = low + (high - low) * glm::vec3(Unit(i, 2, 0), Unit(i, 2, 1), Unit(i, 2, 2));
+		const glm::vec3 d = glm::vec3(Unit(i, 3, 0), Unit(i, 3, 1), Unit(i, 3, 2)) - 0.5f;
+		segments[i] = {a, a + glm::normalize(d) * length};
+	}
+	return segments;
+}
+
+// Closest hit with t in [0, maxT] against every triangle
+static bool LinearRaycast(const std::vector<Triangle> &tris, const Query &ray, float &best,
+		float maxT = std::numeric_limits<float>::infinity())
+{
+	bool found = false;
+	best = std::numeric_limits<float>::infinity();
+	for(const Triangle &t : tris)
+	{
+		const glm::vec3 e1 = t.p1 - t.p0, e2 = t.p2 - t.p0;
+		const glm::vec3 p = glm::cross(ray.direction, e2);
+		const float det = glm::dot(e1, p);
+		if(det == 0.0f)
+		{
+			continue;
+		}
+		const float inverse = 1.0f / det;
+		const glm::vec3 s = ray.origin - t.p0;
+		const float u = glm::dot(s, p) * inverse;
+		const glm::vec3 q = glm::cross(s, e1);
+		const float v = glm::dot(ray.direction, q) * inverse;
+		const float d = glm::dot(e2, q) * inverse;
+		if(u >= 0.0f && u <= 1.0f && v >= 0.0f && u + v <= 1.0f && d >= 0.0f && d <= maxT && d < best)
+		{
+			best = d;
+			found = true;
+		}
+	}
+	return found;
+}
+
+// Distance from p to the segment ab
+static float SegmentDistance(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b)
+{
+	const glm::vec3 ab = b - a;
+	const float length2 = glm::dot(ab, ab);
+	const float t = length2 > 0.0f ? std::min(std::max(glm::dot(p - a, ab) / length2, 0.0f), 1.0f) : 0.0f;
+	return glm::length(p - (a + t * ab));
+}
+
+// Distance from p to the closest triangle, by projection on each plane and
+// the edges otherwise: another way than the Voronoi regions of the BVH
+static float LinearDistance(const std::vector<Triangle> &tris, const glm::vec3 &p)
+{
+	float best = std::numeric_limits<float>::infinity();
+	for(const Triangle &t : tris)
+	{
+		const glm::vec3 n = glm::cross(t.p1 - t.p0, t.p2 - t.p0);
+		const float area2 = glm::dot(n, n);
+		if(area2 > 0.0f)
+		{
+			const glm::vec3 q = p - n * (glm::dot(p - t.p0, n) / area2);
+			const bool inside = glm::dot(glm::cross(t.p1 - t.p0, q - t.p0), n) >= 0.0f
+					&& glm::dot(glm::cross(t.p2 - t.p1, q - t.p1), n) >= 0.0f
+					&& glm::dot(glm::cross(t.p0 - t.p2, q - t.p2), n) >= 0.0f;
+			if(inside)
+			{
+				best = std::min(best, glm::length(p - q));
+				continue;
+			}
+		}
+		best = std::min(best, std::min(SegmentDistance(p, t.p0, t.p1), std::min(SegmentDistance(p, t.p1, t.p2),
+				SegmentDistance(p, t.p2, t.p0))));
+	}
+	return best;
+}
+
+// Queries per second of `query(i)` over the pool, and how many hit
+template<typename Body>
+static double Rate(ThreadPool &pool, std::size_t &hits, const Body &query)
+{
+	std::atomic<std::size_t> total(0);
+	Stopwatch watch;
+	pool.ParallelFor(queryCount, 4 * 1024, [&](std::size_t begin, std::size_t end) {
+		std::size_t n = 0;
+		for(std::size_t i = begin; i < end; ++i)
+		{
+			n += query(i);
+		}
+		total.fetch_add(n);
+	});
+	const double seconds = watch.Seconds();
+	hits = total.load();
+	return queryCount / seconds;
+}
+
+static bool Run(const std::string &name, const std::vector<Triangle> &tris, ThreadPool &pool)
+{
+	std::printf("\n%s: %zu triangles\n", name.c_str(), tris.size());
+
+	Stopwatch watch;
+	const Bvh serial(tris);
+	const double serialBuild = watch.Seconds();
+
+	watch.Restart();
+	const Bvh bvh(tris, &pool);
+	const double parallelBuild = watch.Seconds();
+
+	watch.Restart();
+	const Bvh4 bvh4(bvh);
+	const double collapse = watch.Seconds();
+
+	std::size_t leaves = 0;
+	for(const BvhNode &n : bvh.Nodes())
+	{
+		leaves += n.count > 0;
+	}
+	std::printf("build: serial %.1f ms, pool %.1f ms (%.3g triangles/s), 4-wide collapse %.1f ms\n",
+			serialBuild * 1000.0, parallelBuild * 1000.0, tris.size() / parallelBuild, collapse * 1000.0);
+	std::printf("tree: %zu nodes (%zu leaves, %.2f triangles each), %zu 4-wide nodes, depth %u, SAH cost %.1f (serial build %.1f)\n",
+			bvh.Nodes().size(), leaves, double(tris.size()) / leaves, bvh4.NodeCount(), bvh.Depth(), bvh.SahCost(), serial.SahCost());
+
+	const std::vector<Query> rays = MakeRays(bvh);
+	const float far = 1e30f;
+
+	// both layouts find the same closest hits, to rounding: a ray through an
+	// edge shared by two triangles may report either; a few against every triangle
+	std::size_t mismatches = 0;
+	const std::size_t linearChecks = std::max<std::size_t>(16, std::min<std::size_t>(2000, 200000000 / tris.size()));
+	for(std::size_t i = 0; i < queryCount; ++i)
+	{
+		RayHit a, b;
+		const bool hitA = bvh.Raycast(rays[i].origin, rays[i].direction, far, a);
+		const bool hitB = bvh4.Raycast(rays[i].origin, rays[i].direction, far, b);
+		bool ok = hitA == hitB && (!hitA || std::abs(a.t - b.t) <= 1e-5f * std::max(1.0f, a.t));
+		if(i < linearChecks)
+		{
+			float t;
+			const bool hitLinear = LinearRaycast(tris, rays[i], t);
+			ok = ok && hitLinear == hitA && (!hitA || std::abs(t - a.t) <= 1e-5f * std::max(1.0f, t));
+		}
+		mismatches += !ok;
+	}
+	std::printf("check: %zu rays binary against 4-wide, %zu against a linear scan: %s\n", queryCount, linearChecks,
+			mismatches == 0 ? "ok" : "MISMATCH");
+
+	watch.Restart();
+	std::size_t linearHits = 0;
+	for(std::size_t i = 0; i < linearChecks; ++i)
+	{
+		float t;
+		linearHits += LinearRaycast(tris, rays[i], t);
+	}
+	const double linearRate = linearChecks / watch.Seconds();
+
+	std::size_t hits;
+	const double binaryRate = Rate(pool, hits, [&](std::size_t i) {
+		RayHit hit;
+		return bvh.Raycast(rays[i].origin, rays[i].direction, far, hit);
+	});
+	const double wideRate = Rate(pool, hits, [&](std::size_t i) {
+		RayHit hit;
+		return bvh4.Raycast(rays[i].origin, rays[i].direction, far, hit);
+	});
+	std::printf("rays/s: linear %.3g, binary %.3g, 4-wide %.3g (%.1f%% hit)\n", linearRate, binaryRate, wideRate,
+			100.0 * hits / queryCount);
+
+	const float extent = glm::length(bvh.Max() - bvh.Min());
+	const std::vector<Query> segments = MakeSegments(bvh, 0.01f * extent);
+	const float radius = 0.01f * extent;
+
+	// the queries particles run every step, checked the same way; the
+	// distances only agree to rounding, so does a contact right at the radius
+	std::size_t segmentMismatches = 0, sphereMismatches = 0;
+	const float tolerance = 1e-5f * extent;
+	for(std::size_t i = 0; i < queryCount; ++i)
+	{
+		const Query &s = segments[i];
+		RayHit a, b;
+		const bool hitA = bvh.Segment(s.origin, s.direction, a);
+		const bool hitB = bvh4.Segment(s.origin, s.direction, b);
+		bool ok = hitA == hitB && (!hitA || std::abs(a.t - b.t) <= 1e-5f);
+		if(i < linearChecks)
+		{
+			float t;
+			const bool hitLinear = LinearRaycast(tris, {s.origin, s.direction - s.origin}, t, 1.0f);
+			ok = ok && hitLinear == hitA && (!hitA || std::abs(t - a.t) <= 1e-5f);
+
+			SphereContact contact;
+			const bool touching = bvh.ClosestPoint(s.origin, radius, contact);
+			const float distance = LinearDistance(tris, s.origin);
+			const bool agrees = touching ? std::abs(contact.distance - distance) <= tolerance
+						&& std::abs(glm::length(contact.point - s.origin) - contact.distance) <= tolerance
+					: distance > radius - tolerance;
+			sphereMismatches += !(agrees || std::abs(distance - radius) <= tolerance);
+		}
+		segmentMismatches += !ok;
+	}
+	std::printf("check: %zu segments binary against 4-wide, %zu segments and spheres against a linear scan: %s\n", queryCount,
+			linearChecks, segmentMismatches == 0 && sphereMismatches == 0 ? "ok" : "MISMATCH");
+	mismatches += segmentMismatches + sphereMismatches;
+	const double segmentRate = Rate(pool, hits, [&](std::size_t i) {
+		RayHit hit;
+		return bvh.Segment(segments[i].origin, segments[i].direction, hit);
+	});
+	const double wideSegmentRate = Rate(pool, hits, [&](std::size_t i) {
+		RayHit hit;
+		return bvh4.Segment(segments[i].origin, segments[i].direction, hit);
+	});
+	std::printf("segments/s (1%% of the diagonal): binary %.3g, 4-wide %.3g (%.1f%% hit)\n", segmentRate, wideSegmentRate,
+			100.0 * hits / queryCount);
+
+	const double sphereRate = Rate(pool, hits, [&](std::size_t i) {
+		SphereContact contact;
+		return bvh.ClosestPoint(segments[i].origin, radius, contact);
+	});
+	std::printf("spheres/s (radius 1%% of the diagonal): %.3g (%.1f%% in contact)\n", sphereRate, 100.0 * hits / queryCount);
+
+	DoNotOptimize(linearHits);
+	return mismatches == 0;
+}
+
+int main(int argc, char **argv)
+{
+	const int terrain = argc > 1 ? std::atoi(argv[1]) : 1024;
+
+	ThreadPool pool;
+	std::printf("%u threads, %zu queries per test\n", pool.ThreadCount(), queryCount);
+
+	// through an STL file, as the application loads meshes
+	const std::string path = (std::filesystem::temp_directory_path() / "bvh_bench.stl").string();
+	WriteBinaryStl(path, MakeTerrain(terrain));
+	Stopwatch watch;
+	const std::vector<Triangle> tris = ReadStlMapped(path.c_str(), &pool);
+	std::printf("terrain STL loaded in %.1f ms\n", watch.Seconds() * 1000.0);
+	std::filesystem::remove(path);
+
+	bool ok = Run("terrain " + std::to_string(terrain) + "x" + std::to_string(terrain), tris, pool);
+	for(int i = 2; i < argc; ++i)
+	{
+		ok = Run(argv[i], ReadStlMapped(argv[i], &pool), pool) && ok;
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+// Compute shader particles against the CPU kernels on a headless EGL
+// context: the GPU state must match IntegrateGravityScalar step after step,
+// then the time of a step on each side.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "egl_context.h"
+#include "gpu_particles.h"
+#include "particles.h"
+#include "shader_library.h"
+#include "thread_pool.h"
+#include "bench.h"
+
+struct Difference
+{
+	std::size_t mismatches = 0;
+	float maxError = 0.0f;
+};
+
+static Difference Compare(const ParticleStreams &a, const ParticleStreams &b)
+{
+	Difference d;
+	for(std::size_t i = 0; i < a.Count(); ++i)
+	{
+		const float errors[6] = {
+			std::fabs(a.px[i] - b.px[i]), std::fabs(a.py[i] - b.py[i]), std::fabs(a.pz[i] - b.pz[i]),
+			std::fabs(a.vx[i] - b.vx[i]), std::fabs(a.vy[i] - b.vy[i]), std::fabs(a.vz[i] - b.vz[i])
+		};
+		const float error = *std::max_element(errors, errors + 6);
+		if(error > 0.0f)
+		{
+			++d.mismatches;
+		}
+		d.maxError = std::max(d.maxError, error);
+	}
+	return d;
+}
+
+static GravityParams Step(uint32_t frame)
+{
+	// the spawn point wanders as if following the cursor
+	const float t = float(frame) * 0.05f;
+	return {1.0f / 60.0f, {0.5f * std::sin(t), 1.0f, 0.0f}, 0x9e3779b9u, frame};
+}
+
+int main(int argc, char **argv)
+{
+	const int count = argc > 1 ? std::atoi(argv[1]) : 1000000;
+	const int steps = argc > 2 ? std::atoi(argv[2]) : 300;
+
+	HeadlessContext context;
+	ShaderLibrary shaders;
+	std::printf("%s, %d particles\n", reinterpret_cast<const char *>(glGetString(GL_RENDERER)), count);
+
+	ParticleStreams cpu = MakeParticleStreams(count);
+	GpuParticles gpu(shaders, cpu);
+	ParticleStreams readBack;
+
+	bool identical = true;
+	for(int s = 0; s < steps; ++s)
+	{
+		const GravityParams params = Step(uint32_t(s));
+		IntegrateGravityScalar(cpu, 0, cpu.Count(), params);
+		gpu.Simulate(params);
+
+		if((s + 1) % 60 == 0 || s + 1 == steps)
+		{
+			gpu.Read(readBack);
+			const Difference d = Compare(cpu, readBack);
+			std::printf("step %4d: %zu particles differ, max error %g\n", s + 1, d.mismatches, d.maxError);
+			identical = identical && d.mismatches == 0;
+		}
+	}
+	std::printf("%s\n", identical ? "GPU state bit-identical to the scalar CPU kernel" : "GPU state DIFFERS from the scalar CPU kernel");
+
+	const int timedSteps = 100;
+	ThreadPool pool;
+
+	Stopwatch watch;
+	for(int s = 0; s < timedSteps; ++s)
+	{
+		SimulateGravity(cpu, Step(uint32_t(s)), pool);
+	}
+	std::printf("CPU (%s, %u threads) %8.3f ms/step\n", SimdLevelName(BestSimdLevel()), pool.ThreadCount(), watch.Seconds() * 1000.0 / timedSteps);
+
+	glFinish();
+	watch.Restart();
+	for(int s = 0; s < timedSteps; ++s)
+	{
+		gpu.Simulate(Step(uint32_t(s)));
+	}
+	glFinish();
+	std::printf("GPU compute            %8.3f ms/step\n", watch.Seconds() * 1000.0 / timedSteps);
+
+	// the CPU path also streams the positions to the GPU every frame
+	std::printf("bytes uploaded per frame: CPU %zu, GPU 0\n", std::size_t(count) * 3 * sizeof(float));
+
+	return identical ? 0 : 1;
+}
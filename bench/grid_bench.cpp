@@ -0,0 +1,126 @@
+// Spatial hash grid: build time and neighbour queries per second as the
+// particle count and density grow, checked against brute force on the
+// smallest set, then one soft collision step.
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "collisions.h"
+#include "random.h"
+#include "spatial_grid.h"
+#include "thread_pool.h"
+#include "bench.h"
+
+static const float radius = 0.02f;
+
+struct Points
+{
+	std::vector<float> x, y, z;
+};
+
+// Uniform in a cube sized for `neighbours` expected points within `radius`
+static Points MakePoints(std::size_t count, float neighbours)
+{
+	const float volume = float(count) * (4.0f / 3.0f * 3.14159265f * radius * radius * radius) / neighbours;
+	const float side = std::cbrt(volume);
+
+	Points p;
+	p.x.resize(count);
+	p.y.resize(count);
+	p.z.resize(count);
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		const auto r = Philox4x32::Generate(uint32_t(i), 0, 0, 0, 0x5eedu, 0);
+		p.x[i] = ToUnitFloat(r.v[0]) * side;
+		p.y[i] = ToUnitFloat(r.v[1]) * side;
+		p.z[i] = ToUnitFloat(r.v[2]) * side;
+	}
+	return p;
+}
+
+static std::size_t CountNeighbours(const SpatialGrid &grid, const Points &p, ThreadPool &pool)
+{
+	std::atomic<std::size_t> total(0);
+	// in bucket order, as the collisions do: neighbouring queries share cache lines
+	const auto &order = grid.Order();
+	pool.ParallelFor(order.size(), 4 * 1024, [&](std::size_t begin, std::size_t end) {
+		std::size_t n = 0;
+		for(std::size_t s = begin; s < end; ++s)
+		{
+			const uint32_t i = order[s];
+			grid.ForEachNeighbour(p.x[i], p.y[i], p.z[i], radius, [&](uint32_t, float, float, float, float) { ++n; });
+		}
+		total.fetch_add(n);
+	});
+	return total.load();
+}
+
+static std::size_t BruteForce(const Points &p)
+{
+	std::size_t n = 0;
+	for(std::size_t i = 0; i < p.x.size(); ++i)
+	{
+		for(std::size_t j = 0; j < p.x.size(); ++j)
+		{
+			const float dx = p.x[i] - p.x[j], dy = p.y[i] - p.y[j], dz = p.z[i] - p.z[j];
+			n += dx * dx + dy * dy + dz * dz <= radius * radius;
+		}
+	}
+	return n;
+}
+
+int main(int argc, char **argv)
+{
+	const std::size_t maxCount = argc > 1 ? std::size_t(std::atol(argv[1])) : 1000000;
+
+	ThreadPool pool;
+	SpatialGrid grid(radius);
+	std::printf("%u threads, query radius = cell size = %g\n", pool.ThreadCount(), radius);
+
+	{
+		const Points p = MakePoints(10000, 16.0f);
+		grid.Build(p.x.data(), p.y.data(), p.z.data(), p.x.size(), pool);
+		Stopwatch watch;
+		const std::size_t brute = BruteForce(p);
+		const double bruteSeconds = watch.Seconds();
+		const std::size_t found = CountNeighbours(grid, p, pool);
+		std::printf("check 10000 points: grid %zu neighbours, brute force %zu (%s), brute force %.1f ms\n",
+				found, brute, found == brute ? "ok" : "MISMATCH", bruteSeconds * 1000.0);
+		if(found != brute)
+		{
+			return 1;
+		}
+	}
+
+	std::printf("%9s %10s %10s %10s %14s %14s\n", "points", "neighbours", "build ms", "query ms", "queries/s", "neighbours/s");
+	for(std::size_t count = 10000; count <= maxCount; count *= 10)
+	{
+		for(const float density : {4.0f, 16.0f, 64.0f})
+		{
+			const Points p = MakePoints(count, density);
+
+			Stopwatch watch;
+			grid.Build(p.x.data(), p.y.data(), p.z.data(), count, pool);
+			const double build = watch.Seconds();
+
+			watch.Restart();
+			const std::size_t found = CountNeighbours(grid, p, pool);
+			const double query = watch.Seconds();
+
+			std::printf("%9zu %10.1f %10.2f %10.2f %14.3g %14.3g\n", count, double(found) / count,
+					build * 1000.0, query * 1000.0, count / query, found / query);
+		}
+	}
+
+	// the collision step on a particle set of the scene's density
+	ParticleStreams particles = MakeParticleStreams(int(std::min<std::size_t>(maxCount, 100000)));
+	Stopwatch watch;
+	grid.Build(particles.px.data(), particles.py.data(), particles.pz.data(), particles.Count(), pool);
+	const std::size_t contacts = ApplySoftCollisions(particles, grid, {1.0f / 60.0f, radius / 2.0f, 50.0f}, pool);
+	std::printf("soft collisions, %zu particles: %zu contacts, %.2f ms (build + forces)\n", particles.Count(), contacts / 2, watch.Seconds() * 1000.0);
+
+	return 0;
+}
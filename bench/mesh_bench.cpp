@@ -0,0 +1,76 @@
+// Indexed mesh build on an STL model: welded vertex count, memory and ACMR
+// before and after the vertex cache optimization, and the time of each stage.
+// The cache pass also runs on the welded triangles shuffled, the worst order
+// a model can come in.
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <random>
+
+#include "mesh.h"
+#include "stl.h"
+#include "bench.h"
+
+static void Report(const char *stage, const Mesh &mesh, double seconds)
+{
+	const std::size_t bytes = mesh.positions.size() * sizeof(glm::vec3)
+			+ mesh.normals.size() * sizeof(glm::vec3)
+			+ mesh.indices.size() * sizeof(uint32_t);
+
+	std::printf("%-18s %9zu vertices %9.2f MB  ACMR(16) %5.3f  ACMR(32) %5.3f  %8.2f ms\n", stage,
+			mesh.positions.size(), bytes / (1024.0 * 1024.0),
+			ComputeAcmr(mesh.indices, mesh.positions.size(), 16),
+			ComputeAcmr(mesh.indices, mesh.positions.size(), 32),
+			seconds * 1000.0);
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = argc > 1 ? argv[1] : "resources/models/logo.stl";
+	const float epsilon = 1e-5f;
+
+	const auto tris = ReadStlMapped(path);
+	std::printf("%s: %zu triangles\n", path, tris.size());
+
+	// the soup as uploaded today: three unique vertices per triangle
+	std::vector<uint32_t> soup(tris.size() * 3);
+	std::iota(soup.begin(), soup.end(), 0u);
+	const std::size_t soupBytes = tris.size() * 3 * 2 * sizeof(glm::vec3);
+	std::printf("%-18s %9zu vertices %9.2f MB  ACMR(16) %5.3f\n", "soup", tris.size() * 3, soupBytes / (1024.0 * 1024.0),
+			ComputeAcmr(soup, soup.size(), 16));
+
+	for(const auto mode : {NormalMode::Smooth, NormalMode::Faceted})
+	{
+		std::printf("-- %s normals\n", mode == NormalMode::Smooth ? "smooth" : "faceted");
+
+		Stopwatch watch;
+		Mesh mesh = WeldTriangles(tris, epsilon);
+		ComputeNormals(mesh, mode);
+		Report("welded", mesh, watch.Seconds());
+
+		watch.Restart();
+		OptimizeVertexCache(mesh);
+		Report("+ vertex cache", mesh, watch.Seconds());
+
+		watch.Restart();
+		OptimizeVertexFetch(mesh);
+		Report("+ vertex fetch", mesh, watch.Seconds());
+
+		// same vertices, triangles in random order
+		std::vector<uint32_t> order(mesh.indices.size() / 3);
+		std::iota(order.begin(), order.end(), 0u);
+		std::shuffle(order.begin(), order.end(), std::mt19937(42));
+		Mesh shuffled = mesh;
+		for(std::size_t t = 0; t < order.size(); ++t)
+		{
+			std::copy_n(&mesh.indices[order[t] * 3], 3, &shuffled.indices[t * 3]);
+		}
+		Report("shuffled", shuffled, 0.0);
+
+		watch.Restart();
+		OptimizeVertexCache(shuffled);
+		Report("+ vertex cache", shuffled, watch.Seconds());
+	}
+
+	return 0;
+}
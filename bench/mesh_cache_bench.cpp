@@ -0,0 +1,73 @@
+// Cold vs warm mesh load: parsing the source on every launch against mapping
+// the preprocessed .meshcache.
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include "mesh_cache.h"
+#include "stl.h"
+#include "bench.h"
+
+// Touches every byte as a GPU upload would, so lazy mapping is not free
+static uint64_t Touch(const void *data, std::size_t size)
+{
+	const unsigned char *p = static_cast<const unsigned char *>(data);
+	uint64_t sum = 0;
+	for(std::size_t i = 0; i < size; i += 64)
+	{
+		sum += p[i];
+	}
+	return sum;
+}
+
+template<typename Load>
+static double BestMilliseconds(Load load)
+{
+	double best = 1e30;
+	for(int i = 0; i < 5; ++i)
+	{
+		Stopwatch watch;
+		load();
+		const double ms = watch.Seconds() * 1000.0;
+		best = ms < best ? ms : best;
+	}
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	const char *source = argc > 1 ? argv[1] : "resources/models/logo.stl";
+	const std::string cachePath = (std::filesystem::temp_directory_path() / "mesh_cache_bench.meshcache").string();
+
+	std::printf("%s\n", source);
+
+	const double soup = BestMilliseconds([&] {
+		const auto tris = ReadStl(source);
+		DoNotOptimize(tris);
+	});
+	std::printf("  %-34s %9.3f ms\n", "ReadStl (triangle soup)", soup);
+
+	const double cold = BestMilliseconds([&] {
+		const Mesh mesh = LoadSourceMesh(source);
+		DoNotOptimize(mesh);
+	});
+	std::printf("  %-34s %9.3f ms\n", "cold: parse + build indexed mesh", cold);
+
+	Stopwatch watch;
+	WriteMeshCache(cachePath.c_str(), LoadSourceMesh(source), source);
+	std::printf("  %-34s %9.3f ms\n", "build + write cache", watch.Seconds() * 1000.0);
+
+	const double warm = BestMilliseconds([&] {
+		const MeshCache cache(cachePath.c_str());
+		const bool valid = cache.IsUpToDate(source);
+		const uint64_t sum = Touch(cache.Positions(), cache.VertexCount() * sizeof(glm::vec3))
+				+ Touch(cache.Normals(), cache.VertexCount() * sizeof(glm::vec3))
+				+ Touch(cache.Indices(), cache.IndexCount() * sizeof(uint32_t));
+		DoNotOptimize(valid);
+		DoNotOptimize(sum);
+	});
+	std::printf("  %-34s %9.3f ms  (%.1fx faster than cold)\n", "warm: map + validate + touch", warm, cold / warm);
+
+	std::filesystem::remove(cachePath);
+	return 0;
+}
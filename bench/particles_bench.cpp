@@ -0,0 +1,102 @@
+// Particles per second of the array-of-structs ApplyGravity against the
+// structure-of-arrays kernels, for 10k to 10M particles.
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "particles.h"
+#include "cpu.h"
+#include "bench.h"
+
+static const float deltaTime = 1.0f / 60.0f;
+static const glm::vec3 spawn(0.0f, 0.5f, 1.0f);
+
+// Enough steps for roughly 200M particle updates, at least 3
+static int StepsFor(int n)
+{
+	const int steps = 200000000 / n;
+	return steps < 3 ? 3 : steps;
+}
+
+static double BenchAos(int n)
+{
+	auto particules = MakeParticles(n);
+	const int steps = StepsFor(n);
+
+	ApplyGravity(particules, spawn, deltaTime);
+
+	Stopwatch watch;
+	for(int i = 0; i < steps; ++i)
+	{
+		ApplyGravity(particules, spawn, deltaTime);
+	}
+	const double seconds = watch.Seconds();
+
+	DoNotOptimize(particules[0]);
+	return double(n) * steps / seconds;
+}
+
+static double BenchSoa(int n, SimdLevel level)
+{
+	auto particules = MakeParticleStreams(n);
+	const auto kernel = SelectGravityKernel(level);
+	const int steps = StepsFor(n);
+	GravityParams params = {deltaTime, spawn, 1234u, 0u};
+
+	kernel(particules, 0, particules.Count(), params);
+
+	Stopwatch watch;
+	for(int i = 0; i < steps; ++i)
+	{
+		params.frame = uint32_t(i + 1);
+		kernel(particules, 0, particules.Count(), params);
+	}
+	const double seconds = watch.Seconds();
+
+	DoNotOptimize(particules.px[0]);
+	return double(n) * steps / seconds;
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<int> counts = {10000, 100000, 1000000, 10000000};
+	if(argc > 1)
+	{
+		counts = {std::atoi(argv[1])};
+	}
+
+	const auto &cpu = GetCpuFeatures();
+	std::vector<SimdLevel> levels = {SimdLevel::Scalar};
+	if(cpu.sse41)
+	{
+		levels.push_back(SimdLevel::Sse41);
+	}
+	if(cpu.avx2)
+	{
+		levels.push_back(SimdLevel::Avx2);
+	}
+
+	std::printf("%10s %14s", "particles", "aos (p/s)");
+	for(const auto level : levels)
+	{
+		std::printf(" %14s", SimdLevelName(level));
+	}
+	std::printf(" %8s\n", "speedup");
+
+	for(const int n : counts)
+	{
+		const double aos = BenchAos(n);
+		std::printf("%10d %14.3e", n, aos);
+
+		double best = 0.0;
+		for(const auto level : levels)
+		{
+			const double soa = BenchSoa(n, level);
+			best = soa > best ? soa : best;
+			std::printf(" %14.3e", soa);
+		}
+		std::printf(" %7.2fx\n", best / aos);
+	}
+
+	return 0;
+}
@@ -0,0 +1,82 @@
+// Cost of a scoped zone with the profiler disabled, compiled out and enabled,
+// and of SimulateGravity with and without its zones recorded.
+#include <cstdio>
+#include <cstdlib>
+
+#include "particles.h"
+#include "profiler.h"
+#include "thread_pool.h"
+#include "bench.h"
+
+static const int zoneCount = 1 << 20;
+
+static double ZoneNanoseconds(bool enabled)
+{
+	EnableProfiler(enabled);
+	float sum = 0.0f;
+
+	Stopwatch watch;
+	for(int i = 0; i < zoneCount; ++i)
+	{
+		PROFILE_ZONE("bench zone");
+		sum += float(i);
+		DoNotOptimize(sum);
+
+		// the ring holds fewer zones than the loop records
+		if((i & 4095) == 4095)
+		{
+			ProfilerFrameEnd();
+		}
+	}
+	return watch.Seconds() * 1e9 / zoneCount;
+}
+
+static double BaselineNanoseconds()
+{
+	float sum = 0.0f;
+
+	Stopwatch watch;
+	for(int i = 0; i < zoneCount; ++i)
+	{
+		sum += float(i);
+		DoNotOptimize(sum);
+
+		if((i & 4095) == 4095)
+		{
+			ProfilerFrameEnd();
+		}
+	}
+	return watch.Seconds() * 1e9 / zoneCount;
+}
+
+static double SimulateMilliseconds(ParticleStreams &particles, ThreadPool &pool, bool enabled, int steps)
+{
+	EnableProfiler(enabled);
+
+	Stopwatch watch;
+	for(int s = 0; s < steps; ++s)
+	{
+		SimulateGravity(particles, {1.0f / 60.0f, {0.0f, 1.0f, 0.0f}, 0x9e3779b9u, uint32_t(s)}, pool);
+		ProfilerFrameEnd();
+	}
+	return watch.Seconds() * 1000.0 / steps;
+}
+
+int main(int argc, char **argv)
+{
+	const int count = argc > 1 ? std::atoi(argv[1]) : 1000000;
+	const int steps = 100;
+
+	const double baseline = BaselineNanoseconds();
+	std::printf("empty loop          %6.2f ns/iteration\n", baseline);
+	std::printf("zone, disabled      %6.2f ns/iteration\n", ZoneNanoseconds(false));
+	std::printf("zone, enabled       %6.2f ns/iteration\n", ZoneNanoseconds(true));
+
+	ThreadPool pool;
+	ParticleStreams particles = MakeParticleStreams(count);
+	std::printf("SimulateGravity(%d) on %u threads\n", count, pool.ThreadCount());
+	std::printf("profiler disabled   %6.3f ms/step\n", SimulateMilliseconds(particles, pool, false, steps));
+	std::printf("profiler enabled    %6.3f ms/step\n", SimulateMilliseconds(particles, pool, true, steps));
+
+	return 0;
+}
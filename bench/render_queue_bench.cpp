@@ -0,0 +1,282 @@
+// Render queue on a headless EGL context: N draws (N from the command line)
+// spread over 8 programs, 16 textures and 64 meshes, submitted in random
+// order. Reports the key sort (radix against std::stable_sort) and the
+// batching on the CPU, then the frame time of one draw call per object with
+// its binds against the sorted multi-draw indirect batches, and checks that
+// both paths draw the same image.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "egl_context.h"
+#include "random.h"
+#include "render_queue.h"
+#include "shader_library.h"
+#include "bench.h"
+
+static const int programCount = 8;
+static const int textureCount = 16;
+static const int meshCount = 64;
+static const int frames = 100;
+static const int warmup = 10;
+
+struct Draw
+{
+	GLuint program, texture;
+	MeshHandle mesh;
+	float depth;
+	DrawInstance instance;
+};
+
+static float Unit(uint32_t i, int lane)
+{
+	return ToUnitFloat(Philox4x32::Generate(i, 0, 0, 0, 0x2e2du, 0).v[lane]);
+}
+
+// A small disc of 8 to 64 triangles
+static void MakeDisc(int segments, std::vector<ArenaVertex> &vertices, std::vector<uint32_t> &indices)
+{
+	vertices.assign(1, {glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f), glm::vec2(0.5f)});
+	indices.clear();
+	for(int s = 0; s < segments; ++s)
+	{
+		const float angle = 6.2831853f * s / segments;
+		const glm::vec3 p(std::cos(angle), std::sin(angle), 0.0f);
+		vertices.push_back({p, glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f), glm::vec2(0.5f + 0.5f * p.x, 0.5f + 0.5f * p.y)});
+		indices.insert(indices.end(), {0u, uint32_t(1 + s), uint32_t(1 + (s + 1) % segments)});
+	}
+}
+
+static void Measure(const char *name, void (*frame)(void *), void *context)
+{
+	for(int f = 0; f < warmup; ++f)
+	{
+		frame(context);
+	}
+	glFinish();
+
+	double submit = 0.0;
+	Stopwatch watch;
+	for(int f = 0; f < frames; ++f)
+	{
+		Stopwatch frameWatch;
+		frame(context);
+		submit += frameWatch.Seconds();
+	}
+	glFinish();
+
+	std::printf("%-26s submit %8.3f ms  frame %8.3f ms\n", name, submit * 1000.0 / frames, watch.Seconds() * 1000.0 / frames);
+}
+
+struct Scene
+{
+	GeometryArena *arena;
+	RenderQueue *queue;
+	std::vector<Draw> draws;
+	// the instances in submission order, for the unbatched path
+	GLuint instances;
+};
+
+int main(int argc, char **argv)
+{
+	const std::size_t count = argc > 1 ? std::size_t(std::atol(argv[1])) : 20000;
+
+	HeadlessContext context;
+	std::printf("%s, %zu draws: %d programs, %d textures, %d meshes\n", reinterpret_cast<const char *>(glGetString(GL_RENDERER)),
+			count, programCount, textureCount, meshCount);
+
+	ShaderLibrary shaders;
+	std::vector<GLuint> programs;
+	for(int p = 0; p < programCount; ++p)
+	{
+		// distinct programs for the same shaders
+		const ProgramId id = shaders.Load({
+			{GL_VERTEX_SHADER, "resources/shaders/shaderStl.vert"},
+			{GL_FRAGMENT_SHADER, "resources/shaders/shaderStl.frag"}
+		}, {{"VARIANT", std::to_string(p)}});
+		programs.push_back(shaders.Program(id));
+	}
+
+	std::vector<GLuint> textures(textureCount);
+	glCreateTextures(GL_TEXTURE_2D, textureCount, textures.data());
+	for(int t = 0; t < textureCount; ++t)
+	{
+		const uint32_t texel = 0xff000000u | uint32_t(t * 0x0f0f0f);
+		glTextureStorage2D(textures[t], 1, GL_RGBA8, 1, 1);
+		glTextureSubImage2D(textures[t], 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &texel);
+	}
+
+	GeometryArena arena;
+	std::vector<ArenaVertex> vertices;
+	std::vector<uint32_t> indices;
+	for(int m = 0; m < meshCount; ++m)
+	{
+		MakeDisc(8 + m % 57, vertices, indices);
+		arena.Add(vertices, indices);
+	}
+
+	// distinct depths in random order: the depth test, not the draw order,
+	// decides every overlap, so both paths must draw the same image
+	std::vector<float> depths(count);
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		depths[i] = (i + 0.5f) / count;
+	}
+	for(uint32_t i = uint32_t(count); i > 1; --i)
+	{
+		std::swap(depths[i - 1], depths[Philox4x32::Generate(i, 2, 0, 0, 0x2e2du, 0).v[0] % i]);
+	}
+
+	Scene scene;
+	scene.arena = &arena;
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		const Philox4x32 pick = Philox4x32::Generate(i, 1, 0, 0, 0x2e2du, 0);
+		const glm::vec4 offsetScale(2.0f * Unit(i, 0) - 1.0f, 2.0f * Unit(i, 1) - 1.0f, 2.0f * depths[i] - 1.0f, 0.02f);
+		scene.draws.push_back({programs[pick.v[0] % programCount], textures[pick.v[1] % textureCount], MeshHandle(pick.v[2] % meshCount),
+				depths[i], {offsetScale, glm::vec4(1.0f)}});
+	}
+
+	// CPU: the sort alone, then the whole batching
+	{
+		std::vector<SortEntry> keys, sorted, scratch;
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			const Draw &d = scene.draws[i];
+			keys.push_back({MakeSortKey(d.program, d.texture, d.mesh, d.depth), i});
+		}
+
+		double radix = 0.0, standard = 0.0;
+		for(int run = 0; run < frames; ++run)
+		{
+			sorted = keys;
+			Stopwatch watch;
+			RadixSort(sorted, scratch);
+			radix += watch.Seconds();
+
+			std::vector<SortEntry> reference = keys;
+			watch.Restart();
+			std::stable_sort(reference.begin(), reference.end(), [](const SortEntry &a, const SortEntry &b) { return a.key < b.key; });
+			standard += watch.Seconds();
+
+			for(std::size_t k = 0; k < count; ++k)
+			{
+				if(sorted[k].item != reference[k].item)
+				{
+					std::printf("radix sort MISMATCH at %zu\n", k);
+					return EXIT_FAILURE;
+				}
+			}
+		}
+		std::printf("sort: radix %.3f ms, std::stable_sort %.3f ms\n", radix * 1000.0 / frames, standard * 1000.0 / frames);
+
+		DrawList list;
+		double build = 0.0;
+		for(int run = 0; run < frames; ++run)
+		{
+			list.Clear();
+			for(const Draw &d : scene.draws)
+			{
+				list.Add(d.program, d.texture, d.mesh, d.depth, d.instance);
+			}
+			Stopwatch watch;
+			list.Build(arena.Ranges());
+			build += watch.Seconds();
+		}
+
+		const RenderQueueStats &stats = list.Stats();
+		std::printf("batching: %.3f ms\n", build * 1000.0 / frames);
+		std::printf("  unbatched: %zu draw calls, %zu state changes\n", stats.draws, stats.unbatchedStateChanges);
+		std::printf("  batched:   %zu draw calls (%zu instanced commands), %zu state changes, %zu triangles\n", stats.drawCalls,
+				stats.commands, stats.stateChanges, stats.triangles);
+	}
+
+	// GPU: both paths draw the same instances from the same arena
+	const int size = 512;
+	GLuint color, depth, fbo;
+	glCreateTextures(GL_TEXTURE_2D, 1, &color);
+	glTextureStorage2D(color, 1, GL_RGBA8, size, size);
+	glCreateTextures(GL_TEXTURE_2D, 1, &depth);
+	glTextureStorage2D(depth, 1, GL_DEPTH_COMPONENT32F, size, size);
+	glCreateFramebuffers(1, &fbo);
+	glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, color, 0);
+	glNamedFramebufferTexture(fbo, GL_DEPTH_ATTACHMENT, depth, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, size, size);
+	glEnable(GL_DEPTH_TEST);
+
+	std::vector<DrawInstance> instances;
+	for(const Draw &d : scene.draws)
+	{
+		instances.push_back(d.instance);
+	}
+	glCreateBuffers(1, &scene.instances);
+	glNamedBufferStorage(scene.instances, GLsizeiptr(instances.size() * sizeof(DrawInstance)), instances.data(), 0);
+
+	Measure("one draw per object", [](void *p) {
+		Scene &scene = *static_cast<Scene *>(p);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glVertexArrayVertexBuffer(scene.arena->Vao(), 1, scene.instances, 0, sizeof(DrawInstance));
+		glBindVertexArray(scene.arena->Vao());
+		GLuint program = 0, texture = 0;
+		for(std::size_t i = 0; i < scene.draws.size(); ++i)
+		{
+			const Draw &d = scene.draws[i];
+			if(d.program != program)
+			{
+				glUseProgram(program = d.program);
+			}
+			if(d.texture != texture)
+			{
+				glBindTextureUnit(0, texture = d.texture);
+			}
+			const MeshRange &range = scene.arena->Range(d.mesh);
+			glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, GLsizei(range.indexCount), GL_UNSIGNED_INT,
+					reinterpret_cast<const void *>(std::size_t(range.firstIndex) * sizeof(uint32_t)), 1, range.baseVertex, GLuint(i));
+		}
+	}, &scene);
+
+	// the last frame of each path stays in the framebuffer
+	std::vector<uint32_t> reference(std::size_t(size) * size), batched(reference.size());
+	glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, reference.data());
+
+	RenderQueue queue(arena);
+	scene.queue = &queue;
+	Measure("render queue", [](void *p) {
+		Scene &scene = *static_cast<Scene *>(p);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		for(const Draw &d : scene.draws)
+		{
+			scene.queue->Submit(d.program, d.texture, d.mesh, d.depth, d.instance);
+		}
+		scene.queue->Flush();
+	}, &scene);
+
+	glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, batched.data());
+	std::size_t differ = 0, covered = 0;
+	for(std::size_t p = 0; p < reference.size(); ++p)
+	{
+		differ += reference[p] != batched[p];
+		covered += reference[p] != 0;
+	}
+	if(differ == 0)
+	{
+		std::printf("image: identical, %.1f%% covered\n", 100.0 * covered / reference.size());
+	}
+	else
+	{
+		std::printf("image: %zu pixels differ MISMATCH\n", differ);
+	}
+
+	glDeleteBuffers(1, &scene.instances);
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteTextures(1, &color);
+	glDeleteTextures(1, &depth);
+	glDeleteTextures(textureCount, textures.data());
+	return differ == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
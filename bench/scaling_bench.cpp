@@ -0,0 +1,82 @@
+// Thread scaling of SimulateGravity at 1/2/4/8/N threads. Also checks that
+// the final particle state is bit-identical at every thread count.
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "particles.h"
+#include "thread_pool.h"
+#include "bench.h"
+
+static const float deltaTime = 1.0f / 60.0f;
+static const glm::vec3 spawn(0.0f, 0.5f, 1.0f);
+
+// FNV-1a over the position and speed streams
+static uint64_t Checksum(const ParticleStreams &particules)
+{
+	uint64_t hash = 1469598103934665603ull;
+	for(const auto *stream : {&particules.px, &particules.py, &particules.pz, &particules.vx, &particules.vy, &particules.vz})
+	{
+		const auto *bytes = reinterpret_cast<const unsigned char *>(stream->data());
+		for(std::size_t i = 0; i < stream->size() * sizeof(float); ++i)
+		{
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	}
+	return hash;
+}
+
+int main(int argc, char **argv)
+{
+	const int n = argc > 1 ? std::atoi(argv[1]) : 4000000;
+	const int steps = argc > 2 ? std::atoi(argv[2]) : 50;
+
+	const unsigned cores = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+	std::vector<unsigned> threadCounts;
+	for(unsigned t : {1u, 2u, 4u, 8u, cores})
+	{
+		if(threadCounts.empty() || t > threadCounts.back())
+		{
+			threadCounts.push_back(t);
+		}
+	}
+
+	const auto initial = MakeParticleStreams(n);
+
+	std::printf("%d particles, %d steps, %u cores\n", n, steps, cores);
+	std::printf("%8s %14s %9s %11s %16s\n", "threads", "particles/s", "speedup", "efficiency", "checksum");
+
+	double single = 0.0;
+	uint64_t reference = 0;
+	bool identical = true;
+
+	for(const unsigned threads : threadCounts)
+	{
+		ThreadPool pool(threads);
+		auto particules = initial;
+		GravityParams params = {deltaTime, spawn, 1234u, 0u};
+
+		Stopwatch watch;
+		for(int i = 0; i < steps; ++i)
+		{
+			params.frame = uint32_t(i);
+			SimulateGravity(particules, params, pool);
+		}
+		const double rate = double(n) * steps / watch.Seconds();
+
+		const uint64_t checksum = Checksum(particules);
+		if(threads == threadCounts.front())
+		{
+			single = rate;
+			reference = checksum;
+		}
+		identical = identical && checksum == reference;
+
+		std::printf("%8u %14.3e %8.2fx %10.0f%% %016llx\n", threads, rate, rate / single,
+				100.0 * rate / single / threads, (unsigned long long) checksum);
+	}
+
+	std::printf("results %s across thread counts\n", identical ? "identical" : "DIFFER");
+	return identical ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+// Shader startup time on a headless EGL context: every program of
+// resources/shaders compiled from source (cold) against restored from the
+// program binary cache (warm), and the preprocessing cost.
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "egl_context.h"
+#include "shader.h"
+#include "shader_library.h"
+#include "bench.h"
+
+static const std::vector<std::vector<ShaderStage>> programs = {
+	{{GL_VERTEX_SHADER, "resources/shaders/shader.vert"}, {GL_FRAGMENT_SHADER, "resources/shaders/shader.frag"}},
+	{{GL_VERTEX_SHADER, "resources/shaders/shaderGravity.vert"}, {GL_FRAGMENT_SHADER, "resources/shaders/shaderGravity.frag"}},
+	{{GL_VERTEX_SHADER, "resources/shaders/shaderStl.vert"}, {GL_FRAGMENT_SHADER, "resources/shaders/shaderStl.frag"}},
+	{{GL_VERTEX_SHADER, "resources/shaders/shaderAtlas.vert"}, {GL_FRAGMENT_SHADER, "resources/shaders/shaderAtlas.frag"}}
+};
+
+// Removes the cache entries but keeps the directories a driver may hold
+static void EmptyDirectory(const std::filesystem::path &directory)
+{
+	std::error_code error;
+	for(const auto &entry : std::filesystem::recursive_directory_iterator(directory, error))
+	{
+		if(entry.is_regular_file())
+		{
+			std::filesystem::remove(entry.path(), error);
+		}
+	}
+}
+
+// Loads every program, returns milliseconds
+static double LoadAll(const std::string &cacheDirectory, ShaderLibraryStats &stats)
+{
+	Stopwatch watch;
+	ShaderLibrary library(cacheDirectory);
+	for(const auto &stages : programs)
+	{
+		library.Load(stages);
+	}
+	// linking may be deferred until the first use
+	for(ProgramId id = 0; id < programs.size(); ++id)
+	{
+		glUseProgram(library.Program(id));
+	}
+	glFinish();
+	stats = library.Stats();
+	return watch.Seconds() * 1000.0;
+}
+
+int main()
+{
+	// Mesa keeps its own disk cache, which would make every run warm. It
+	// cannot be disabled (program binaries go with it): it is emptied instead.
+	const auto mesaCache = std::filesystem::temp_directory_path() / "shader_bench_mesa";
+	setenv("MESA_SHADER_CACHE_DIR", mesaCache.string().c_str(), 1);
+
+	HeadlessContext context;
+	std::printf("%s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	std::printf("%d program binary format(s), %zu programs\n", formats, programs.size());
+
+	const std::string cacheDirectory = (std::filesystem::temp_directory_path() / "shader_bench_cache").string();
+
+	Stopwatch watch;
+	for(int i = 0; i < 100; ++i)
+	{
+		for(const auto &stages : programs)
+		{
+			for(const auto &stage : stages)
+			{
+				DoNotOptimize(PreprocessShader(stage.path));
+			}
+		}
+	}
+	std::printf("  %-34s %9.3f ms\n", "preprocess all sources", watch.Seconds() * 1000.0 / 100.0);
+
+	double cold = 1e30, warm = 1e30;
+	ShaderLibraryStats coldStats, warmStats;
+	for(int i = 0; i < 5; ++i)
+	{
+		EmptyDirectory(cacheDirectory);
+		EmptyDirectory(mesaCache);
+		cold = std::min(cold, LoadAll(cacheDirectory, coldStats));
+		warm = std::min(warm, LoadAll(cacheDirectory, warmStats));
+	}
+
+	std::printf("  %-34s %9.3f ms  (%zu compiled)\n", "cold: compile + link + store", cold, coldStats.compiled);
+	std::printf("  %-34s %9.3f ms  (%zu from cache)  %.1fx faster\n", "warm: program binaries", warm, warmStats.cacheHits, cold / warm);
+
+	std::filesystem::remove_all(cacheDirectory);
+	std::filesystem::remove_all(mesaCache);
+	return 0;
+}
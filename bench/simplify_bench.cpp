@@ -0,0 +1,100 @@
+// Quadric error simplification: an LOD chain (50/25/10/5%) on a generated
+// terrain of 2 * N * N triangles (N from the command line) and on an STL
+// or PLY model, with the triangles and the error bound of each level, the savings
+// against the full mesh and the speed in input triangles per second.
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "ply.h"
+#include "simplify.h"
+#include "stl.h"
+#include "bench.h"
+
+static Mesh MakeTerrain(int n)
+{
+	const auto height = [n](int x, int z) {
+		const float u = float(x) / n, v = float(z) / n;
+		return 0.1f * std::sin(u * 17.0f) * std::cos(v * 13.0f) + 0.03f * std::sin((u + v) * 71.0f);
+	};
+
+	Mesh mesh;
+	for(int z = 0; z <= n; ++z)
+	{
+		for(int x = 0; x <= n; ++x)
+		{
+			mesh.positions.push_back(glm::vec3(float(x) / n - 0.5f, height(x, z), float(z) / n - 0.5f));
+		}
+	}
+	for(int z = 0; z < n; ++z)
+	{
+		for(int x = 0; x < n; ++x)
+		{
+			const uint32_t v = uint32_t(z * (n + 1) + x);
+			mesh.indices.insert(mesh.indices.end(), {v, v + 1, v + n + 1, v + 1, v + n + 2, v + n + 1});
+		}
+	}
+	return mesh;
+}
+
+static void Run(const std::string &name, const Mesh &mesh)
+{
+	const std::size_t triangles = mesh.indices.size() / 3;
+	std::printf("\n%s: %zu triangles, %zu vertices\n", name.c_str(), triangles, mesh.positions.size());
+
+	Stopwatch watch;
+	const std::vector<MeshLod> lods = BuildLodChain(mesh);
+	const double chain = watch.Seconds();
+
+	// diagonal of the box, to read the errors as a fraction of the size
+	glm::vec3 low = mesh.positions[0], high = mesh.positions[0];
+	for(const glm::vec3 &p : mesh.positions)
+	{
+		low = glm::min(low, p);
+		high = glm::max(high, p);
+	}
+	const float diagonal = glm::length(high - low);
+
+	std::vector<float> errors;
+	std::printf("level  triangles  vertices   saved   error (%% of diagonal)\n");
+	for(std::size_t level = 0; level < lods.size(); ++level)
+	{
+		const Mesh &lod = lods[level].mesh;
+		std::printf("%5zu %10zu %9zu  %5.1f%%  %.4f%%\n", level, lod.indices.size() / 3, lod.positions.size(),
+				100.0 * (1.0 - double(lod.indices.size() / 3) / triangles), 100.0 * lods[level].error / diagonal);
+		errors.push_back(lods[level].error);
+	}
+	std::printf("chain: %.1f ms, %.3g triangles/s\n", chain * 1000.0, triangles / chain);
+
+	watch.Restart();
+	const MeshLod single = SimplifyMesh(mesh, 0.1f);
+	const double seconds = watch.Seconds();
+	std::printf("10%% alone: %zu triangles in %.1f ms, %.3g triangles/s\n", single.mesh.indices.size() / 3, seconds * 1000.0,
+			triangles / seconds);
+
+	// screen-space selection: a 1080p view, 60 degrees, 1 pixel of error
+	std::printf("selected level at distance (diagonals):");
+	for(const float distance : {0.5f, 1.0f, 2.0f, 5.0f, 10.0f, 20.0f, 50.0f})
+	{
+		const float pixels = PixelsPerUnit(1080.0f, 1.0471976f, distance * diagonal);
+		std::printf(" %g:%zu", distance, SelectLod(errors, pixels));
+	}
+	std::printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	const int terrain = argc > 1 ? std::atoi(argv[1]) : 512;
+	const char *path = argc > 2 ? argv[2] : "resources/models/logo.stl";
+
+	Run("terrain " + std::to_string(terrain) + "x" + std::to_string(terrain), MakeTerrain(terrain));
+	const std::string model = path;
+	const bool ply = model.size() > 4 && model.compare(model.size() - 4, 4, ".ply") == 0;
+	Run(model, ply ? ReadPly(path) : WeldTriangles(ReadStlMapped(path), 1e-5f));
+	return 0;
+}
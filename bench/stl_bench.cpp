@@ -0,0 +1,154 @@
+// STL load throughput in MB/s: ReadStl against the memory-mapped loader,
+// single threaded and on the thread pool, for binary and ASCII files.
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "stl.h"
+#include "thread_pool.h"
+#include "bench.h"
+
+static std::vector<Triangle> RandomTriangles(std::size_t n)
+{
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> d(-100.0f, 100.0f);
+
+	std::vector<Triangle> tris(n);
+	for(auto &t : tris)
+	{
+		t = {{d(rng), d(rng), d(rng)}, {d(rng), d(rng), d(rng)}, {d(rng), d(rng), d(rng)}};
+	}
+	return tris;
+}
+
+static void WriteBinaryStl(const std::string &path, const std::vector<Triangle> &tris)
+{
+	FILE *f = std::fopen(path.c_str(), "wb");
+	char header[80] = "solid generated by stl_bench";
+	std::fwrite(header, 1, 80, f);
+
+	const uint32_t count = uint32_t(tris.size());
+	std::fwrite(&count, 4, 1, f);
+
+	const float normal[3] = {0.0f, 0.0f, 1.0f};
+	const uint16_t attribute = 0;
+	for(const auto &t : tris)
+	{
+		std::fwrite(normal, 4, 3, f);
+		std::fwrite(&t, 4, 9, f);
+		std::fwrite(&attribute, 2, 1, f);
+	}
+	std::fclose(f);
+}
+
+static void WriteAsciiStl(const std::string &path, const std::vector<Triangle> &tris)
+{
+	FILE *f = std::fopen(path.c_str(), "w");
+	std::fprintf(f, "solid generated\n");
+	for(const auto &t : tris)
+	{
+		std::fprintf(f, "  facet normal 0.000000e+00 0.000000e+00 1.000000e+00\n    outer loop\n");
+		for(const auto &v : {t.p0, t.p1, t.p2})
+		{
+			std::fprintf(f, "      vertex %.9e %.9e %.9e\n", v.x, v.y, v.z);
+		}
+		std::fprintf(f, "    endloop\n  endfacet\n");
+	}
+	std::fprintf(f, "endsolid generated\n");
+	std::fclose(f);
+}
+
+static float MaxError(const std::vector<Triangle> &a, const std::vector<Triangle> &b)
+{
+	if(a.size() != b.size())
+	{
+		return INFINITY;
+	}
+
+	float error = 0.0f;
+	for(std::size_t i = 0; i < a.size(); ++i)
+	{
+		const float *x = &a[i].p0.x;
+		const float *y = &b[i].p0.x;
+		for(int k = 0; k < 9; ++k)
+		{
+			error = std::fmax(error, std::fabs(x[k] - y[k]));
+		}
+	}
+	return error;
+}
+
+template<typename Load>
+static double MegabytesPerSecond(const std::string &path, Load load, std::vector<Triangle> &result)
+{
+	const double megabytes = double(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+
+	// first run warms the page cache, the best of three is reported
+	result = load(path.c_str());
+	double best = 0.0;
+	for(int i = 0; i < 3; ++i)
+	{
+		Stopwatch watch;
+		result = load(path.c_str());
+		const double seconds = watch.Seconds();
+		best = std::fmax(best, megabytes / seconds);
+	}
+	return best;
+}
+
+static void Report(const char *name, const std::string &path, ThreadPool &pool, const std::vector<Triangle> *expected, bool legacy)
+{
+	std::vector<Triangle> tris;
+	const double megabytes = double(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+	std::printf("%s: %.1f MB\n", name, megabytes);
+
+	if(legacy)
+	{
+		const double rate = MegabytesPerSecond(path, [](const char *p) { return ReadStl(p); }, tris);
+		std::printf("  %-22s %10.1f MB/s\n", "ReadStl", rate);
+	}
+
+	const double single = MegabytesPerSecond(path, [](const char *p) { return ReadStlMapped(p); }, tris);
+	std::printf("  %-22s %10.1f MB/s\n", "ReadStlMapped", single);
+
+	const double parallel = MegabytesPerSecond(path, [&pool](const char *p) { return ReadStlMapped(p, &pool); }, tris);
+	std::printf("  ReadStlMapped (%2u thr) %10.1f MB/s\n", pool.ThreadCount(), parallel);
+
+	if(expected)
+	{
+		std::printf("  max error vs source    %10.3g\n", MaxError(tris, *expected));
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const std::size_t binaryCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+	const std::size_t asciiCount = binaryCount / 4;
+
+	ThreadPool pool;
+	const auto dir = std::filesystem::temp_directory_path();
+	const std::string binaryPath = (dir / "stl_bench_binary.stl").string();
+	const std::string asciiPath = (dir / "stl_bench_ascii.stl").string();
+
+	const auto binaryTris = RandomTriangles(binaryCount);
+	WriteBinaryStl(binaryPath, binaryTris);
+	Report("binary", binaryPath, pool, &binaryTris, true);
+
+	const auto asciiTris = RandomTriangles(asciiCount);
+	WriteAsciiStl(asciiPath, asciiTris);
+	Report("ascii", asciiPath, pool, &asciiTris, false);
+
+	if(std::filesystem::exists("resources/models/logo.stl"))
+	{
+		Report("resources/models/logo.stl", "resources/models/logo.stl", pool, nullptr, true);
+	}
+
+	std::filesystem::remove(binaryPath);
+	std::filesystem::remove(asciiPath);
+	return 0;
+}
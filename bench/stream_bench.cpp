@@ -0,0 +1,171 @@
+// Per-frame upload of particle positions on a headless EGL context, each
+// frame drawn as points: glBufferData re-specification, orphaning +
+// glBufferSubData, glBufferSubData into immutable storage, and the
+// persistent-mapped StreamBuffer ring.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "egl_context.h"
+#include "shader_library.h"
+#include "stream_buffer.h"
+#include "bench.h"
+
+static const int frames = 100;
+static const int warmup = 10;
+
+// The GPU work of a frame: a small point draw reading the whole buffer
+struct Renderer
+{
+	GLuint fbo, color, vao;
+	ProgramId program;
+	ShaderLibrary &shaders;
+
+	explicit Renderer(ShaderLibrary &shaders)
+		: shaders(shaders)
+	{
+		program = shaders.Load({
+			{GL_VERTEX_SHADER, "resources/shaders/shaderGravity.vert"},
+			{GL_FRAGMENT_SHADER, "resources/shaders/shaderGravity.frag"}
+		});
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &color);
+		glTextureStorage2D(color, 1, GL_RGBA8, 256, 256);
+		glCreateFramebuffers(1, &fbo);
+		glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, color, 0);
+
+		glCreateVertexArrays(1, &vao);
+		glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+		glVertexArrayAttribBinding(vao, 0, 0);
+		glEnableVertexArrayAttrib(vao, 0);
+		// color and size stay constant attributes
+		glVertexAttrib3f(1, 1.0f, 1.0f, 1.0f);
+		glVertexAttrib1f(2, 1.0f);
+	}
+
+	~Renderer()
+	{
+		glDeleteVertexArrays(1, &vao);
+		glDeleteFramebuffers(1, &fbo);
+		glDeleteTextures(1, &color);
+	}
+
+	void Draw(GLuint buffer, GLintptr offset, std::size_t count)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glViewport(0, 0, 256, 256);
+		glUseProgram(shaders.Program(program));
+		glVertexArrayVertexBuffer(vao, 0, buffer, offset, 3 * sizeof(float));
+		glBindVertexArray(vao);
+		glDrawArrays(GL_POINTS, 0, GLsizei(count));
+	}
+};
+
+// What the simulation produces every frame
+static void WritePositions(float *out, std::size_t count, int frame)
+{
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		out[3 * i + 0] = float(i % 1024) / 512.0f - 1.0f;
+		out[3 * i + 1] = float(frame % 100) / 50.0f - 1.0f;
+		out[3 * i + 2] = 0.0f;
+	}
+}
+
+// Prints the CPU time to issue a frame (write + upload + draw call) and the
+// time per frame with `frames` frames in flight
+static void Measure(const char *name, const std::function<void(int)> &frame)
+{
+	for(int f = 0; f < warmup; ++f)
+	{
+		frame(f);
+	}
+	glFinish();
+
+	double submit = 0.0;
+	Stopwatch watch;
+	for(int f = 0; f < frames; ++f)
+	{
+		Stopwatch frameWatch;
+		frame(f);
+		submit += frameWatch.Seconds();
+	}
+	glFinish();
+
+	std::printf("%-28s submit %8.3f ms  frame %8.3f ms", name, submit * 1000.0 / frames, watch.Seconds() * 1000.0 / frames);
+}
+
+int main(int argc, char **argv)
+{
+	const std::size_t count = argc > 1 ? std::size_t(std::atol(argv[1])) : 500000;
+	const std::size_t bytes = count * 3 * sizeof(float);
+
+	HeadlessContext context;
+	ShaderLibrary shaders;
+	Renderer renderer(shaders);
+	std::printf("%s, %zu particles, %.2f MB per frame\n", reinterpret_cast<const char *>(glGetString(GL_RENDERER)),
+			count, bytes / (1024.0 * 1024.0));
+
+	std::vector<float> staging(count * 3);
+
+	{
+		GLuint buffer;
+		glCreateBuffers(1, &buffer);
+		Measure("glBufferData (static)", [&](int f) {
+			WritePositions(staging.data(), count, f);
+			glNamedBufferData(buffer, GLsizeiptr(bytes), staging.data(), GL_STATIC_DRAW);
+			renderer.Draw(buffer, 0, count);
+		});
+		std::printf("\n");
+		glDeleteBuffers(1, &buffer);
+	}
+
+	{
+		GLuint buffer;
+		glCreateBuffers(1, &buffer);
+		glNamedBufferData(buffer, GLsizeiptr(bytes), nullptr, GL_STREAM_DRAW);
+		Measure("orphan + glBufferSubData", [&](int f) {
+			WritePositions(staging.data(), count, f);
+			glNamedBufferData(buffer, GLsizeiptr(bytes), nullptr, GL_STREAM_DRAW);
+			glNamedBufferSubData(buffer, 0, GLsizeiptr(bytes), staging.data());
+			renderer.Draw(buffer, 0, count);
+		});
+		std::printf("\n");
+		glDeleteBuffers(1, &buffer);
+	}
+
+	{
+		GLuint buffer;
+		glCreateBuffers(1, &buffer);
+		glNamedBufferStorage(buffer, GLsizeiptr(bytes), nullptr, GL_DYNAMIC_STORAGE_BIT);
+		Measure("glBufferSubData (immutable)", [&](int f) {
+			WritePositions(staging.data(), count, f);
+			glNamedBufferSubData(buffer, 0, GLsizeiptr(bytes), staging.data());
+			renderer.Draw(buffer, 0, count);
+		});
+		std::printf("\n");
+		glDeleteBuffers(1, &buffer);
+	}
+
+	for(unsigned regions : {1u, 2u, 3u})
+	{
+		StreamBuffer stream(bytes, regions);
+		char name[64];
+		std::snprintf(name, sizeof(name), "persistent ring x%u", regions);
+
+		// written in place: no staging copy
+		Measure(name, [&](int f) {
+			WritePositions(static_cast<float *>(stream.Map()), count, f);
+			renderer.Draw(stream.Buffer(), stream.Offset(), count);
+			stream.Unmap(bytes);
+		});
+
+		const StreamBufferStats &stats = stream.Stats();
+		std::printf("  %llu stalls (%.2f ms), %.2f MB/frame\n", static_cast<unsigned long long>(stats.stalls),
+				stats.stallMilliseconds, stats.BytesPerFrame() / (1024.0 * 1024.0));
+	}
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+// Texture preprocessing: mip chain generation and BC1/BC7 encode speed, the
+// quality of each encoding and the bytes uploaded per texture against the
+// single uncompressed RGB8 level used before.
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bc.h"
+#include "mipmap.h"
+#include "texture_cache.h"
+#include "thread_pool.h"
+#include "bench.h"
+
+static double Psnr(const std::vector<unsigned char> &a, const std::vector<unsigned char> &b)
+{
+	double error = 0.0;
+	for(std::size_t i = 0; i < a.size(); ++i)
+	{
+		const double d = double(a[i]) - double(b[i]);
+		error += d * d;
+	}
+	const double mse = error / double(a.size());
+	return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = argc > 1 ? argv[1] : "resources/images/wall.jpg";
+
+	const Image image = LoadImage(path);
+	const double megapixels = double(image.width) * image.height / 1e6;
+	std::printf("%s: %dx%d, %d channels\n", path, image.width, image.height, image.channels);
+
+	Stopwatch watch;
+	const auto chain = GenerateMipChain(image, true);
+	std::printf("  %-26s %8.2f ms  %d levels\n", "mip chain (sRGB, box)", watch.Seconds() * 1000.0, int(chain.size()));
+
+	std::size_t chainTexels = 0;
+	for(const auto &level : chain)
+	{
+		chainTexels += std::size_t(level.width) * level.height;
+	}
+
+	ThreadPool pool;
+	const auto &base = chain[0];
+
+	for(const auto format : {BlockFormat::BC1, BlockFormat::BC7})
+	{
+		watch.Restart();
+		const auto blocks = CompressImage(base.rgba.data(), base.width, base.height, format);
+		const double single = watch.Seconds();
+
+		watch.Restart();
+		const auto parallel = CompressImage(base.rgba.data(), base.width, base.height, format, &pool);
+		const double threaded = watch.Seconds();
+		DoNotOptimize(parallel);
+
+		// BC1 has no alpha: compare RGB only, with alpha forced on both sides
+		auto decoded = DecompressImage(blocks.data(), base.width, base.height, format);
+		auto reference = base.rgba;
+		for(std::size_t i = 3; i < decoded.size(); i += 4)
+		{
+			decoded[i] = reference[i] = 255;
+		}
+
+		std::printf("  %-4s encode %8.2f MPix/s (1 thread) %8.2f MPix/s (%u threads)  PSNR %5.2f dB\n",
+				BlockFormatName(format), megapixels / single, megapixels / threaded, pool.ThreadCount(),
+				Psnr(decoded, reference));
+	}
+
+	// bytes handed to the driver for this texture
+	const std::size_t rgb8 = std::size_t(image.width) * image.height * 3;
+	std::printf("  bytes uploaded per texture:\n");
+	std::printf("    %-28s %10zu\n", "RGB8, level 0 only (before)", rgb8);
+	std::printf("    %-28s %10zu  (%.2fx)\n", "RGBA8 full chain", chainTexels * 4, double(chainTexels * 4) / rgb8);
+
+	for(const auto encoding : {TextureEncoding::BC1, TextureEncoding::BC7})
+	{
+		TextureOptions options;
+		options.encoding = encoding;
+		const EncodedTexture texture = EncodeTexture(image, options, &pool);
+
+		std::size_t bytes = 0;
+		for(const auto &level : texture.levels)
+		{
+			bytes += level.data.size();
+		}
+		std::printf("    %-28s %10zu  (%.2fx)\n", (std::string(TextureEncodingName(encoding)) + " full chain").c_str(),
+				bytes, double(bytes) / rgb8);
+	}
+
+	return 0;
+}
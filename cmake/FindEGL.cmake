@@ -0,0 +1,38 @@
+#
+# Find EGL
+#
+# Headless OpenGL contexts (Mesa surfaceless platform, llvmpipe in CI).
+# This module defines
+# - EGL_INCLUDE_DIR
+# - EGL_LIBRARY
+# - EGL_FOUND
+#
+# The following variables can be set as arguments for the module.
+# - EGL_ROOT_DIR : Root directory of the EGL headers and library
+#
+
+# Additional modules
+include(FindPackageHandleStandardArgs)
+
+find_path(
+	EGL_INCLUDE_DIR
+	NAMES EGL/egl.h
+	PATHS
+	${EGL_ROOT_DIR}/include
+	/usr/include
+	/usr/local/include
+	DOC "The directory where EGL/egl.h resides")
+
+find_library(
+	EGL_LIBRARY
+	NAMES EGL libEGL
+	PATHS
+	${EGL_ROOT_DIR}/lib
+	/usr/lib
+	/usr/lib64
+	/usr/local/lib
+	DOC "The EGL library")
+
+find_package_handle_standard_args(EGL DEFAULT_MSG EGL_INCLUDE_DIR EGL_LIBRARY)
+
+mark_as_advanced(EGL_INCLUDE_DIR EGL_LIBRARY)
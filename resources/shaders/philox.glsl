@@ -0,0 +1,26 @@
+// Philox4x32-10, the same generator as source/random.h: a particle draws the
+// same numbers on the GPU as on the CPU
+
+uvec4 Philox4x32(uvec4 counter, uvec2 key)
+{
+    for(int round = 0; round < 10; ++round)
+    {
+        if(round > 0)
+        {
+            key += uvec2(0x9E3779B9u, 0xBB67AE85u);
+        }
+
+        uint hi0, lo0, hi1, lo1;
+        umulExtended(0xD2511F53u, counter.x, hi0, lo0);
+        umulExtended(0xCD9E8D57u, counter.z, hi1, lo1);
+
+        counter = uvec4(hi1 ^ counter.y ^ key.x, lo1, hi0 ^ counter.w ^ key.y, lo0);
+    }
+    return counter;
+}
+
+// Uniform float in [0, 1) from the top 24 bits
+float ToUnitFloat(uint x)
+{
+    return float(x >> 8) * (1.0 / 16777216.0);
+}
@@ -0,0 +1,22 @@
+#version 450
+
+// an atlas of one layer is a plain 2D texture (MakeAtlasTexture)
+#ifdef ATLAS_LAYERS
+layout (binding = 0) uniform sampler2DArray tex;
+#else
+layout (binding = 0) uniform sampler2D tex;
+#endif
+
+in vec3 ourColor;
+in vec3 TexCoord;
+
+out vec4 color;
+
+void main()
+{
+#ifdef ATLAS_LAYERS
+    color = texture(tex, TexCoord) * vec4(ourColor, 1.0);
+#else
+    color = texture(tex, TexCoord.xy) * vec4(ourColor, 1.0);
+#endif
+}
@@ -0,0 +1,20 @@
+#version 450
+
+// fixed locations of GeometryArena
+layout (location = 0) in vec3 position;
+layout (location = 2) in vec3 color;
+layout (location = 3) in vec2 texuv;
+// per instance
+layout (location = 4) in vec4 offsetScale;
+// rgb tints the quad, a is the atlas layer of its image
+layout (location = 5) in vec4 tint;
+
+out vec3 ourColor;
+out vec3 TexCoord;
+
+void main()
+{
+    gl_Position = vec4(position * offsetScale.w + offsetScale.xyz, 1.0);
+    ourColor = color * tint.rgb;
+    TexCoord = vec3(texuv, tint.a);
+}
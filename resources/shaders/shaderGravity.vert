@@ -1,8 +1,9 @@
 #version 450
 
-in vec3 position;
-in vec3 color;
-in float pointSize;
+// fixed locations: the VAO stays valid when the shader is hot reloaded
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 color;
+layout (location = 2) in float pointSize;
 
 out vec3 particle_color;
 
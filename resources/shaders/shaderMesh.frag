@@ -0,0 +1,13 @@
+#version 450
+
+in vec3 surfaceNormal;
+in vec3 surfaceTint;
+
+out vec4 color;
+
+void main()
+{
+    // lit from the viewer, both faces
+    float light = abs(normalize(surfaceNormal).z);
+    color = vec4(vec3(0.15 + 0.45 * light) * surfaceTint, 1.0);
+}
\ No newline at end of file
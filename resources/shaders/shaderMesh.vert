@@ -0,0 +1,18 @@
+#version 450
+
+// fixed locations of GeometryArena: the VAO stays valid when the shader is hot reloaded
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+// per instance
+layout (location = 4) in vec4 offsetScale;
+layout (location = 5) in vec4 tint;
+
+out vec3 surfaceNormal;
+out vec3 surfaceTint;
+
+void main()
+{
+    gl_Position = vec4(position * offsetScale.w + offsetScale.xyz, 1.0);
+    surfaceNormal = normal;
+    surfaceTint = tint.rgb;
+}
\ No newline at end of file
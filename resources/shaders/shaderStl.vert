@@ -1,15 +1,19 @@
 #version 450
 
-in vec3 position;
-in vec3 color;
-in vec2 texuv;
+// fixed locations of GeometryArena: the VAO stays valid when the shader is hot reloaded
+layout (location = 0) in vec3 position;
+layout (location = 2) in vec3 color;
+layout (location = 3) in vec2 texuv;
+// per instance
+layout (location = 4) in vec4 offsetScale;
+layout (location = 5) in vec4 tint;
 
 out vec3 ourColor;
 out vec2 TexCoord;
 
 void main()
 {
-    gl_Position = vec4(position, 1.0);
-    ourColor = color;
+    gl_Position = vec4(position * offsetScale.w + offsetScale.xyz, 1.0);
+    ourColor = color * tint.rgb;
     TexCoord = texuv;
 }
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include "assets.h"
+#include "mesh_cache.h"
+#include "profiler.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+static std::string ReadTextFile(const std::string &path)
+{
+	std::ifstream file(path.c_str(), std::ios::in);
+	if(!file.good())
+	{
+		throw std::runtime_error("File not found: " + path);
+	}
+
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
+
+AssetManager::AssetManager(unsigned threadCount)
+	: pool(threadCount), pending(0)
+{
+	// 8x8 magenta/grey checkerboard, obvious on screen while loading
+	unsigned char pixels[8 * 8 * 3];
+	for(int y = 0; y < 8; ++y)
+	{
+		for(int x = 0; x < 8; ++x)
+		{
+			const bool odd = ((x / 2) + (y / 2)) % 2 != 0;
+			unsigned char *p = pixels + 3 * (y * 8 + x);
+			p[0] = odd ? 255 : 128;
+			p[1] = odd ? 0 : 128;
+			p[2] = odd ? 255 : 128;
+		}
+	}
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &placeholderTexture);
+	glTextureStorage2D(placeholderTexture, 1, GL_RGB8, 8, 8);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTextureSubImage2D(placeholderTexture, 0, 0, 0, 8, 8, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTextureParameteri(placeholderTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glCreateVertexArrays(1, &emptyMesh.vao);
+}
+
+AssetManager::~AssetManager()
+{
+	for(auto &asset : assets)
+	{
+		if(asset.texture)
+		{
+			glDeleteTextures(1, &asset.texture);
+		}
+		if(asset.mesh.vao)
+		{
+			glDeleteVertexArrays(1, &asset.mesh.vao);
+			glDeleteBuffers(3, asset.mesh.buffers);
+		}
+	}
+
+	glDeleteTextures(1, &placeholderTexture);
+	glDeleteVertexArrays(1, &emptyMesh.vao);
+}
+
+AssetId AssetManager::Enqueue(Kind kind, const std::string &path, const TextureOptions &options)
+{
+	const AssetId id = AssetId(assets.size());
+	assets.emplace_back();
+	assets.back().kind = kind;
+	assets.back().path = path;
+	++pending;
+
+	// the task only sees copies: `assets` belongs to the render thread
+	pool.Submit([this, id, kind, path, options] {
+		Completion done;
+		done.id = id;
+
+		try
+		{
+			switch(kind)
+			{
+			case Kind::Texture: done.texture = LoadTextureCached(path.c_str(), options); break;
+			case Kind::Mesh: done.mesh = LoadMeshCached(path.c_str())->ToMesh(); break;
+			case Kind::ShaderSource: done.source = ReadTextFile(path); break;
+			}
+		}
+		catch(const std::exception &e)
+		{
+			done.error = e.what();
+		}
+
+		completions.Push(std::move(done));
+	});
+
+	return id;
+}
+
+AssetId AssetManager::LoadTexture(const std::string &path, const TextureOptions &options)
+{
+	return Enqueue(Kind::Texture, path, options);
+}
+
+AssetId AssetManager::LoadMesh(const std::string &path)
+{
+	return Enqueue(Kind::Mesh, path);
+}
+
+AssetId AssetManager::LoadShaderSource(const std::string &path)
+{
+	return Enqueue(Kind::ShaderSource, path);
+}
+
+void AssetManager::Upload(Completion &done)
+{
+	PROFILE_ZONE("AssetManager::Upload");
+	Asset &asset = assets[done.id];
+	--pending;
+
+	if(!done.error.empty())
+	{
+		std::cerr << "Asset " << asset.path << ": " << done.error << std::endl;
+		asset.state = AssetState::Failed;
+		return;
+	}
+
+	switch(asset.kind)
+	{
+	case Kind::Texture:
+		asset.texture = MakeTexture(*done.texture);
+		done.texture.reset();
+		break;
+
+	case Kind::Mesh:
+	{
+		GpuMesh &gpu = asset.mesh;
+		const auto &mesh = done.mesh;
+
+		glCreateBuffers(3, gpu.buffers);
+		glNamedBufferStorage(gpu.buffers[0], mesh.positions.size() * sizeof(glm::vec3), mesh.positions.data(), 0);
+		glNamedBufferStorage(gpu.buffers[1], mesh.normals.size() * sizeof(glm::vec3), mesh.normals.data(), 0);
+		glNamedBufferStorage(gpu.buffers[2], mesh.indices.size() * sizeof(uint32_t), mesh.indices.data(), 0);
+		AddProfileCounter(ProfileCounter::BytesUploaded, (mesh.positions.size() + mesh.normals.size()) * sizeof(glm::vec3)
+				+ mesh.indices.size() * sizeof(uint32_t));
+
+		glCreateVertexArrays(1, &gpu.vao);
+		for(GLuint attribute = 0; attribute < 2; ++attribute)
+		{
+			glVertexArrayVertexBuffer(gpu.vao, attribute, gpu.buffers[attribute], 0, sizeof(glm::vec3));
+			glVertexArrayAttribFormat(gpu.vao, attribute, 3, GL_FLOAT, GL_FALSE, 0);
+			glVertexArrayAttribBinding(gpu.vao, attribute, attribute);
+			glEnableVertexArrayAttrib(gpu.vao, attribute);
+		}
+		glVertexArrayElementBuffer(gpu.vao, gpu.buffers[2]);
+		gpu.indexCount = GLsizei(mesh.indices.size());
+		break;
+	}
+
+	case Kind::ShaderSource:
+		asset.source = std::move(done.source);
+		break;
+	}
+
+	asset.state = AssetState::Ready;
+}
+
+std::size_t AssetManager::Update()
+{
+	std::size_t uploaded = 0;
+
+	Completion done;
+	while(completions.TryPop(done))
+	{
+		Upload(done);
+		++uploaded;
+	}
+
+	return uploaded;
+}
+
+void AssetManager::Wait(AssetId id)
+{
+	while(assets[id].state == AssetState::Loading)
+	{
+		if(!Update())
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void AssetManager::WaitAll()
+{
+	while(pending > 0)
+	{
+		if(!Update())
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+GLuint AssetManager::Texture(AssetId id) const
+{
+	return assets[id].state == AssetState::Ready ? assets[id].texture : placeholderTexture;
+}
+
+GpuMesh AssetManager::Mesh(AssetId id) const
+{
+	return assets[id].state == AssetState::Ready ? assets[id].mesh : emptyMesh;
+}
+
+const std::string *AssetManager::ShaderSource(AssetId id) const
+{
+	return assets[id].state == AssetState::Ready ? &assets[id].source : nullptr;
+}
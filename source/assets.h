@@ -0,0 +1,114 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+#include "mpsc_queue.h"
+#include "texture_cache.h"
+#include "thread_pool.h"
+
+// GL side of a loaded mesh: attribute 0 is the position, 1 the normal
+struct GpuMesh
+{
+	GLuint vao = 0;
+	GLuint buffers[3] = {0, 0, 0};
+	GLsizei indexCount = 0;
+};
+
+typedef uint32_t AssetId;
+
+enum class AssetState
+{
+	Loading,
+	Ready,
+	Failed
+};
+
+// Loads textures, meshes and shader sources on background threads.
+// Requests return immediately with an id whose GL object is a placeholder
+// until Update(), on the render thread, uploads the decoded payload.
+// Every method must be called from the thread owning the GL context.
+class AssetManager
+{
+public:
+	// threadCount counts the render thread as in ThreadPool: 0 is one per core,
+	// the loads then keep one core for rendering; 1 loads within Load*
+	explicit AssetManager(unsigned threadCount = 0);
+	~AssetManager();
+
+	AssetManager(const AssetManager &) = delete;
+	AssetManager &operator=(const AssetManager &) = delete;
+
+	// .texcache-backed, every mip level uploaded
+	AssetId LoadTexture(const std::string &path, const TextureOptions &options = TextureOptions());
+	// .meshcache-backed STL/PLY
+	AssetId LoadMesh(const std::string &path);
+	AssetId LoadShaderSource(const std::string &path);
+
+	// Uploads the payloads finished since the last call, returns how many
+	std::size_t Update();
+
+	// Processes completions until the asset is no longer loading
+	void Wait(AssetId id);
+	void WaitAll();
+
+	AssetState State(AssetId id) const { return assets[id].state; }
+	std::size_t PendingCount() const { return pending; }
+
+	// Checkerboard placeholder until loaded, or if loading failed
+	GLuint Texture(AssetId id) const;
+	// Empty mesh (no index) until loaded. A copy of the GL names: the next
+	// Load* may move the assets
+	GpuMesh Mesh(AssetId id) const;
+	// nullptr until loaded, invalidated by the next Load*
+	const std::string *ShaderSource(AssetId id) const;
+
+private:
+	enum class Kind
+	{
+		Texture,
+		Mesh,
+		ShaderSource
+	};
+
+	struct Asset
+	{
+		Kind kind;
+		std::string path;
+		AssetState state = AssetState::Loading;
+
+		GLuint texture = 0;
+		GpuMesh mesh;
+		std::string source;
+	};
+
+	// CPU side result of a background load
+	struct Completion
+	{
+		AssetId id = 0;
+		std::string error;
+
+		std::unique_ptr<TextureCache> texture;
+		::Mesh mesh;
+		std::string source;
+	};
+
+	AssetId Enqueue(Kind kind, const std::string &path, const TextureOptions &options = TextureOptions());
+	void Upload(Completion &completion);
+
+	MpscQueue<Completion> completions;
+	// after the queue: destroyed first, its workers finish before the queue goes
+	ThreadPool pool;
+
+	std::vector<Asset> assets;
+	std::size_t pending;
+
+	GLuint placeholderTexture;
+	GpuMesh emptyMesh;
+};
@@ -0,0 +1,290 @@
+#include "atlas.h"
+#include "render_queue.h"
+
+#include <algorithm>
+#include <climits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+/* SKYLINE */
+
+SkylinePacker::SkylinePacker(int width, int height)
+	: width(width), height(height), usedArea(0), skyline{{0, 0, width}}
+{
+}
+
+bool SkylinePacker::Insert(int w, int h, AtlasRect &rect)
+{
+	std::size_t best = skyline.size();
+	int bestTop = INT_MAX, bestWaste = INT_MAX, bestY = 0;
+
+	for(std::size_t i = 0; i < skyline.size(); ++i)
+	{
+		const int x = skyline[i].x;
+		if(x + w > width)
+		{
+			break;
+		}
+
+		// the rectangle rests on the highest segment under it
+		int y = 0, waste = 0;
+		for(std::size_t j = i; j < skyline.size() && skyline[j].x < x + w; ++j)
+		{
+			y = std::max(y, skyline[j].y);
+		}
+		if(y + h > height)
+		{
+			continue;
+		}
+		for(std::size_t j = i; j < skyline.size() && skyline[j].x < x + w; ++j)
+		{
+			const int covered = std::min(x + w, skyline[j].x + skyline[j].width) - skyline[j].x;
+			waste += (y - skyline[j].y) * covered;
+		}
+
+		// lowest top first, then the least area lost under the rectangle
+		if(y + h < bestTop || (y + h == bestTop && waste < bestWaste))
+		{
+			best = i;
+			bestTop = y + h;
+			bestWaste = waste;
+			bestY = y;
+		}
+	}
+
+	if(best == skyline.size())
+	{
+		return false;
+	}
+
+	const int x = skyline[best].x;
+	rect = {x, bestY, w, h, 0};
+	usedArea += std::size_t(w) * h;
+
+	skyline.insert(skyline.begin() + best, Segment{x, bestY + h, w});
+
+	// the segments now under the rectangle shrink or go
+	std::size_t j = best + 1;
+	while(j < skyline.size() && skyline[j].x < x + w)
+	{
+		const int shrink = x + w - skyline[j].x;
+		if(shrink >= skyline[j].width)
+		{
+			skyline.erase(skyline.begin() + j);
+			continue;
+		}
+		skyline[j].x += shrink;
+		skyline[j].width -= shrink;
+		break;
+	}
+
+	for(std::size_t k = 0; k + 1 < skyline.size();)
+	{
+		if(skyline[k].y == skyline[k + 1].y)
+		{
+			skyline[k].width += skyline[k + 1].width;
+			skyline.erase(skyline.begin() + k + 1);
+		}
+		else
+		{
+			++k;
+		}
+	}
+
+	return true;
+}
+
+float SkylinePacker::Occupancy() const
+{
+	return float(usedArea) / (float(width) * float(height));
+}
+
+static int AlignUp(int value, int alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+static int AtlasAlignment(const AtlasOptions &options)
+{
+	return 1 << std::max(options.mipLevels - 1, 0);
+}
+
+int AtlasPadding(const AtlasOptions &options)
+{
+	return std::max(options.padding, AtlasAlignment(options));
+}
+
+int AtlasCellExtent(int extent, const AtlasOptions &options)
+{
+	return AlignUp(extent + 2 * AtlasPadding(options), AtlasAlignment(options));
+}
+
+std::vector<AtlasRect> PackRects(const std::vector<AtlasRect> &sizes, const AtlasOptions &options, int &layerCount)
+{
+	const int padding = AtlasPadding(options);
+
+	std::vector<std::size_t> order(sizes.size());
+	std::iota(order.begin(), order.end(), std::size_t(0));
+	std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+		if(sizes[a].height != sizes[b].height)
+		{
+			return sizes[a].height > sizes[b].height;
+		}
+		return sizes[a].width > sizes[b].width;
+	});
+
+	std::vector<SkylinePacker> layers;
+	std::vector<AtlasRect> rects(sizes.size());
+
+	for(const std::size_t i : order)
+	{
+		const int w = AtlasCellExtent(sizes[i].width, options);
+		const int h = AtlasCellExtent(sizes[i].height, options);
+		if(w > options.size || h > options.size)
+		{
+			throw std::runtime_error("Image of " + std::to_string(sizes[i].width) + "x" + std::to_string(sizes[i].height)
+					+ " does not fit a " + std::to_string(options.size) + " atlas layer");
+		}
+
+		AtlasRect cell;
+		int layer = 0;
+		while(layer < int(layers.size()) && !layers[layer].Insert(w, h, cell))
+		{
+			++layer;
+		}
+
+		if(layer == int(layers.size()))
+		{
+			if(layer == options.maxLayers)
+			{
+				throw std::runtime_error("Atlas needs more than " + std::to_string(options.maxLayers) + " layers");
+			}
+			layers.emplace_back(options.size, options.size);
+			layers.back().Insert(w, h, cell);
+		}
+
+		rects[i] = {cell.x + padding, cell.y + padding, sizes[i].width, sizes[i].height, layer};
+	}
+
+	layerCount = int(layers.size());
+	return rects;
+}
+
+/* ATLAS */
+
+Atlas BuildAtlas(const std::vector<const Image *> &images, const AtlasOptions &options)
+{
+	std::vector<AtlasRect> sizes;
+	sizes.reserve(images.size());
+	for(const Image *image : images)
+	{
+		if(image->channels < 1 || image->channels > 4)
+		{
+			throw std::runtime_error("Unsupported channel count: " + std::to_string(image->channels));
+		}
+		sizes.push_back({0, 0, image->width, image->height, 0});
+	}
+
+	Atlas atlas;
+	atlas.size = options.size;
+	const std::vector<AtlasRect> rects = PackRects(sizes, options, atlas.layers);
+
+	const int size = options.size;
+	const int padding = AtlasPadding(options);
+	std::vector<std::vector<unsigned char>> layers(atlas.layers, std::vector<unsigned char>(std::size_t(size) * size * 4, 0));
+
+	std::size_t imageTexels = 0;
+	for(std::size_t i = 0; i < images.size(); ++i)
+	{
+		const Image &image = *images[i];
+		const AtlasRect &rect = rects[i];
+		const int n = image.channels;
+		unsigned char *layer = layers[rect.layer].data();
+
+		// the image and its gutter, which repeats the edge texels
+		for(int y = -padding; y < rect.height + padding; ++y)
+		{
+			const int sy = std::min(std::max(y, 0), rect.height - 1);
+			for(int x = -padding; x < rect.width + padding; ++x)
+			{
+				const int sx = std::min(std::max(x, 0), rect.width - 1);
+				const unsigned char *p = image.data.get() + (std::size_t(sy) * image.width + sx) * n;
+				unsigned char *q = layer + (std::size_t(rect.y + y) * size + rect.x + x) * 4;
+				q[0] = p[0];
+				q[1] = n >= 3 ? p[1] : p[0];
+				q[2] = n >= 3 ? p[2] : p[0];
+				q[3] = n == 2 ? p[1] : n == 4 ? p[3] : 255;
+			}
+		}
+
+		atlas.regions.push_back({
+			{float(rect.x) / size, float(rect.y) / size},
+			{float(rect.x + rect.width) / size, float(rect.y + rect.height) / size},
+			rect.layer
+		});
+		imageTexels += std::size_t(rect.width) * rect.height;
+	}
+
+	for(const auto &layer : layers)
+	{
+		std::vector<MipLevel> chain = GenerateMipChain(layer.data(), size, size, 4, options.srgb);
+		chain.resize(std::min(chain.size(), std::size_t(std::max(options.mipLevels, 1))));
+		atlas.levels.push_back(std::move(chain));
+	}
+
+	atlas.efficiency = atlas.layers ? float(double(imageTexels) / (double(size) * size * atlas.layers)) : 0.0f;
+	return atlas;
+}
+
+GLuint MakeAtlasTexture(const Atlas &atlas)
+{
+	const GLenum internalFormat = GL_RGBA8;
+	const GLsizei levels = atlas.levels.empty() ? 1 : GLsizei(atlas.levels[0].size());
+
+	GLuint tex;
+	if(atlas.layers == 1)
+	{
+		glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+		glTextureStorage2D(tex, levels, internalFormat, atlas.size, atlas.size);
+	}
+	else
+	{
+		glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &tex);
+		glTextureStorage3D(tex, levels, internalFormat, atlas.size, atlas.size, atlas.layers);
+	}
+
+	for(int layer = 0; layer < atlas.layers; ++layer)
+	{
+		for(GLsizei l = 0; l < levels; ++l)
+		{
+			const MipLevel &level = atlas.levels[layer][l];
+			if(atlas.layers == 1)
+			{
+				glTextureSubImage2D(tex, l, 0, 0, level.width, level.height, GL_RGBA, GL_UNSIGNED_BYTE, level.rgba.data());
+			}
+			else
+			{
+				glTextureSubImage3D(tex, l, 0, 0, layer, level.width, level.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, level.rgba.data());
+			}
+		}
+	}
+
+	glTextureParameteri(tex, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(tex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(tex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	return tex;
+}
+
+void RemapQuadUVs(ArenaVertex *vertices, std::size_t vertexCount, const AtlasRegion &region)
+{
+	for(std::size_t v = 0; v < vertexCount; ++v)
+	{
+		glm::vec2 &uv = vertices[v].uv;
+		uv.x = region.uvMin[0] + uv.x * (region.uvMax[0] - region.uvMin[0]);
+		uv.y = region.uvMin[1] + uv.y * (region.uvMax[1] - region.uvMin[1]);
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "mipmap.h"
+#include "texture.h"
+
+struct AtlasOptions
+{
+	// width and height of every layer
+	int size = 2048;
+	// levels kept in the texture; images are aligned on 2^(mipLevels - 1)
+	// texels so no box filter footprint straddles two of them
+	int mipLevels = 4;
+	// gutter of repeated edge texels, at least 2^(mipLevels - 1) so every kept
+	// level still has one around each image
+	int padding = 8;
+	int maxLayers = 64;
+	// mips filtered in linear space, the levels stay sRGB encoded
+	bool srgb = true;
+};
+
+struct AtlasRect
+{
+	int x, y, width, height;
+	int layer;
+};
+
+// Skyline bottom-left packer for one layer
+class SkylinePacker
+{
+public:
+	SkylinePacker(int width, int height);
+
+	// Places a width x height rectangle, false when the layer is full
+	bool Insert(int width, int height, AtlasRect &rect);
+
+	// Fraction of the layer covered by inserted rectangles
+	float Occupancy() const;
+
+private:
+	struct Segment
+	{
+		int x, y, width;
+	};
+
+	int width, height;
+	std::size_t usedArea;
+	std::vector<Segment> skyline;
+};
+
+// Gutter actually used around every image, and the extent of its aligned cell
+int AtlasPadding(const AtlasOptions &options);
+int AtlasCellExtent(int extent, const AtlasOptions &options);
+
+// Places padded, aligned rectangles over as many layers as needed, tallest
+// first. The result is in the order of `sizes`; throws when maxLayers is not enough.
+std::vector<AtlasRect> PackRects(const std::vector<AtlasRect> &sizes, const AtlasOptions &options, int &layerCount);
+
+// Where an image landed, in the texture coordinates of its layer
+struct AtlasRegion
+{
+	float uvMin[2];
+	float uvMax[2];
+	int layer;
+};
+
+struct Atlas
+{
+	int size;
+	int layers;
+	// per layer, the mip chain truncated to AtlasOptions::mipLevels
+	std::vector<std::vector<MipLevel>> levels;
+	// UV remap table, in the order of the source images
+	std::vector<AtlasRegion> regions;
+	// texels of the source images over texels of all layers
+	float efficiency;
+};
+
+Atlas BuildAtlas(const std::vector<const Image *> &images, const AtlasOptions &options = AtlasOptions());
+
+// GL_TEXTURE_2D for a single layer, GL_TEXTURE_2D_ARRAY otherwise: shaderAtlas
+// samples the latter when built with ATLAS_LAYERS defined
+GLuint MakeAtlasTexture(const Atlas &atlas);
+
+struct ArenaVertex;
+
+// Maps the [0, 1] uv of `vertexCount` vertices into the region
+void RemapQuadUVs(ArenaVertex *vertices, std::size_t vertexCount, const AtlasRegion &region);
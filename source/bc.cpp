@@ -0,0 +1,595 @@
+#include "bc.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	// Principal axis of the block colours through a few power iterations,
+	// over the first `channels` components
+	template<int channels>
+	void PrincipalAxis(const float (&texels)[16][4], float (&mean)[4], float (&axis)[4])
+	{
+		for(int c = 0; c < 4; ++c)
+		{
+			mean[c] = 0.0f;
+			axis[c] = 0.0f;
+		}
+		for(const auto &t : texels)
+		{
+			for(int c = 0; c < channels; ++c)
+			{
+				mean[c] += t[c] / 16.0f;
+			}
+		}
+
+		float covariance[channels][channels] = {};
+		for(const auto &t : texels)
+		{
+			for(int i = 0; i < channels; ++i)
+			{
+				for(int j = 0; j < channels; ++j)
+				{
+					covariance[i][j] += (t[i] - mean[i]) * (t[j] - mean[j]);
+				}
+			}
+		}
+
+		float v[channels];
+		for(int c = 0; c < channels; ++c)
+		{
+			v[c] = 1.0f;
+		}
+
+		for(int iteration = 0; iteration < 8; ++iteration)
+		{
+			float w[channels] = {};
+			float length = 0.0f;
+			for(int i = 0; i < channels; ++i)
+			{
+				for(int j = 0; j < channels; ++j)
+				{
+					w[i] += covariance[i][j] * v[j];
+				}
+				length = std::max(length, std::fabs(w[i]));
+			}
+			if(length == 0.0f)
+			{
+				// flat block: any axis will do
+				return;
+			}
+			for(int c = 0; c < channels; ++c)
+			{
+				v[c] = w[c] / length;
+			}
+		}
+
+		float norm = 0.0f;
+		for(int c = 0; c < channels; ++c)
+		{
+			norm += v[c] * v[c];
+		}
+		norm = std::sqrt(norm);
+		for(int c = 0; c < channels; ++c)
+		{
+			axis[c] = v[c] / norm;
+		}
+	}
+
+	// Endpoints at the extreme projections of the texels on the axis
+	template<int channels>
+	void AxisEndpoints(const float (&texels)[16][4], float (&lo)[4], float (&hi)[4])
+	{
+		float mean[4], axis[4];
+		PrincipalAxis<channels>(texels, mean, axis);
+
+		float tmin = 0.0f, tmax = 0.0f;
+		for(const auto &t : texels)
+		{
+			float d = 0.0f;
+			for(int c = 0; c < channels; ++c)
+			{
+				d += (t[c] - mean[c]) * axis[c];
+			}
+			tmin = std::min(tmin, d);
+			tmax = std::max(tmax, d);
+		}
+
+		for(int c = 0; c < 4; ++c)
+		{
+			lo[c] = std::min(std::max(mean[c] + axis[c] * tmin, 0.0f), 255.0f);
+			hi[c] = std::min(std::max(mean[c] + axis[c] * tmax, 0.0f), 255.0f);
+		}
+	}
+
+	// Least squares endpoints for fixed interpolation weights (weight of hi in [0, 1])
+	template<int channels>
+	bool FitEndpoints(const float (&texels)[16][4], const float (&weights)[16], float (&lo)[4], float (&hi)[4])
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = {}, bx[4] = {};
+		for(int i = 0; i < 16; ++i)
+		{
+			const float b = weights[i];
+			const float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for(int c = 0; c < channels; ++c)
+			{
+				ax[c] += a * texels[i][c];
+				bx[c] += b * texels[i][c];
+			}
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if(std::fabs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+
+		for(int c = 0; c < channels; ++c)
+		{
+			lo[c] = std::min(std::max((ax[c] * bb - bx[c] * ab) / determinant, 0.0f), 255.0f);
+			hi[c] = std::min(std::max((bx[c] * aa - ax[c] * ab) / determinant, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	void ToFloat(const unsigned char *rgba, float (&texels)[16][4])
+	{
+		for(int i = 0; i < 16; ++i)
+		{
+			for(int c = 0; c < 4; ++c)
+			{
+				texels[i][c] = rgba[4 * i + c];
+			}
+		}
+	}
+
+	/* BC1 */
+
+	uint16_t To565(const float (&color)[4])
+	{
+		const int r = int(color[0] * 31.0f / 255.0f + 0.5f);
+		const int g = int(color[1] * 63.0f / 255.0f + 0.5f);
+		const int b = int(color[2] * 31.0f / 255.0f + 0.5f);
+		return uint16_t(r << 11 | g << 5 | b);
+	}
+
+	void From565(uint16_t c, int (&rgb)[3])
+	{
+		const int r = c >> 11 & 31, g = c >> 5 & 63, b = c & 31;
+		rgb[0] = r << 3 | r >> 2;
+		rgb[1] = g << 2 | g >> 4;
+		rgb[2] = b << 3 | b >> 2;
+	}
+
+	// Four-colour palette of a c0 > c1 block
+	void Bc1Palette(uint16_t c0, uint16_t c1, int (&palette)[4][3])
+	{
+		From565(c0, palette[0]);
+		From565(c1, palette[1]);
+		for(int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+	}
+
+	// Nearest palette entries, returns the squared error
+	int Bc1Indices(const float (&texels)[16][4], uint16_t c0, uint16_t c1, uint32_t &indices)
+	{
+		int palette[4][3];
+		Bc1Palette(c0, c1, palette);
+
+		int total = 0;
+		indices = 0;
+		for(int i = 0; i < 16; ++i)
+		{
+			int best = 0, bestError = 1 << 30;
+			for(int k = 0; k < 4; ++k)
+			{
+				int error = 0;
+				for(int c = 0; c < 3; ++c)
+				{
+					const int d = int(texels[i][c]) - palette[k][c];
+					error += d * d;
+				}
+				if(error < bestError)
+				{
+					bestError = error;
+					best = k;
+				}
+			}
+			indices |= uint32_t(best) << (2 * i);
+			total += bestError;
+		}
+		return total;
+	}
+
+	// Orders the endpoints for the four-colour mode, fixing the indices
+	void WriteBc1(uint16_t c0, uint16_t c1, uint32_t indices, unsigned char *block)
+	{
+		if(c0 < c1)
+		{
+			std::swap(c0, c1);
+			// 0 <-> 1 and 2 <-> 3
+			indices ^= 0x55555555u;
+		}
+		else if(c0 == c1)
+		{
+			indices = 0;
+		}
+
+		block[0] = (unsigned char)(c0 & 0xff);
+		block[1] = (unsigned char)(c0 >> 8);
+		block[2] = (unsigned char)(c1 & 0xff);
+		block[3] = (unsigned char)(c1 >> 8);
+		for(int i = 0; i < 4; ++i)
+		{
+			block[4 + i] = (unsigned char)(indices >> (8 * i));
+		}
+	}
+
+	/* BC7 */
+
+	const int bc7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+	// 7 bits per channel plus a p-bit shared by the four channels
+	struct Bc7Endpoint
+	{
+		int value[4];
+		int pbit;
+
+		int Expanded(int c) const { return value[c] << 1 | pbit; }
+	};
+
+	Bc7Endpoint QuantizeBc7(const float (&color)[4])
+	{
+		Bc7Endpoint best = {};
+		float bestError = 1e30f;
+		for(int p = 0; p < 2; ++p)
+		{
+			Bc7Endpoint e;
+			e.pbit = p;
+			float error = 0.0f;
+			for(int c = 0; c < 4; ++c)
+			{
+				e.value[c] = std::min(std::max(int((color[c] - p) / 2.0f + 0.5f), 0), 127);
+				const float d = float(e.Expanded(c)) - color[c];
+				error += d * d;
+			}
+			if(error < bestError)
+			{
+				bestError = error;
+				best = e;
+			}
+		}
+		return best;
+	}
+
+	int Bc7Indices(const float (&texels)[16][4], const Bc7Endpoint &e0, const Bc7Endpoint &e1, int (&indices)[16])
+	{
+		int palette[16][4];
+		for(int k = 0; k < 16; ++k)
+		{
+			for(int c = 0; c < 4; ++c)
+			{
+				palette[k][c] = ((64 - bc7Weights[k]) * e0.Expanded(c) + bc7Weights[k] * e1.Expanded(c) + 32) >> 6;
+			}
+		}
+
+		int total = 0;
+		for(int i = 0; i < 16; ++i)
+		{
+			int best = 0, bestError = 1 << 30;
+			for(int k = 0; k < 16; ++k)
+			{
+				int error = 0;
+				for(int c = 0; c < 4; ++c)
+				{
+					const int d = int(texels[i][c]) - palette[k][c];
+					error += d * d;
+				}
+				if(error < bestError)
+				{
+					bestError = error;
+					best = k;
+				}
+			}
+			indices[i] = best;
+			total += bestError;
+		}
+		return total;
+	}
+
+	// Little-endian bit stream over a 16-byte block
+	struct BitWriter
+	{
+		unsigned char *block;
+		int position = 0;
+
+		void Write(uint32_t value, int bits)
+		{
+			for(int i = 0; i < bits; ++i, ++position)
+			{
+				block[position >> 3] |= (unsigned char)((value >> i & 1) << (position & 7));
+			}
+		}
+	};
+
+	struct BitReader
+	{
+		const unsigned char *block;
+		int position = 0;
+
+		uint32_t Read(int bits)
+		{
+			uint32_t value = 0;
+			for(int i = 0; i < bits; ++i, ++position)
+			{
+				value |= uint32_t(block[position >> 3] >> (position & 7) & 1) << i;
+			}
+			return value;
+		}
+	};
+}
+
+const char *BlockFormatName(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? "BC1" : "BC7";
+}
+
+std::size_t BlockBytes(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+std::size_t CompressedSize(BlockFormat format, int width, int height)
+{
+	return std::size_t((width + 3) / 4) * std::size_t((height + 3) / 4) * BlockBytes(format);
+}
+
+void EncodeBc1Block(const unsigned char *rgba, unsigned char *block)
+{
+	float texels[16][4];
+	ToFloat(rgba, texels);
+
+	float lo[4], hi[4];
+	AxisEndpoints<3>(texels, lo, hi);
+
+	// c0 > c1 selects the four-colour mode
+	uint16_t c0 = std::max(To565(hi), To565(lo));
+	uint16_t c1 = std::min(To565(hi), To565(lo));
+	uint32_t indices;
+	int error = Bc1Indices(texels, c0, c1, indices);
+
+	// one refinement pass from the chosen indices
+	static const float weightOfC1[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+	float weights[16];
+	const bool ordered = c0 > c1;
+	for(int i = 0; i < 16; ++i)
+	{
+		weights[i] = ordered ? weightOfC1[indices >> (2 * i) & 3] : 0.0f;
+	}
+
+	float fit0[4], fit1[4];
+	if(ordered && FitEndpoints<3>(texels, weights, fit0, fit1))
+	{
+		const uint16_t r0 = To565(fit0), r1 = To565(fit1);
+		uint32_t refined;
+		const int refinedError = r0 != r1 ? Bc1Indices(texels, std::max(r0, r1), std::min(r0, r1), refined) : 1 << 30;
+		if(refinedError < error)
+		{
+			c0 = std::max(r0, r1);
+			c1 = std::min(r0, r1);
+			indices = refined;
+			error = refinedError;
+		}
+	}
+
+	WriteBc1(c0, c1, indices, block);
+}
+
+void DecodeBc1Block(const unsigned char *block, unsigned char *rgba)
+{
+	const uint16_t c0 = uint16_t(block[0] | block[1] << 8);
+	const uint16_t c1 = uint16_t(block[2] | block[3] << 8);
+	const uint32_t indices = uint32_t(block[4]) | uint32_t(block[5]) << 8 | uint32_t(block[6]) << 16 | uint32_t(block[7]) << 24;
+
+	int palette[4][4];
+	int rgb[4][3];
+	Bc1Palette(c0, c1, rgb);
+	for(int k = 0; k < 4; ++k)
+	{
+		std::copy(rgb[k], rgb[k] + 3, palette[k]);
+		palette[k][3] = 255;
+	}
+
+	if(c0 <= c1)
+	{
+		// three-colour mode with transparent black
+		for(int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (rgb[0][c] + rgb[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+		palette[3][3] = 0;
+	}
+
+	for(int i = 0; i < 16; ++i)
+	{
+		const int *p = palette[indices >> (2 * i) & 3];
+		for(int c = 0; c < 4; ++c)
+		{
+			rgba[4 * i + c] = (unsigned char)p[c];
+		}
+	}
+}
+
+void EncodeBc7Block(const unsigned char *rgba, unsigned char *block)
+{
+	float texels[16][4];
+	ToFloat(rgba, texels);
+
+	float lo[4], hi[4];
+	AxisEndpoints<4>(texels, lo, hi);
+
+	Bc7Endpoint e0 = QuantizeBc7(lo), e1 = QuantizeBc7(hi);
+	int indices[16];
+	int error = Bc7Indices(texels, e0, e1, indices);
+
+	float weights[16];
+	for(int i = 0; i < 16; ++i)
+	{
+		weights[i] = bc7Weights[indices[i]] / 64.0f;
+	}
+
+	float fit0[4], fit1[4];
+	if(FitEndpoints<4>(texels, weights, fit0, fit1))
+	{
+		const Bc7Endpoint r0 = QuantizeBc7(fit0), r1 = QuantizeBc7(fit1);
+		int refined[16];
+		const int refinedError = Bc7Indices(texels, r0, r1, refined);
+		if(refinedError < error)
+		{
+			e0 = r0;
+			e1 = r1;
+			std::copy(refined, refined + 16, indices);
+			error = refinedError;
+		}
+	}
+
+	// the anchor index is stored without its top bit: swap ends when it is set
+	if(indices[0] & 8)
+	{
+		std::swap(e0, e1);
+		for(auto &index : indices)
+		{
+			index = 15 - index;
+		}
+	}
+
+	std::memset(block, 0, 16);
+	BitWriter bits{block};
+	bits.Write(1 << 6, 7);
+	for(int c = 0; c < 4; ++c)
+	{
+		bits.Write(uint32_t(e0.value[c]), 7);
+		bits.Write(uint32_t(e1.value[c]), 7);
+	}
+	bits.Write(uint32_t(e0.pbit), 1);
+	bits.Write(uint32_t(e1.pbit), 1);
+	bits.Write(uint32_t(indices[0]), 3);
+	for(int i = 1; i < 16; ++i)
+	{
+		bits.Write(uint32_t(indices[i]), 4);
+	}
+}
+
+void DecodeBc7Block(const unsigned char *block, unsigned char *rgba)
+{
+	if((block[0] & 0x7f) != 0x40)
+	{
+		for(int i = 0; i < 16; ++i)
+		{
+			rgba[4 * i + 0] = 255;
+			rgba[4 * i + 1] = 0;
+			rgba[4 * i + 2] = 255;
+			rgba[4 * i + 3] = 255;
+		}
+		return;
+	}
+
+	BitReader bits{block, 7};
+	Bc7Endpoint e0, e1;
+	for(int c = 0; c < 4; ++c)
+	{
+		e0.value[c] = int(bits.Read(7));
+		e1.value[c] = int(bits.Read(7));
+	}
+	e0.pbit = int(bits.Read(1));
+	e1.pbit = int(bits.Read(1));
+
+	for(int i = 0; i < 16; ++i)
+	{
+		const int weight = bc7Weights[bits.Read(i == 0 ? 3 : 4)];
+		for(int c = 0; c < 4; ++c)
+		{
+			rgba[4 * i + c] = (unsigned char)(((64 - weight) * e0.Expanded(c) + weight * e1.Expanded(c) + 32) >> 6);
+		}
+	}
+}
+
+std::vector<unsigned char> CompressImage(const unsigned char *rgba, int width, int height, BlockFormat format, ThreadPool *pool)
+{
+	const int blocksX = (width + 3) / 4;
+	const int blocksY = (height + 3) / 4;
+	const std::size_t blockBytes = BlockBytes(format);
+	const auto encode = format == BlockFormat::BC1 ? EncodeBc1Block : EncodeBc7Block;
+
+	std::vector<unsigned char> blocks(CompressedSize(format, width, height));
+
+	const auto encodeRows = [&](std::size_t begin, std::size_t end) {
+		unsigned char texels[16 * 4];
+		for(std::size_t by = begin; by < end; ++by)
+		{
+			for(int bx = 0; bx < blocksX; ++bx)
+			{
+				for(int y = 0; y < 4; ++y)
+				{
+					const int sy = std::min(int(by) * 4 + y, height - 1);
+					for(int x = 0; x < 4; ++x)
+					{
+						const int sx = std::min(bx * 4 + x, width - 1);
+						std::memcpy(texels + 4 * (4 * y + x), rgba + 4 * (std::size_t(sy) * width + sx), 4);
+					}
+				}
+				encode(texels, &blocks[(by * blocksX + bx) * blockBytes]);
+			}
+		}
+	};
+
+	if(pool)
+	{
+		pool->ParallelFor(std::size_t(blocksY), 4, encodeRows);
+	}
+	else
+	{
+		encodeRows(0, std::size_t(blocksY));
+	}
+
+	return blocks;
+}
+
+std::vector<unsigned char> DecompressImage(const unsigned char *blocks, int width, int height, BlockFormat format)
+{
+	const int blocksX = (width + 3) / 4;
+	const int blocksY = (height + 3) / 4;
+	const std::size_t blockBytes = BlockBytes(format);
+	const auto decode = format == BlockFormat::BC1 ? DecodeBc1Block : DecodeBc7Block;
+
+	std::vector<unsigned char> rgba(std::size_t(width) * height * 4);
+	unsigned char texels[16 * 4];
+
+	for(int by = 0; by < blocksY; ++by)
+	{
+		for(int bx = 0; bx < blocksX; ++bx)
+		{
+			decode(blocks + (std::size_t(by) * blocksX + bx) * blockBytes, texels);
+			for(int y = 0; y < 4 && by * 4 + y < height; ++y)
+			{
+				for(int x = 0; x < 4 && bx * 4 + x < width; ++x)
+				{
+					std::memcpy(&rgba[4 * ((std::size_t(by) * 4 + y) * width + bx * 4 + x)], texels + 4 * (4 * y + x), 4);
+				}
+			}
+		}
+	}
+
+	return rgba;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class ThreadPool;
+
+// GPU block compression formats, both 4x4 texel blocks
+enum class BlockFormat
+{
+	BC1, // 8 bytes: two RGB565 endpoints and 2-bit indices, opaque
+	BC7  // 16 bytes: encoded in mode 6, RGBA endpoints and 4-bit indices
+};
+
+const char *BlockFormatName(BlockFormat format);
+std::size_t BlockBytes(BlockFormat format);
+std::size_t CompressedSize(BlockFormat format, int width, int height);
+
+// `rgba` is 16 texels in row order
+void EncodeBc1Block(const unsigned char *rgba, unsigned char *block);
+void EncodeBc7Block(const unsigned char *rgba, unsigned char *block);
+
+void DecodeBc1Block(const unsigned char *block, unsigned char *rgba);
+// Only mode 6, the one EncodeBc7Block writes; other modes decode to magenta
+void DecodeBc7Block(const unsigned char *block, unsigned char *rgba);
+
+// Compresses a whole RGBA8 image, rows of blocks spread over `pool` if any.
+// Partial blocks at the right and bottom edges repeat the last texels.
+std::vector<unsigned char> CompressImage(const unsigned char *rgba, int width, int height, BlockFormat format, ThreadPool *pool = nullptr);
+std::vector<unsigned char> DecompressImage(const unsigned char *blocks, int width, int height, BlockFormat format);
@@ -0,0 +1,924 @@
+#include "bvh.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BVH_SSE
+#endif
+
+namespace
+{
+	const float infinity = std::numeric_limits<float>::infinity();
+
+	// deeper than this, nodes are split at the median: traversal stacks stay bounded
+	const unsigned maxSahDepth = 48;
+	const int stackSize = 256;
+
+	// ranges larger than this are binned and bounded on the pool
+	const std::size_t parallelRange = 64 * 1024;
+
+	struct Box
+	{
+		glm::vec3 min = glm::vec3(infinity);
+		glm::vec3 max = glm::vec3(-infinity);
+
+		void Grow(const glm::vec3 &p)
+		{
+			min = glm::min(min, p);
+			max = glm::max(max, p);
+		}
+
+		void Grow(const Box &b)
+		{
+			min = glm::min(min, b.min);
+			max = glm::max(max, b.max);
+		}
+
+		float Area() const
+		{
+			const glm::vec3 e = max - min;
+			return e.x < 0.0f ? 0.0f : 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+		}
+	};
+
+	struct Bin
+	{
+		Box box;
+		uint32_t count = 0;
+	};
+
+	class Builder
+	{
+	public:
+		Builder(const std::vector<Triangle> &triangles, ThreadPool *pool, const BvhOptions &options)
+			: pool(pool), options(options), boxes(triangles.size()), centroids(triangles.size()), indices(triangles.size())
+		{
+			for(std::size_t i = 0; i < triangles.size(); ++i)
+			{
+				const Triangle &t = triangles[i];
+				boxes[i].Grow(t.p0);
+				boxes[i].Grow(t.p1);
+				boxes[i].Grow(t.p2);
+				centroids[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+				indices[i] = uint32_t(i);
+			}
+		}
+
+		// Bounds of the triangles of the range and of their centroids
+		void Bounds(std::size_t begin, std::size_t end, Box &box, Box &centroidBox) const
+		{
+			box = Box();
+			centroidBox = Box();
+			if(!pool || end - begin < parallelRange)
+			{
+				for(std::size_t k = begin; k < end; ++k)
+				{
+					box.Grow(boxes[indices[k]]);
+					centroidBox.Grow(centroids[indices[k]]);
+				}
+				return;
+			}
+
+			std::mutex mutex;
+			pool->ParallelFor(end - begin, parallelRange / 4, [&](std::size_t first, std::size_t last) {
+				Box b, c;
+				for(std::size_t k = begin + first; k < begin + last; ++k)
+				{
+					b.Grow(boxes[indices[k]]);
+					c.Grow(centroids[indices[k]]);
+				}
+				std::lock_guard<std::mutex> lock(mutex);
+				box.Grow(b);
+				centroidBox.Grow(c);
+			});
+		}
+
+		// First triangle of the right child, or `begin` when the range is best left a leaf
+		std::size_t Partition(std::size_t begin, std::size_t end, const Box &box, const Box &centroidBox, unsigned depth)
+		{
+			const std::size_t count = end - begin;
+			if(count <= 1)
+			{
+				return begin;
+			}
+
+			const glm::vec3 extent = centroidBox.max - centroidBox.min;
+			const std::size_t mid = begin + count / 2;
+
+			if(depth >= maxSahDepth || (extent.x <= 0.0f && extent.y <= 0.0f && extent.z <= 0.0f))
+			{
+				if(count <= options.maxLeafSize)
+				{
+					return begin;
+				}
+				// no better split: halves, along the longest axis
+				const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+				std::nth_element(indices.begin() + begin, indices.begin() + mid, indices.begin() + end,
+						[&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+				return mid;
+			}
+
+			const unsigned binCount = std::max(options.bins, 2u);
+			std::vector<Bin> bins(3 * binCount);
+			BinRange(begin, end, centroidBox, binCount, bins);
+
+			// sweep: cost of splitting before bin b = left area * left count + right area * right count
+			float bestCost = infinity;
+			int bestAxis = -1;
+			unsigned bestBin = 0;
+			std::vector<float> rightCost(binCount);
+
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				if(extent[axis] <= 0.0f)
+				{
+					continue;
+				}
+				const Bin *axisBins = &bins[axis * binCount];
+
+				Box right;
+				uint32_t rightCount = 0;
+				for(unsigned b = binCount - 1; b > 0; --b)
+				{
+					right.Grow(axisBins[b].box);
+					rightCount += axisBins[b].count;
+					rightCost[b] = right.Area() * float(rightCount);
+				}
+
+				Box left;
+				uint32_t leftCount = 0;
+				for(unsigned b = 1; b < binCount; ++b)
+				{
+					left.Grow(axisBins[b - 1].box);
+					leftCount += axisBins[b - 1].count;
+					if(leftCount == 0 || leftCount == count)
+					{
+						continue;
+					}
+					const float cost = left.Area() * float(leftCount) + rightCost[b];
+					if(cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestBin = b;
+					}
+				}
+			}
+
+			// one traversal step against one triangle test per triangle
+			const float area = box.Area();
+			const float splitCost = 1.0f + (area > 0.0f ? bestCost / area : 0.0f);
+			if(count <= options.maxLeafSize && float(count) <= splitCost)
+			{
+				return begin;
+			}
+
+			if(bestAxis < 0)
+			{
+				std::nth_element(indices.begin() + begin, indices.begin() + mid, indices.begin() + end);
+				return mid;
+			}
+
+			const float scale = float(binCount) / extent[bestAxis];
+			const float origin = centroidBox.min[bestAxis];
+			const auto split = std::partition(indices.begin() + begin, indices.begin() + end, [&](uint32_t i) {
+				return BinOf(centroids[i][bestAxis], origin, scale, binCount) < bestBin;
+			});
+			return std::size_t(split - indices.begin());
+		}
+
+		void BuildSubtree(std::size_t begin, std::size_t end, const Box &box, const Box &centroidBox, unsigned depth, std::vector<BvhNode> &out)
+		{
+			const std::size_t index = out.size();
+			out.push_back(MakeNode(box));
+
+			const std::size_t mid = Partition(begin, end, box, centroidBox, depth);
+			if(mid == begin)
+			{
+				out[index].offset = uint32_t(begin);
+				out[index].count = uint32_t(end - begin);
+				return;
+			}
+
+			Box childBox, childCentroids;
+			Bounds(begin, mid, childBox, childCentroids);
+			BuildSubtree(begin, mid, childBox, childCentroids, depth + 1, out);
+
+			out[index].offset = uint32_t(out.size());
+			Bounds(mid, end, childBox, childCentroids);
+			BuildSubtree(mid, end, childBox, childCentroids, depth + 1, out);
+		}
+
+		static BvhNode MakeNode(const Box &box)
+		{
+			return {{box.min.x, box.min.y, box.min.z}, 0, {box.max.x, box.max.y, box.max.z}, 0};
+		}
+
+		ThreadPool *pool;
+		const BvhOptions options;
+
+		std::vector<Box> boxes;
+		std::vector<glm::vec3> centroids;
+		std::vector<uint32_t> indices;
+
+	private:
+		static unsigned BinOf(float c, float origin, float scale, unsigned binCount)
+		{
+			const int b = int((c - origin) * scale);
+			return unsigned(std::min(std::max(b, 0), int(binCount) - 1));
+		}
+
+		void BinRange(std::size_t begin, std::size_t end, const Box &centroidBox, unsigned binCount, std::vector<Bin> &bins) const
+		{
+			const glm::vec3 extent = centroidBox.max - centroidBox.min;
+			float scale[3];
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				scale[axis] = extent[axis] > 0.0f ? float(binCount) / extent[axis] : 0.0f;
+			}
+
+			const auto binChunk = [&](std::size_t first, std::size_t last, std::vector<Bin> &out) {
+				for(std::size_t k = first; k < last; ++k)
+				{
+					const uint32_t i = indices[k];
+					for(int axis = 0; axis < 3; ++axis)
+					{
+						Bin &bin = out[axis * binCount + BinOf(centroids[i][axis], centroidBox.min[axis], scale[axis], binCount)];
+						bin.box.Grow(boxes[i]);
+						++bin.count;
+					}
+				}
+			};
+
+			if(!pool || end - begin < parallelRange)
+			{
+				binChunk(begin, end, bins);
+				return;
+			}
+
+			std::mutex mutex;
+			pool->ParallelFor(end - begin, parallelRange / 4, [&](std::size_t first, std::size_t last) {
+				std::vector<Bin> local(bins.size());
+				binChunk(begin + first, begin + last, local);
+
+				std::lock_guard<std::mutex> lock(mutex);
+				for(std::size_t b = 0; b < bins.size(); ++b)
+				{
+					bins[b].box.Grow(local[b].box);
+					bins[b].count += local[b].count;
+				}
+			});
+		}
+	};
+
+	// The levels above the subtrees built in parallel
+	struct TopNode
+	{
+		Box box;
+		int left = -1, right = -1;
+		int task = -1;
+	};
+
+	struct SubtreeTask
+	{
+		std::size_t begin, end;
+		Box box, centroidBox;
+		unsigned depth;
+		std::vector<BvhNode> nodes;
+	};
+
+	int Plan(Builder &builder, std::size_t begin, std::size_t end, const Box &box, const Box &centroidBox, unsigned depth,
+			std::size_t threshold, std::vector<TopNode> &tops, std::vector<SubtreeTask> &tasks)
+	{
+		const int index = int(tops.size());
+		tops.emplace_back();
+		tops[index].box = box;
+
+		const std::size_t mid = end - begin > threshold ? builder.Partition(begin, end, box, centroidBox, depth) : begin;
+		if(mid == begin)
+		{
+			tops[index].task = int(tasks.size());
+			tasks.push_back({begin, end, box, centroidBox, depth, {}});
+			return index;
+		}
+
+		Box childBox, childCentroids;
+		builder.Bounds(begin, mid, childBox, childCentroids);
+		const int left = Plan(builder, begin, mid, childBox, childCentroids, depth + 1, threshold, tops, tasks);
+		builder.Bounds(mid, end, childBox, childCentroids);
+		const int right = Plan(builder, mid, end, childBox, childCentroids, depth + 1, threshold, tops, tasks);
+
+		tops[index].left = left;
+		tops[index].right = right;
+		return index;
+	}
+
+	void Emit(const std::vector<TopNode> &tops, const std::vector<SubtreeTask> &tasks, int top, std::vector<BvhNode> &out)
+	{
+		const TopNode &node = tops[top];
+		if(node.task >= 0)
+		{
+			// subtree offsets are relative to its own first node
+			const uint32_t base = uint32_t(out.size());
+			for(BvhNode n : tasks[node.task].nodes)
+			{
+				if(n.count == 0)
+				{
+					n.offset += base;
+				}
+				out.push_back(n);
+			}
+			return;
+		}
+
+		const std::size_t index = out.size();
+		out.push_back(Builder::MakeNode(node.box));
+		Emit(tops, tasks, node.left, out);
+		out[index].offset = uint32_t(out.size());
+		Emit(tops, tasks, node.right, out);
+	}
+
+	Box NodeBox(const BvhNode &n)
+	{
+		Box b;
+		b.min = glm::vec3(n.min[0], n.min[1], n.min[2]);
+		b.max = glm::vec3(n.max[0], n.max[1], n.max[2]);
+		return b;
+	}
+
+	// Slab test, entry distance in `entry`
+	bool HitBox(const BvhNode &n, const glm::vec3 &origin, const glm::vec3 &inverse, float maxT, float &entry)
+	{
+		float tmin = 0.0f, tmax = maxT;
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			const float t1 = (n.min[axis] - origin[axis]) * inverse[axis];
+			const float t2 = (n.max[axis] - origin[axis]) * inverse[axis];
+			tmin = std::max(tmin, std::min(t1, t2));
+			tmax = std::min(tmax, std::max(t1, t2));
+		}
+		entry = tmin;
+		return tmin <= tmax;
+	}
+
+	// Möller-Trumbore
+	bool HitTriangle(const Triangle &tri, const glm::vec3 &origin, const glm::vec3 &direction, float maxT, float &t, float &u, float &v)
+	{
+		const glm::vec3 e1 = tri.p1 - tri.p0;
+		const glm::vec3 e2 = tri.p2 - tri.p0;
+		const glm::vec3 p = glm::cross(direction, e2);
+		const float det = glm::dot(e1, p);
+		if(det == 0.0f)
+		{
+			return false;
+		}
+
+		const float inverse = 1.0f / det;
+		const glm::vec3 s = origin - tri.p0;
+		u = glm::dot(s, p) * inverse;
+		if(u < 0.0f || u > 1.0f)
+		{
+			return false;
+		}
+
+		const glm::vec3 q = glm::cross(s, e1);
+		v = glm::dot(direction, q) * inverse;
+		if(v < 0.0f || u + v > 1.0f)
+		{
+			return false;
+		}
+
+		t = glm::dot(e2, q) * inverse;
+		return t >= 0.0f && t <= maxT;
+	}
+
+	glm::vec3 Normal(const Triangle &tri)
+	{
+		const glm::vec3 n = glm::cross(tri.p1 - tri.p0, tri.p2 - tri.p0);
+		const float length = glm::length(n);
+		return length > 0.0f ? n / length : glm::vec3(0.0f);
+	}
+
+	// Ericson, "Real-Time Collision Detection", 5.1.5
+	glm::vec3 ClosestPointOnTriangle(const glm::vec3 &p, const Triangle &tri)
+	{
+		const glm::vec3 &a = tri.p0, &b = tri.p1, &c = tri.p2;
+		const glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+
+		const float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if(d1 <= 0.0f && d2 <= 0.0f)
+		{
+			return a;
+		}
+
+		const glm::vec3 bp = p - b;
+		const float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if(d3 >= 0.0f && d4 <= d3)
+		{
+			return b;
+		}
+
+		const float vc = d1 * d4 - d3 * d2;
+		if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		{
+			return a + ab * (d1 / (d1 - d3));
+		}
+
+		const glm::vec3 cp = p - c;
+		const float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if(d6 >= 0.0f && d5 <= d6)
+		{
+			return c;
+		}
+
+		const float vb = d5 * d2 - d1 * d6;
+		if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		{
+			return a + ac * (d2 / (d2 - d6));
+		}
+
+		const float va = d3 * d6 - d5 * d4;
+		if(va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+		{
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+		}
+
+		const float denominator = 1.0f / (va + vb + vc);
+		return a + ab * (vb * denominator) + ac * (vc * denominator);
+	}
+
+	float BoxDistance2(const BvhNode &n, const glm::vec3 &p)
+	{
+		float d2 = 0.0f;
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			const float d = std::max(std::max(n.min[axis] - p[axis], 0.0f), p[axis] - n.max[axis]);
+			d2 += d * d;
+		}
+		return d2;
+	}
+}
+
+Bvh::Bvh(const std::vector<Triangle> &input, ThreadPool *pool, const BvhOptions &options)
+{
+	PROFILE_ZONE("Bvh::Bvh");
+	if(input.empty())
+	{
+		return;
+	}
+
+	Builder builder(input, pool, options);
+	Box box, centroidBox;
+	builder.Bounds(0, input.size(), box, centroidBox);
+
+	// the upper levels split on the calling thread (binning in parallel),
+	// leaving a few subtrees per thread
+	const std::size_t threshold = pool && pool->ThreadCount() > 1
+			? std::max<std::size_t>(4096, input.size() / (pool->ThreadCount() * 4))
+			: input.size();
+
+	std::vector<TopNode> tops;
+	std::vector<SubtreeTask> tasks;
+	Plan(builder, 0, input.size(), box, centroidBox, 0, threshold, tops, tasks);
+
+	const auto buildTasks = [&](std::size_t begin, std::size_t end) {
+		for(std::size_t t = begin; t < end; ++t)
+		{
+			SubtreeTask &task = tasks[t];
+			builder.BuildSubtree(task.begin, task.end, task.box, task.centroidBox, task.depth, task.nodes);
+		}
+	};
+	if(pool)
+	{
+		pool->ParallelFor(tasks.size(), 1, buildTasks);
+	}
+	else
+	{
+		buildTasks(0, tasks.size());
+	}
+
+	nodes.reserve(input.size() * 2 / std::max(options.maxLeafSize, 1u) + 1);
+	Emit(tops, tasks, 0, nodes);
+	nodes.shrink_to_fit();
+
+	triangles.resize(input.size());
+	ids = std::move(builder.indices);
+	for(std::size_t k = 0; k < ids.size(); ++k)
+	{
+		triangles[k] = input[ids[k]];
+	}
+}
+
+glm::vec3 Bvh::Min() const
+{
+	return nodes.empty() ? glm::vec3(0.0f) : glm::vec3(nodes[0].min[0], nodes[0].min[1], nodes[0].min[2]);
+}
+
+glm::vec3 Bvh::Max() const
+{
+	return nodes.empty() ? glm::vec3(0.0f) : glm::vec3(nodes[0].max[0], nodes[0].max[1], nodes[0].max[2]);
+}
+
+float Bvh::SahCost() const
+{
+	if(nodes.empty())
+	{
+		return 0.0f;
+	}
+
+	float cost = 0.0f;
+	for(const BvhNode &n : nodes)
+	{
+		cost += NodeBox(n).Area() * (n.count ? float(n.count) : 1.0f);
+	}
+	const float root = NodeBox(nodes[0]).Area();
+	return root > 0.0f ? cost / root : 0.0f;
+}
+
+unsigned Bvh::Depth() const
+{
+	if(nodes.empty())
+	{
+		return 0;
+	}
+
+	unsigned depth = 0;
+	std::vector<std::pair<uint32_t, unsigned>> stack = {{0, 1}};
+	while(!stack.empty())
+	{
+		const auto top = stack.back();
+		stack.pop_back();
+		depth = std::max(depth, top.second);
+
+		const BvhNode &n = nodes[top.first];
+		if(n.count == 0)
+		{
+			stack.push_back({top.first + 1, top.second + 1});
+			stack.push_back({n.offset, top.second + 1});
+		}
+	}
+	return depth;
+}
+
+bool Bvh::Raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxT, RayHit &hit) const
+{
+	float entry;
+	const glm::vec3 inverse = glm::vec3(1.0f) / direction;
+	if(nodes.empty() || !HitBox(nodes[0], origin, inverse, maxT, entry))
+	{
+		return false;
+	}
+
+	bool found = false;
+	float best = maxT;
+	uint32_t closest = 0;
+
+	// far children wait on the stack with their entry distance
+	uint32_t stack[stackSize];
+	float stackEntry[stackSize];
+	int top = 0;
+	uint32_t node = 0;
+
+	for(;;)
+	{
+		const BvhNode &n = nodes[node];
+		if(n.count > 0)
+		{
+			for(uint32_t k = n.offset; k < n.offset + n.count; ++k)
+			{
+				float t, u, v;
+				if(HitTriangle(triangles[k], origin, direction, best, t, u, v))
+				{
+					best = t;
+					hit = {t, ids[k], u, v, glm::vec3(0.0f)};
+					closest = k;
+					found = true;
+				}
+			}
+		}
+		else
+		{
+			uint32_t near = node + 1, far = n.offset;
+			float nearEntry, farEntry;
+			const bool hitNear = HitBox(nodes[near], origin, inverse, best, nearEntry);
+			const bool hitFar = HitBox(nodes[far], origin, inverse, best, farEntry);
+
+			if(hitNear && hitFar)
+			{
+				if(farEntry < nearEntry)
+				{
+					std::swap(near, far);
+					std::swap(nearEntry, farEntry);
+				}
+				stack[top] = far;
+				stackEntry[top++] = farEntry;
+				node = near;
+				continue;
+			}
+			if(hitNear || hitFar)
+			{
+				node = hitNear ? near : far;
+				continue;
+			}
+		}
+
+		// next node still in front of the closest hit
+		do
+		{
+			if(top == 0)
+			{
+				if(found)
+				{
+					hit.normal = Normal(triangles[closest]);
+				}
+				return found;
+			}
+			--top;
+		}
+		while(stackEntry[top] > best);
+		node = stack[top];
+	}
+}
+
+bool Bvh::Segment(const glm::vec3 &a, const glm::vec3 &b, RayHit &hit) const
+{
+	return Raycast(a, b - a, 1.0f, hit);
+}
+
+bool Bvh::ClosestPoint(const glm::vec3 &center, float radius, SphereContact &contact) const
+{
+	if(nodes.empty() || BoxDistance2(nodes[0], center) > radius * radius)
+	{
+		return false;
+	}
+
+	bool found = false;
+	float best2 = radius * radius;
+
+	uint32_t stack[stackSize];
+	float stackDistance[stackSize];
+	int top = 0;
+	uint32_t node = 0;
+
+	for(;;)
+	{
+		const BvhNode &n = nodes[node];
+		if(n.count > 0)
+		{
+			for(uint32_t k = n.offset; k < n.offset + n.count; ++k)
+			{
+				const glm::vec3 p = ClosestPointOnTriangle(center, triangles[k]);
+				const glm::vec3 d = p - center;
+				const float d2 = glm::dot(d, d);
+				if(d2 <= best2)
+				{
+					best2 = d2;
+					contact = {ids[k], p, 0.0f};
+					found = true;
+				}
+			}
+		}
+		else
+		{
+			uint32_t near = node + 1, far = n.offset;
+			float nearDistance = BoxDistance2(nodes[near], center);
+			float farDistance = BoxDistance2(nodes[far], center);
+			if(farDistance < nearDistance)
+			{
+				std::swap(near, far);
+				std::swap(nearDistance, farDistance);
+			}
+
+			if(nearDistance <= best2)
+			{
+				if(farDistance <= best2)
+				{
+					stack[top] = far;
+					stackDistance[top++] = farDistance;
+				}
+				node = near;
+				continue;
+			}
+		}
+
+		do
+		{
+			if(top == 0)
+			{
+				if(found)
+				{
+					contact.distance = std::sqrt(best2);
+				}
+				return found;
+			}
+			--top;
+		}
+		while(stackDistance[top] > best2);
+		node = stack[top];
+	}
+}
+
+/* BVH4 */
+
+Bvh4::Bvh4(const Bvh &bvh)
+	: bvh(bvh)
+{
+	if(!bvh.Nodes().empty())
+	{
+		nodes.reserve(bvh.Nodes().size() / 2 + 1);
+		Collapse(0);
+	}
+}
+
+uint32_t Bvh4::Collapse(uint32_t node)
+{
+	const auto &binary = bvh.Nodes();
+
+	// open the largest interior children until there are four
+	uint32_t children[4];
+	int childCount = 0;
+	if(binary[node].count > 0)
+	{
+		children[childCount++] = node;
+	}
+	else
+	{
+		children[childCount++] = node + 1;
+		children[childCount++] = binary[node].offset;
+	}
+
+	while(childCount < 4)
+	{
+		int largest = -1;
+		float largestArea = -1.0f;
+		for(int c = 0; c < childCount; ++c)
+		{
+			const BvhNode &n = binary[children[c]];
+			if(n.count == 0 && NodeBox(n).Area() > largestArea)
+			{
+				largest = c;
+				largestArea = NodeBox(n).Area();
+			}
+		}
+		if(largest < 0)
+		{
+			break;
+		}
+
+		const uint32_t opened = children[largest];
+		children[largest] = opened + 1;
+		children[childCount++] = binary[opened].offset;
+	}
+
+	const uint32_t index = uint32_t(nodes.size());
+	nodes.emplace_back();
+	for(int c = 0; c < 4; ++c)
+	{
+		// a box at infinity is never hit, whatever the ray direction
+		Bvh4Node &out = nodes[index];
+		out.minX[c] = out.minY[c] = out.minZ[c] = infinity;
+		out.maxX[c] = out.maxY[c] = out.maxZ[c] = infinity;
+		out.child[c] = 0;
+		out.count[c] = 0;
+	}
+
+	for(int c = 0; c < childCount; ++c)
+	{
+		const BvhNode &n = binary[children[c]];
+		const uint32_t child = n.count > 0 ? n.offset : Collapse(children[c]);
+
+		Bvh4Node &out = nodes[index];
+		out.minX[c] = n.min[0];
+		out.minY[c] = n.min[1];
+		out.minZ[c] = n.min[2];
+		out.maxX[c] = n.max[0];
+		out.maxY[c] = n.max[1];
+		out.maxZ[c] = n.max[2];
+		out.child[c] = child;
+		out.count[c] = n.count;
+	}
+
+	return index;
+}
+
+bool Bvh4::Raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxT, RayHit &hit) const
+{
+	if(nodes.empty())
+	{
+		return false;
+	}
+
+	const glm::vec3 inverse = glm::vec3(1.0f) / direction;
+	const auto &triangles = bvh.Triangles();
+	bool found = false;
+	float best = maxT;
+	uint32_t closest = 0;
+
+	uint32_t stack[stackSize];
+	float stackEntry[stackSize];
+	int top = 0;
+	stack[top] = 0;
+	stackEntry[top++] = 0.0f;
+
+#ifdef BVH_SSE
+	const __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+	const __m128 ix = _mm_set1_ps(inverse.x), iy = _mm_set1_ps(inverse.y), iz = _mm_set1_ps(inverse.z);
+#endif
+
+	while(top > 0)
+	{
+		--top;
+		if(stackEntry[top] > best)
+		{
+			continue;
+		}
+		const Bvh4Node &n = nodes[stack[top]];
+
+		// the four slab tests at once
+		alignas(16) float entry[4];
+		int mask = 0;
+#ifdef BVH_SSE
+		const __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(n.minX), ox), ix);
+		const __m128 x2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(n.maxX), ox), ix);
+		const __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(n.minY), oy), iy);
+		const __m128 y2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(n.maxY), oy), iy);
+		const __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(n.minZ), oz), iz);
+		const __m128 z2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(n.maxZ), oz), iz);
+
+		__m128 tmin = _mm_max_ps(_mm_max_ps(_mm_min_ps(x1, x2), _mm_min_ps(y1, y2)), _mm_max_ps(_mm_min_ps(z1, z2), _mm_setzero_ps()));
+		__m128 tmax = _mm_min_ps(_mm_min_ps(_mm_max_ps(x1, x2), _mm_max_ps(y1, y2)), _mm_min_ps(_mm_max_ps(z1, z2), _mm_set1_ps(best)));
+		mask = _mm_movemask_ps(_mm_cmple_ps(tmin, tmax));
+		_mm_store_ps(entry, tmin);
+#else
+		for(int c = 0; c < 4; ++c)
+		{
+			const float x1 = (n.minX[c] - origin.x) * inverse.x, x2 = (n.maxX[c] - origin.x) * inverse.x;
+			const float y1 = (n.minY[c] - origin.y) * inverse.y, y2 = (n.maxY[c] - origin.y) * inverse.y;
+			const float z1 = (n.minZ[c] - origin.z) * inverse.z, z2 = (n.maxZ[c] - origin.z) * inverse.z;
+			const float tmin = std::max(std::max(std::min(x1, x2), std::min(y1, y2)), std::max(std::min(z1, z2), 0.0f));
+			const float tmax = std::min(std::min(std::max(x1, x2), std::max(y1, y2)), std::min(std::max(z1, z2), best));
+			entry[c] = tmin;
+			mask |= tmin <= tmax ? 1 << c : 0;
+		}
+#endif
+
+		// leaves now, interior children pushed farthest first
+		int order[4];
+		int pushed = 0;
+		for(int c = 0; c < 4; ++c)
+		{
+			if(!(mask & (1 << c)))
+			{
+				continue;
+			}
+			if(n.count[c] > 0)
+			{
+				for(uint32_t k = n.child[c]; k < n.child[c] + n.count[c]; ++k)
+				{
+					float t, u, v;
+					if(HitTriangle(triangles[k], origin, direction, best, t, u, v))
+					{
+						best = t;
+						hit = {t, bvh.TriangleId(k), u, v, glm::vec3(0.0f)};
+						closest = k;
+						found = true;
+					}
+				}
+				continue;
+			}
+
+			int at = pushed++;
+			while(at > 0 && entry[order[at - 1]] < entry[c])
+			{
+				order[at] = order[at - 1];
+				--at;
+			}
+			order[at] = c;
+		}
+
+		for(int p = 0; p < pushed; ++p)
+		{
+			stack[top] = n.child[order[p]];
+			stackEntry[top++] = entry[order[p]];
+		}
+	}
+
+	if(found)
+	{
+		hit.normal = Normal(triangles[closest]);
+	}
+	return found;
+}
+
+bool Bvh4::Segment(const glm::vec3 &a, const glm::vec3 &b, RayHit &hit) const
+{
+	return Raycast(a, b - a, 1.0f, hit);
+}
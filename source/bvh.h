@@ -0,0 +1,121 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "aligned.h"
+#include "stl.h"
+
+class ThreadPool;
+
+// 32 bytes, two per cache line. Interior nodes (count == 0) have their left
+// child right after them (depth-first order) and the right one at `offset`;
+// leaves hold `count` triangles from `offset`.
+struct BvhNode
+{
+	float min[3];
+	uint32_t offset;
+	float max[3];
+	uint32_t count;
+};
+
+static_assert(sizeof(BvhNode) == 32, "BvhNode must stay 32 bytes");
+
+struct BvhOptions
+{
+	unsigned maxLeafSize = 4;
+	// SAH candidates per axis
+	unsigned bins = 16;
+};
+
+struct RayHit
+{
+	// along the ray direction; for a segment, the fraction of it
+	float t;
+	// index in the triangles given to the build
+	uint32_t triangle;
+	// barycentrics of p1 and p2
+	float u, v;
+	// unit geometric normal, (p1 - p0) x (p2 - p0)
+	glm::vec3 normal;
+};
+
+struct SphereContact
+{
+	uint32_t triangle;
+	// closest point of the mesh to the center
+	glm::vec3 point;
+	float distance;
+};
+
+// Bounding volume hierarchy over a triangle soup, built with the surface
+// area heuristic on binned centroids (Wald, "On fast Construction of
+// SAH-based Bounding Volume Hierarchies"). The upper levels are split with
+// parallel binning, then the subtrees below are built in parallel.
+// Queries are const and can run from any number of threads.
+class Bvh
+{
+public:
+	Bvh() = default;
+	explicit Bvh(const std::vector<Triangle> &triangles, ThreadPool *pool = nullptr, const BvhOptions &options = {});
+
+	// Closest hit of origin + t * direction for t in [0, maxT]
+	bool Raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxT, RayHit &hit) const;
+
+	// Hit closest to `a` on the segment from `a` to `b`, hit.t in [0, 1]
+	bool Segment(const glm::vec3 &a, const glm::vec3 &b, RayHit &hit) const;
+
+	// Closest point of the mesh to `center`, if within `radius`
+	bool ClosestPoint(const glm::vec3 &center, float radius, SphereContact &contact) const;
+
+	std::size_t TriangleCount() const { return triangles.size(); }
+	const std::vector<BvhNode> &Nodes() const { return nodes; }
+	glm::vec3 Min() const;
+	glm::vec3 Max() const;
+
+	// Expected cost of a query: traversal steps plus triangle tests, by
+	// surface area, relative to the root
+	float SahCost() const;
+	unsigned Depth() const;
+
+	// In leaf order: the triangles of a leaf are contiguous
+	const std::vector<Triangle> &Triangles() const { return triangles; }
+	uint32_t TriangleId(uint32_t leafOrder) const { return ids[leafOrder]; }
+
+private:
+	std::vector<BvhNode> nodes;
+	std::vector<Triangle> triangles;
+	std::vector<uint32_t> ids;
+};
+
+// Four children per node, their boxes in SIMD-friendly planes so a ray
+// tests all four at once. Collapsed from a binary Bvh, which must outlive it.
+struct Bvh4Node
+{
+	float minX[4], minY[4], minZ[4];
+	float maxX[4], maxY[4], maxZ[4];
+	// interior child node, or first triangle when count > 0; unused slots
+	// have an empty box
+	uint32_t child[4];
+	uint32_t count[4];
+};
+
+class Bvh4
+{
+public:
+	explicit Bvh4(const Bvh &bvh);
+
+	bool Raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxT, RayHit &hit) const;
+	bool Segment(const glm::vec3 &a, const glm::vec3 &b, RayHit &hit) const;
+
+	std::size_t NodeCount() const { return nodes.size(); }
+
+private:
+	uint32_t Collapse(uint32_t node);
+
+	const Bvh &bvh;
+	AlignedVector<Bvh4Node> nodes;
+};
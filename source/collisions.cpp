@@ -0,0 +1,98 @@
+#include "collisions.h"
+#include "bvh.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cmath>
+
+std::size_t ApplySoftCollisions(ParticleStreams &particles, const SpatialGrid &grid, const CollisionParams &params, ThreadPool &pool)
+{
+	PROFILE_ZONE("ApplySoftCollisions");
+
+	const float contact = 2.0f * params.radius;
+	const auto &order = grid.Order();
+	std::atomic<std::size_t> contacts(0);
+
+	// in bucket order: the neighbours of consecutive particles are shared
+	// in cache. Only the speeds are written, the grid keeps its own copy of
+	// the positions, so particles are independent.
+	pool.ParallelFor(order.size(), 4 * 1024, [&](std::size_t begin, std::size_t end) {
+		std::size_t found = 0;
+		for(std::size_t s = begin; s < end; ++s)
+		{
+			const uint32_t i = order[s];
+			float fx = 0.0f, fy = 0.0f, fz = 0.0f;
+
+			grid.ForEachNeighbour(particles.px[i], particles.py[i], particles.pz[i], contact,
+					[&](uint32_t j, float dx, float dy, float dz, float distance2) {
+				if(j == i || distance2 == 0.0f)
+				{
+					return;
+				}
+				const float distance = std::sqrt(distance2);
+				const float push = params.stiffness * (contact - distance) / distance;
+				fx += dx * push;
+				fy += dy * push;
+				fz += dz * push;
+				++found;
+			});
+
+			const float scale = params.deltaTime / particles.size[i];
+			particles.vx[i] += fx * scale;
+			particles.vy[i] += fy * scale;
+			particles.vz[i] += fz * scale;
+		}
+		contacts.fetch_add(found, std::memory_order_relaxed);
+	});
+
+	return contacts.load();
+}
+
+std::size_t CollideWithMesh(ParticleStreams &particles, const float *previous, const Bvh &mesh, float restitution, ThreadPool &pool)
+{
+	PROFILE_ZONE("CollideWithMesh");
+
+	// off the surface, so the next step starts in front of it
+	const float separation = 1e-4f;
+	std::atomic<std::size_t> hits(0);
+
+	pool.ParallelFor(particles.Count(), 4 * 1024, [&](std::size_t begin, std::size_t end) {
+		std::size_t found = 0;
+		for(std::size_t i = begin; i < end; ++i)
+		{
+			const glm::vec3 a(previous[3 * i], previous[3 * i + 1], previous[3 * i + 2]);
+			if(IsOutsideScreen(a))
+			{
+				continue;
+			}
+
+			const glm::vec3 b(particles.px[i], particles.py[i], particles.pz[i]);
+			RayHit hit;
+			if(!mesh.Segment(a, b, hit))
+			{
+				continue;
+			}
+
+			// the side the particle came from
+			const glm::vec3 motion = b - a;
+			const glm::vec3 normal = glm::dot(hit.normal, motion) > 0.0f ? -hit.normal : hit.normal;
+			const glm::vec3 position = a + motion * hit.t + normal * separation;
+			particles.px[i] = position.x;
+			particles.py[i] = position.y;
+			particles.pz[i] = position.z;
+
+			const glm::vec3 speed(particles.vx[i], particles.vy[i], particles.vz[i]);
+			const glm::vec3 reflected = (speed - 2.0f * glm::dot(speed, normal) * normal) * restitution;
+			particles.vx[i] = reflected.x;
+			particles.vy[i] = reflected.y;
+			particles.vz[i] = reflected.z;
+			++found;
+		}
+		hits.fetch_add(found, std::memory_order_relaxed);
+	});
+
+	return hits.load();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+#include "particles.h"
+#include "spatial_grid.h"
+
+class Bvh;
+class ThreadPool;
+
+// Soft collisions: overlapping particles push each other apart with a
+// spring force proportional to the overlap, heavier particles (by size)
+// moving less.
+struct CollisionParams
+{
+	float deltaTime;
+	// particles are spheres of this radius, it should not exceed half the grid cell
+	float radius;
+	float stiffness;
+};
+
+// Updates the speeds from the grid built on the current positions and
+// returns the number of contacts (each pair counted twice). Deterministic
+// whatever the thread count.
+std::size_t ApplySoftCollisions(ParticleStreams &particles, const SpatialGrid &grid, const CollisionParams &params, ThreadPool &pool);
+
+// Particles whose move since `previous` (interleaved x, y, z before the
+// step) crosses a triangle of the mesh are put back just in front of it,
+// their speed mirrored about its normal and scaled by `restitution`.
+// Particles respawned by the step are left alone. Returns the hits.
+std::size_t CollideWithMesh(ParticleStreams &particles, const float *previous, const Bvh &mesh, float restitution, ThreadPool &pool);
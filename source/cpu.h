@@ -0,0 +1,26 @@
+#pragma once
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Instruction sets usable at runtime (checked against both CPU and OS support).
+struct CpuFeatures
+{
+	bool sse41;
+	bool avx2;
+};
+
+const CpuFeatures &GetCpuFeatures();
+
+// Index of the lowest set bit, v must not be 0
+inline int CountTrailingZeros(unsigned v)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, v);
+	return (int) index;
+#else
+	return __builtin_ctz(v);
+#endif
+}
@@ -0,0 +1,74 @@
+#ifdef GAMAGORA_HAS_EGL
+
+#include <glad/glad.h>
+
+#include "egl_context.h"
+
+#include <EGL/eglext.h>
+
+#include <stdexcept>
+#include <string>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+HeadlessContext::HeadlessContext()
+	: display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT)
+{
+	const auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if(!getPlatformDisplay)
+	{
+		throw std::runtime_error("EGL: eglGetPlatformDisplayEXT is not available");
+	}
+
+	display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	EGLint major, minor;
+	if(display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		throw std::runtime_error("EGL: cannot initialize the surfaceless display");
+	}
+
+	if(!eglBindAPI(EGL_OPENGL_API))
+	{
+		eglTerminate(display);
+		throw std::runtime_error("EGL: no desktop OpenGL support");
+	}
+
+	const EGLint attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	// EGL_KHR_no_config_context: surfaceless contexts need no config
+	context = eglCreateContext(display, static_cast<EGLConfig>(nullptr), EGL_NO_CONTEXT, attributes);
+	if(context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		const EGLint error = eglGetError();
+		if(context != EGL_NO_CONTEXT)
+		{
+			eglDestroyContext(display, context);
+		}
+		eglTerminate(display);
+		throw std::runtime_error("EGL: cannot create an OpenGL 4.5 core context (error " + std::to_string(error) + ")");
+	}
+
+	if(!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)))
+	{
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(display, context);
+		eglTerminate(display);
+		throw std::runtime_error("EGL: cannot load the OpenGL functions");
+	}
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(display, context);
+	eglTerminate(display);
+}
+
+#endif
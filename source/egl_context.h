@@ -0,0 +1,27 @@
+#pragma once
+
+// Built only where CMake found EGL (GAMAGORA_HAS_EGL)
+#ifdef GAMAGORA_HAS_EGL
+
+#include <EGL/egl.h>
+
+// OpenGL 4.5 core context without any window or surface, on the Mesa
+// surfaceless platform (llvmpipe when no GPU is around). Rendering goes to
+// framebuffer objects. The context is current on the creating thread and
+// glad is loaded through eglGetProcAddress.
+class HeadlessContext
+{
+public:
+	// Throws if EGL or a 4.5 core context is not available
+	HeadlessContext();
+	~HeadlessContext();
+
+	HeadlessContext(const HeadlessContext &) = delete;
+	HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+private:
+	EGLDisplay display;
+	EGLContext context;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include "file_identity.h"
+#include "hash.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+FileIdentity IdentifyFile(const char * path, bool withHash)
+{
+	const std::filesystem::path p(path);
+
+	FileIdentity identity;
+	identity.size = uint64_t(std::filesystem::file_size(p));
+	identity.time = int64_t(std::filesystem::last_write_time(p).time_since_epoch().count());
+	identity.hash = 0;
+
+	if(withHash)
+	{
+		const MappedFile file(path);
+		identity.hash = HashBytes(file.Data(), file.Size());
+	}
+
+	return identity;
+}
+
+FileMatch CompareFile(const FileIdentity & recorded, const char * path, FileIdentity * current)
+{
+	const FileIdentity seen = IdentifyFile(path, false);
+	if(current)
+	{
+		*current = seen;
+	}
+
+	if(seen.size != recorded.size)
+	{
+		return FileMatch::Different;
+	}
+	if(seen.time == recorded.time)
+	{
+		return FileMatch::Same;
+	}
+
+	// touched but possibly unchanged (checkout, copy): compare contents
+	return IdentifyFile(path).hash == recorded.hash ? FileMatch::Touched : FileMatch::Different;
+}
+
+bool RewriteRecordedTime(const char * cachePath, std::size_t offset, int64_t time)
+{
+	std::fstream file(cachePath, std::ios::in | std::ios::out | std::ios::binary);
+	if(!file.is_open())
+	{
+		return false;
+	}
+
+	file.seekp(std::streamoff(offset));
+	file.write(reinterpret_cast<const char *>(&time), sizeof(time));
+	return file.good();
+}
+
+std::string TemporaryPath(const char * path)
+{
+	// concurrent loads of one asset on the pool, or meshconv next to the app
+	static std::atomic<uint64_t> counter(0);
+	return std::string(path) + "." + std::to_string(getpid()) + "." + std::to_string(counter.fetch_add(1)) + ".tmp";
+}
+
+void WriteFileAside(const char * path, const void * header, std::size_t headerSize, const std::vector<FileRange> & ranges)
+{
+	const std::string temporary = TemporaryPath(path);
+	bool complete;
+	{
+		std::ofstream out(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+		if(!out.is_open())
+		{
+			throw std::runtime_error("Cannot write file: " + temporary);
+		}
+
+		out.write(static_cast<const char *>(header), std::streamsize(headerSize));
+
+		const char padding[64] = {};
+		uint64_t written = headerSize;
+		for(const FileRange & range : ranges)
+		{
+			while(written < range.offset)
+			{
+				const uint64_t gap = std::min<uint64_t>(range.offset - written, sizeof(padding));
+				out.write(padding, std::streamsize(gap));
+				written += gap;
+			}
+			out.write(static_cast<const char *>(range.data), std::streamsize(range.size));
+			written += range.size;
+		}
+
+		out.close();
+		complete = out.good();
+	}
+
+	std::error_code error;
+	if(complete)
+	{
+		std::filesystem::rename(temporary, path, error);
+	}
+	if(!complete || error)
+	{
+		// unique names are never overwritten by the next attempt
+		std::filesystem::remove(temporary, error);
+		throw std::runtime_error("Cannot write file: " + std::string(complete ? path : temporary.c_str()));
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What the on-disk caches remember about their source file
+struct FileIdentity
+{
+	uint64_t size;
+	int64_t time;
+	uint64_t hash;
+};
+
+// Size and modification time, plus the content hash when asked
+FileIdentity IdentifyFile(const char * path, bool withHash = true);
+
+enum class FileMatch
+{
+	Different,
+	Same,
+	// same contents, but the mtime moved since it was recorded
+	Touched
+};
+
+// Size must match; a moved mtime falls back to comparing contents.
+// `current` receives the size and mtime seen, hash left at 0.
+FileMatch CompareFile(const FileIdentity & recorded, const char * path, FileIdentity * current = nullptr);
+
+inline bool IsSameFile(const FileIdentity & recorded, const char * path)
+{
+	return CompareFile(recorded, path) != FileMatch::Different;
+}
+
+// Overwrites the mtime a cache file recorded at `offset`, so that a Touched
+// source is not hashed again at every start. Must not be mapped meanwhile.
+// Returns false when the cache cannot be written (read-only install).
+bool RewriteRecordedTime(const char * cachePath, std::size_t offset, int64_t time);
+
+// Unique name next to `path` to write a cache aside before renaming it over
+// `path`: distinct for every call, across threads and processes
+std::string TemporaryPath(const char * path);
+
+// Bytes of a file at `offset`
+struct FileRange
+{
+	uint64_t offset;
+	const void * data;
+	uint64_t size;
+};
+
+// Writes `header` at 0 then the ranges, by increasing offset with the gaps
+// zero filled, to a TemporaryPath renamed over `path`: a reader never maps a
+// half-written file. Throws std::runtime_error and removes the temporary
+// file when the write or the rename fails.
+void WriteFileAside(const char * path, const void * header, std::size_t headerSize, const std::vector<FileRange> & ranges);
@@ -0,0 +1,95 @@
+#include "fixed_step.h"
+#include "profiler.h"
+
+#include <stdexcept>
+
+FixedStepLoop::FixedStepLoop(double ticksPerSecond, Tick tick, unsigned maxCatchUp)
+	: tickDuration(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / ticksPerSecond))),
+	tick(std::move(tick)), maxCatchUp(maxCatchUp < 1 ? 1 : maxCatchUp), stop(false), droppedTicks(0)
+{
+	if(!(ticksPerSecond > 0.0))
+	{
+		throw std::runtime_error("FixedStepLoop: the tick rate must be positive");
+	}
+	thread = std::thread(&FixedStepLoop::Run, this);
+}
+
+FixedStepLoop::~FixedStepLoop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	wake.notify_all();
+	thread.join();
+}
+
+FixedStepStats FixedStepLoop::Stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	FixedStepStats stats;
+	stats.ticks = tickTimes.Count();
+	stats.droppedTicks = droppedTicks;
+	stats.tick = tickTimes.Summary();
+	return stats;
+}
+
+void FixedStepLoop::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	tickTimes.Clear();
+	droppedTicks = 0;
+}
+
+void FixedStepLoop::Run()
+{
+	SetProfilerThreadName("simulation");
+
+	typedef std::chrono::steady_clock Clock;
+	const float deltaTime = std::chrono::duration<float>(tickDuration).count();
+	const Clock::duration maxLag = tickDuration * maxCatchUp;
+
+	uint64_t index = 0;
+	// simulated time lags wall time by `lag`, which the ticks consume
+	Clock::duration lag = tickDuration;
+	Clock::time_point previous = Clock::now();
+
+	for(;;)
+	{
+		const Clock::time_point now = Clock::now();
+		lag += now - previous;
+		previous = now;
+
+		if(lag > maxLag)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			droppedTicks += uint64_t((lag - maxLag) / tickDuration);
+			lag = maxLag;
+		}
+
+		while(lag >= tickDuration)
+		{
+			const Clock::time_point start = Clock::now();
+			{
+				PROFILE_ZONE("tick");
+				tick(deltaTime, index++);
+			}
+			const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			lag -= tickDuration;
+
+			std::lock_guard<std::mutex> lock(mutex);
+			tickTimes.Add(ms);
+			if(stop)
+			{
+				return;
+			}
+		}
+
+		// until the next tick is due
+		std::unique_lock<std::mutex> lock(mutex);
+		if(wake.wait_until(lock, now + (tickDuration - lag), [this] { return stop; }))
+		{
+			return;
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "frame_stats.h"
+
+struct FixedStepStats
+{
+	uint64_t ticks = 0;
+	// simulated time given up because the ticks could not keep up
+	uint64_t droppedTicks = 0;
+	// duration of a tick, in milliseconds
+	TimingSummary tick = {0.0, 0.0, 0.0, 0.0, 0.0};
+};
+
+// Runs `tick(deltaTime, index)` on its own thread at a fixed rate, with the
+// same deltaTime every time, whatever the frame rate of the renderer.
+// Late ticks are caught up, at most `maxCatchUp` in a row: past that the
+// simulation slows down instead of spending ever more time catching up
+// (the spiral of death).
+class FixedStepLoop
+{
+public:
+	typedef std::function<void(float deltaTime, uint64_t index)> Tick;
+
+	FixedStepLoop(double ticksPerSecond, Tick tick, unsigned maxCatchUp = 5);
+	// Stops after the tick in progress
+	~FixedStepLoop();
+
+	FixedStepLoop(const FixedStepLoop &) = delete;
+	FixedStepLoop &operator=(const FixedStepLoop &) = delete;
+
+	std::chrono::steady_clock::duration TickDuration() const { return tickDuration; }
+
+	// Ticks since the last ResetStats(), or since the start
+	FixedStepStats Stats() const;
+	void ResetStats();
+
+private:
+	void Run();
+
+	const std::chrono::steady_clock::duration tickDuration;
+	const Tick tick;
+	const unsigned maxCatchUp;
+
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	bool stop;
+	uint64_t droppedTicks;
+	TimingSampler tickTimes;
+
+	std::thread thread;
+};
@@ -0,0 +1,126 @@
+#include "frame_stats.h"
+#include "random.h"
+
+#include <algorithm>
+#include <numeric>
+
+TimingSummary Summarize(std::vector<double> samples)
+{
+	if(samples.empty())
+	{
+		return {0.0, 0.0, 0.0, 0.0, 0.0};
+	}
+
+	std::sort(samples.begin(), samples.end());
+	const auto rank = [&](double p) {
+		const std::size_t n = samples.size();
+		const std::size_t r = std::size_t(p * double(n) + 0.999999);
+		return samples[std::min(std::max(r, std::size_t(1)), n) - 1];
+	};
+
+	return {
+		samples.front(),
+		std::accumulate(samples.begin(), samples.end(), 0.0) / double(samples.size()),
+		rank(0.50),
+		rank(0.99),
+		samples.back()
+	};
+}
+
+TimingSampler::TimingSampler(std::size_t capacity)
+	: capacity(std::max(capacity, std::size_t(1))), count(0), min(0.0), max(0.0), sum(0.0)
+{
+	reservoir.reserve(this->capacity);
+}
+
+void TimingSampler::Add(double sample)
+{
+	min = count == 0 ? sample : std::min(min, sample);
+	max = count == 0 ? sample : std::max(max, sample);
+	sum += sample;
+	++count;
+
+	if(reservoir.size() < capacity)
+	{
+		reservoir.push_back(sample);
+		return;
+	}
+	// the n-th sample replaces a kept one with probability capacity / n
+	const Philox4x32 r = Philox4x32::Generate(uint32_t(count), uint32_t(count >> 32), 0, 0, 0x5a3du, 0);
+	const uint64_t slot = ((uint64_t(r.v[1]) << 32) | r.v[0]) % count;
+	if(slot < capacity)
+	{
+		reservoir[std::size_t(slot)] = sample;
+	}
+}
+
+void TimingSampler::Clear()
+{
+	reservoir.clear();
+	count = 0;
+	min = max = sum = 0.0;
+}
+
+TimingSummary TimingSampler::Summary() const
+{
+	TimingSummary summary = Summarize(reservoir);
+	if(count > 0)
+	{
+		summary.min = min;
+		summary.mean = sum / double(count);
+		summary.max = max;
+	}
+	return summary;
+}
+
+static std::string Escape(const std::string &text)
+{
+	std::string escaped;
+	for(const char c : text)
+	{
+		if(c == '"' || c == '\\')
+		{
+			escaped += '\\';
+		}
+		if(static_cast<unsigned char>(c) >= 0x20)
+		{
+			escaped += c;
+		}
+	}
+	return escaped;
+}
+
+static void WriteSummary(std::ostream &out, const char *name, const TimingSummary &s)
+{
+	out << "  \"" << name << "\": {\"min\": " << s.min << ", \"mean\": " << s.mean
+		<< ", \"p50\": " << s.p50 << ", \"p99\": " << s.p99 << ", \"max\": " << s.max << "}";
+}
+
+void WriteBenchmarkJson(std::ostream &out, const BenchmarkReport &report)
+{
+	out << "{\n";
+	out << "  \"scene\": \"" << Escape(report.scene) << "\",\n";
+	out << "  \"simulation_backend\": \"" << Escape(report.simulationBackend) << "\",\n";
+	out << "  \"renderer\": \"" << Escape(report.renderer) << "\",\n";
+	out << "  \"particles\": " << report.particles << ",\n";
+	out << "  \"width\": " << report.width << ",\n";
+	out << "  \"height\": " << report.height << ",\n";
+	out << "  \"frames\": " << report.frames << ",\n";
+	out << "  \"threads\": " << report.threads << ",\n";
+	out << "  \"seconds\": " << report.seconds << ",\n";
+	WriteSummary(out, "frame_ms", report.frame);
+	out << ",\n";
+	WriteSummary(out, "simulation_ms", report.simulation);
+	if(report.ticks > 0)
+	{
+		out << ",\n  \"ticks\": " << report.ticks << ",\n";
+		out << "  \"dropped_ticks\": " << report.droppedTicks << ",\n";
+		WriteSummary(out, "tick_ms", report.tick);
+	}
+	if(report.draws > 0.0)
+	{
+		out << ",\n  \"render_queue\": {\"draws\": " << report.draws << ", \"draw_calls\": " << report.drawCalls
+			<< ", \"state_changes\": " << report.stateChanges << ", \"unbatched_state_changes\": " << report.unbatchedStateChanges << "}";
+	}
+	out << "\n}\n";
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct TimingSummary
+{
+	double min, mean, p50, p99, max;
+};
+
+// Nearest-rank percentiles of the samples, all zero when there is none
+TimingSummary Summarize(std::vector<double> samples);
+
+// Count, min, mean and max of every sample added, percentiles from a uniform
+// sample of at most `capacity` of them (Vitter's algorithm R): memory and
+// Summary() stay bounded however long the run, exact up to `capacity`.
+class TimingSampler
+{
+public:
+	explicit TimingSampler(std::size_t capacity = 4096);
+
+	void Add(double sample);
+	void Clear();
+
+	uint64_t Count() const { return count; }
+	TimingSummary Summary() const;
+
+private:
+	std::size_t capacity;
+	std::vector<double> reservoir;
+	uint64_t count;
+	double min, max, sum;
+};
+
+// What a measured run reports, times in milliseconds
+struct BenchmarkReport
+{
+	std::string scene;
+	std::string simulationBackend;
+	std::string renderer;
+	int particles;
+	int width, height;
+	int frames;
+	unsigned threads;
+
+	TimingSummary frame;
+	TimingSummary simulation;
+	double seconds;
+
+	// fixed step simulation thread, when there is one
+	uint64_t ticks = 0;
+	uint64_t droppedTicks = 0;
+	TimingSummary tick = {0.0, 0.0, 0.0, 0.0, 0.0};
+
+	// render queue, means per frame: draws submitted and, once batched,
+	// draw calls and state changes against the unbatched state changes
+	double draws = 0.0;
+	double drawCalls = 0.0;
+	double stateChanges = 0.0;
+	double unbatchedStateChanges = 0.0;
+};
+
+void WriteBenchmarkJson(std::ostream &out, const BenchmarkReport &report);
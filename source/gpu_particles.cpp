@@ -0,0 +1,79 @@
+#include "gpu_particles.h"
+#include "profiler.h"
+
+#include <vector>
+
+// must match local_size_x in shaderGravity.comp
+static const GLuint workGroupSize = 256;
+
+GpuParticles::GpuParticles(ShaderLibrary &shaders, const ParticleStreams &initial)
+	: shaders(shaders), count(initial.Count())
+{
+	program = shaders.Load({{GL_COMPUTE_SHADER, "resources/shaders/shaderGravity.comp"}});
+
+	std::vector<float> positions(count * 4), speeds(count * 4, 0.0f);
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		positions[4 * i + 0] = initial.px[i];
+		positions[4 * i + 1] = initial.py[i];
+		positions[4 * i + 2] = initial.pz[i];
+		positions[4 * i + 3] = initial.size[i];
+
+		speeds[4 * i + 0] = initial.vx[i];
+		speeds[4 * i + 1] = initial.vy[i];
+		speeds[4 * i + 2] = initial.vz[i];
+	}
+
+	// written by the GPU only: no dynamic storage, no mapping
+	glCreateBuffers(2, buffers);
+	glNamedBufferStorage(buffers[0], positions.size() * sizeof(float), positions.data(), 0);
+	glNamedBufferStorage(buffers[1], speeds.size() * sizeof(float), speeds.data(), 0);
+	AddProfileCounter(ProfileCounter::BytesUploaded, (positions.size() + speeds.size()) * sizeof(float));
+}
+
+GpuParticles::~GpuParticles()
+{
+	glDeleteBuffers(2, buffers);
+}
+
+void GpuParticles::Simulate(const GravityParams &params)
+{
+	const GLuint prg = shaders.Program(program);
+
+	glProgramUniform1ui(prg, 0, GLuint(count));
+	glProgramUniform1f(prg, 1, params.deltaTime);
+	glProgramUniform3f(prg, 2, params.spawn.x, params.spawn.y, params.spawn.z);
+	glProgramUniform1ui(prg, 3, params.seed);
+	glProgramUniform1ui(prg, 4, params.frame);
+
+	glUseProgram(prg);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffers[0]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, buffers[1]);
+	glDispatchCompute(GLuint((count + workGroupSize - 1) / workGroupSize), 1, 1);
+
+	// the next step reads the buffers back as storage, the draw as vertices
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+	AddProfileCounter(ProfileCounter::ParticlesSimulated, count);
+}
+
+void GpuParticles::Read(ParticleStreams &particles) const
+{
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	std::vector<float> positions(count * 4), speeds(count * 4);
+	glGetNamedBufferSubData(buffers[0], 0, positions.size() * sizeof(float), positions.data());
+	glGetNamedBufferSubData(buffers[1], 0, speeds.size() * sizeof(float), speeds.data());
+
+	particles.Resize(count);
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		particles.px[i] = positions[4 * i + 0];
+		particles.py[i] = positions[4 * i + 1];
+		particles.pz[i] = positions[4 * i + 2];
+		particles.size[i] = positions[4 * i + 3];
+
+		particles.vx[i] = speeds[4 * i + 0];
+		particles.vy[i] = speeds[4 * i + 1];
+		particles.vz[i] = speeds[4 * i + 2];
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+#include "particles.h"
+#include "shader_library.h"
+
+// The gravity simulation on the GPU: particle state lives in shader storage
+// buffers, integrated by shaderGravity.comp with the operations and the
+// Philox respawns of IntegrateGravityScalar. Nothing crosses the bus per
+// frame: the position buffer doubles as the vertex buffer.
+// Every method must be called from the thread owning the GL context.
+class GpuParticles
+{
+public:
+	GpuParticles(ShaderLibrary &shaders, const ParticleStreams &initial);
+	~GpuParticles();
+
+	GpuParticles(const GpuParticles &) = delete;
+	GpuParticles &operator=(const GpuParticles &) = delete;
+
+	// Dispatches one step; the results are visible to later draws and steps
+	void Simulate(const GravityParams &params);
+
+	// Copies the state back (slow, waits for the GPU): for validation
+	void Read(ParticleStreams &particles) const;
+
+	std::size_t Count() const { return count; }
+
+	// vec4 per particle: xyz position, w size
+	GLuint PositionBuffer() const { return buffers[0]; }
+	static const GLsizei positionStride = 4 * sizeof(float);
+	static const GLuint sizeOffset = 3 * sizeof(float);
+
+private:
+	ShaderLibrary &shaders;
+	ProgramId program;
+	std::size_t count;
+
+	// positions and sizes, speeds
+	GLuint buffers[2];
+};
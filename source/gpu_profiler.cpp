@@ -0,0 +1,70 @@
+#include "gpu_profiler.h"
+
+#include "profiler.h"
+
+GpuProfiler::GpuProfiler(unsigned maxZonesPerFrame)
+{
+	for(auto &frame : frames)
+	{
+		frame.queries.resize(maxZonesPerFrame);
+		glCreateQueries(GL_TIME_ELAPSED, GLsizei(maxZonesPerFrame), frame.queries.data());
+		frame.zones.reserve(maxZonesPerFrame);
+	}
+}
+
+GpuProfiler::~GpuProfiler()
+{
+	for(auto &frame : frames)
+	{
+		glDeleteQueries(GLsizei(frame.queries.size()), frame.queries.data());
+	}
+}
+
+void GpuProfiler::Begin(const char *name)
+{
+	FrameQueries &frame = frames[current];
+	// past the query budget the zone is not measured, End ignores it
+	if(!ProfilerEnabled() || open || frame.zones.size() == frame.queries.size())
+	{
+		return;
+	}
+
+	glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.zones.size()]);
+	frame.zones.push_back({name, ProfilerNow()});
+	open = true;
+}
+
+void GpuProfiler::End()
+{
+	if(open)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		open = false;
+	}
+}
+
+void GpuProfiler::Collect(FrameQueries &frame)
+{
+	uint64_t total = 0;
+	for(std::size_t z = 0; z < frame.zones.size(); ++z)
+	{
+		// a frame later the result is almost always there, else this waits for it
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(frame.queries[z], GL_QUERY_RESULT, &elapsed);
+		RecordGpuZone(frame.zones[z].name, frame.zones[z].cpuBegin, elapsed);
+		total += elapsed;
+	}
+
+	if(!frame.zones.empty())
+	{
+		lastFrame = double(total) / 1e6;
+	}
+	frame.zones.clear();
+}
+
+void GpuProfiler::FrameEnd()
+{
+	End();
+	current ^= 1;
+	Collect(frames[current]);
+}
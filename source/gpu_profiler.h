@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+// GPU durations of the draw passes through GL_TIME_ELAPSED queries. The
+// queries of a frame are read back one frame later, once the GPU is done
+// with them, so measuring never stalls the pipeline. Zones cannot nest:
+// GL allows a single time elapsed query at a time.
+// Every method must be called from the thread owning the GL context and
+// does nothing while the profiler is disabled.
+class GpuProfiler
+{
+public:
+	explicit GpuProfiler(unsigned maxZonesPerFrame = 32);
+	~GpuProfiler();
+
+	GpuProfiler(const GpuProfiler &) = delete;
+	GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+	// `name` must outlive the profiler: string literals
+	void Begin(const char *name);
+	void End();
+
+	// Collects the previous frame and starts recording into its queries
+	void FrameEnd();
+
+	// GPU time of the last frame read back, in milliseconds
+	double LastFrameMilliseconds() const { return lastFrame; }
+
+private:
+	struct Zone
+	{
+		const char *name;
+		uint64_t cpuBegin;
+	};
+
+	struct FrameQueries
+	{
+		std::vector<GLuint> queries;
+		std::vector<Zone> zones;
+	};
+
+	void Collect(FrameQueries &frame);
+
+	FrameQueries frames[2];
+	unsigned current = 0;
+	bool open = false;
+	double lastFrame = 0.0;
+};
+
+class GpuZone
+{
+public:
+	GpuZone(GpuProfiler &profiler, const char *name)
+		: profiler(profiler)
+	{
+		profiler.Begin(name);
+	}
+
+	~GpuZone()
+	{
+		profiler.End();
+	}
+
+	GpuZone(const GpuZone &) = delete;
+	GpuZone &operator=(const GpuZone &) = delete;
+
+private:
+	GpuProfiler &profiler;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Fast non-cryptographic 64-bit hash (FNV-1a style mixing on 8-byte words),
+// used to detect changed sources behind the on-disk caches.
+inline uint64_t HashBytes(const void * data, std::size_t size, uint64_t seed = 0xcbf29ce484222325ull)
+{
+	const unsigned char * p = static_cast<const unsigned char *>(data);
+	const uint64_t prime = 0x100000001b3ull;
+	uint64_t h = seed ^ (size * prime);
+
+	for(; size >= 8; size -= 8, p += 8)
+	{
+		uint64_t word;
+		std::memcpy(&word, p, 8);
+		h = (h ^ word) * prime;
+		h ^= h >> 29;
+	}
+
+	for(; size > 0; --size, ++p)
+	{
+		h = (h ^ *p) * prime;
+	}
+
+	h ^= h >> 32;
+	h *= 0xd6e8feb86659fd93ull;
+	h ^= h >> 32;
+	return h;
+}
@@ -5,31 +5,32 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <vector>
 #include <iostream>
-#include <random>
 #include <sstream>
 #include <fstream>
 #include <string>
+#include <memory>
+#include <chrono>
+#include <functional>
 
-#include "shader.h"
-
-#define TINYPLY_IMPLEMENTATION
-#include "tinyply.h"
-
+#include "shader_library.h"
 #include "stl.h"
 #include "texture.h"
-
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include "particles.h"
+#include "assets.h"
+#include "scene.h"
+#include "run_options.h"
+#include "frame_stats.h"
+#include "egl_context.h"
+#include "profiler.h"
+#include "gpu_profiler.h"
 
 // timing
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int width = 1200;
-int height = 1200;
-
 static void error_callback(int /*error*/, const char* description)
 {
 	std::cerr << "Error: " << description << std::endl;
@@ -41,45 +42,6 @@ static void key_callback(GLFWwindow* window, int key, int /*scancode*/, int acti
 		glfwSetWindowShouldClose(window, GLFW_TRUE);
 }
 
-/* PARTICULES */
-struct Particle {
-	glm::vec3 position;
-	glm::vec3 color;
-	glm::vec3 speed;
-	float size;
-};
-
-std::default_random_engine generator;
-std::uniform_real_distribution<float> distribution01(0, 1);
-std::uniform_real_distribution<float> distributionWorld(-1, 1);
-
-std::vector<Particle> MakeParticles(const int n) {
-
-	std::vector<Particle> p;
-	p.reserve(n);
-
-	for(int i = 0; i < n; i++)
-	{
-		p.push_back(Particle{
-				{
-				distributionWorld(generator),
-				distributionWorld(generator),
-				distributionWorld(generator)
-				},
-				{
-				distribution01(generator),
-				distribution01(generator),
-				distribution01(generator)
-				},
-				{0.f, 0.f, 0.f},
-				20.0f * distribution01(generator)
-				});
-	}
-
-	return p;
-}
-
-
 void APIENTRY opengl_error_callback(GLenum source,
 		GLenum type,
 		GLuint id,
@@ -91,55 +53,235 @@ void APIENTRY opengl_error_callback(GLenum source,
 	std::cout << message << std::endl;
 }
 
-static const float g = 3.711; //m.s-2
-static const glm::vec3 gravityDirection(0.0f, 1.0f, 0.0f);
-
-bool IsOutsideScreen(glm::vec3 pos) {
-	return pos.y < -1.0f || pos.x < -1.0f ||pos.x > 1.0f;
+static double Milliseconds(std::chrono::steady_clock::duration d)
+{
+	return std::chrono::duration<double, std::milli>(d).count();
 }
 
-glm::vec3 ScreenCoordinatesToWorldCoordinates(double &xpos, double &ypos) {
-	return glm::vec3(xpos / width * 2.0f - 1.0f, (ypos / height * 2.0f - 1.0f) * -1.0f, 1.0f);
-}
+// Renders the scene into the FBO, windowed or not. `frameDone` ends a frame
+// (present and swap, or glFinish when headless), may set the next time step
+// and returns false to stop.
+typedef std::function<bool(Scene &scene, GLuint fbo, float &nextDelta)> FrameDone;
+
+static void RunFrames(const RunOptions &options, const FrameDone &frameDone)
+{
+	EnableProfiler(!options.trace.empty());
+	SetProfilerThreadName("main");
+
+	auto assets = std::make_unique<AssetManager>();
+	auto shaders = std::make_unique<ShaderLibrary>();
+	auto arena = std::make_unique<GeometryArena>();
+	auto queue = std::make_unique<RenderQueue>(*arena);
+	ThreadPool pool(options.threads);
+
+	SceneOptions sceneOptions;
+	sceneOptions.particles = options.particles;
+	sceneOptions.simulation = options.simulation == "gpu" ? ParticleSimulation::Gpu : ParticleSimulation::Cpu;
+	sceneOptions.tickRate = options.tickRate;
+	sceneOptions.collisions = options.collisions;
+	sceneOptions.mesh = options.mesh;
+	sceneOptions.quads = options.quads;
+	auto scene = MakeScene(options.scene, *shaders, *assets, pool, *queue, sceneOptions);
+	auto gpuProfiler = std::make_unique<GpuProfiler>();
+
+	//FrameBuffer
+	GLuint fbo;
+	glCreateFramebuffers(1, &fbo);
+
+	GLuint ct;
+	glCreateTextures(GL_TEXTURE_2D, 1, &ct);
+	glTextureStorage2D(ct, 1, GL_RGB8, options.width, options.height);
+
+	GLuint dt;
+	glCreateTextures(GL_TEXTURE_2D, 1, &dt);
+	glTextureStorage2D(dt, 1, GL_DEPTH_COMPONENT32F, options.width, options.height);
 
-void ApplyGravity(std::vector<Particle> &particules, double &xpos, double &ypos) {
+	glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, ct, 0);
+	glNamedFramebufferTexture(fbo, GL_DEPTH_ATTACHMENT, dt, 0);
 
-	for (auto &particle : particules)
+	//Options
+	glPointSize(10.f);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_PROGRAM_POINT_SIZE);
+
+	// measurements start from loaded assets
+	if(options.frames > 0)
 	{
+		assets->WaitAll();
+	}
 
-		if (IsOutsideScreen(particle.position)) {
-			particle.position = ScreenCoordinatesToWorldCoordinates(xpos, ypos);
-			particle.speed = glm::vec3(distribution01(generator) * -1.0f, distribution01(generator) * -1.0f, 0.0f) * 5.0f;
-		}
+	// bounded for windowed runs, which have no frame count; exact percentiles
+	// over the measured frames otherwise
+	const std::size_t sampled = std::max<std::size_t>(4096, std::size_t(options.frames));
+	TimingSampler frameTimes(sampled), simulationTimes(sampled);
+	RenderQueueStats queueTotals;
 
-		//Compute acceleration
-		glm::vec3 acceleration = (-particle.size * g * gravityDirection - particle.speed) / particle.size;
+	const auto start = std::chrono::steady_clock::now();
+	auto measureStart = start;
+	auto lastReloadCheck = start;
+	float frameDelta = 1.0f / 60.0f;
 
-		//Compute next speed & position
-		glm::vec3 nextSpeed = particle.speed + acceleration * deltaTime;
-		glm::vec3 nextPosition = particle.position + particle.speed * deltaTime;
+	for(int frame = 0; options.frames == 0 || frame < options.warmup + options.frames; ++frame)
+	{
+		if(frame == options.warmup)
+		{
+			// ticks and frames cover the same window
+			scene->ResetTickStats();
+			measureStart = std::chrono::steady_clock::now();
+		}
+		const auto frameStart = std::chrono::steady_clock::now();
+		double simulationTime;
+		bool more;
+		{
+			PROFILE_ZONE("frame");
+
+			{
+				PROFILE_ZONE("assets");
+				// edited shaders are rebuilt in place, checked twice a second:
+				// a stat per dependency; never headless, nobody edits them
+				if(!options.headless && frameStart - lastReloadCheck >= std::chrono::milliseconds(500))
+				{
+					shaders->ReloadChanged();
+					lastReloadCheck = frameStart;
+				}
+				assets->Update();
+			}
+
+			const auto simulationStart = std::chrono::steady_clock::now();
+			{
+				PROFILE_ZONE("update");
+				scene->Update(frameDelta);
+			}
+			simulationTime = Milliseconds(std::chrono::steady_clock::now() - simulationStart);
+
+			{
+				PROFILE_ZONE("render");
+				GpuZone gpuZone(*gpuProfiler, "scene");
+				glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+				glViewport(0, 0, options.width, options.height);
+				glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				scene->Render();
+				queue->Flush();
+			}
+
+			if(frame >= options.warmup)
+			{
+				const RenderQueueStats &stats = queue->Stats();
+				queueTotals.draws += stats.draws;
+				queueTotals.drawCalls += stats.drawCalls;
+				queueTotals.stateChanges += stats.stateChanges;
+				queueTotals.unbatchedStateChanges += stats.unbatchedStateChanges;
+			}
+
+			PROFILE_ZONE("present");
+			more = frameDone(*scene, fbo, frameDelta);
+		}
+		gpuProfiler->FrameEnd();
+		ProfilerFrameEnd();
 
-		particle.speed = nextSpeed;
-		particle.position = nextPosition;
+		if(frame >= options.warmup)
+		{
+			frameTimes.Add(Milliseconds(std::chrono::steady_clock::now() - frameStart));
+			simulationTimes.Add(simulationTime);
+		}
+
+		if(!more)
+		{
+			break;
+		}
 	}
 
-}
+	if(!options.json.empty())
+	{
+		BenchmarkReport report;
+		report.scene = options.scene;
+		report.simulationBackend = options.simulation;
+		report.renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+		report.particles = options.scene == "particles" ? options.particles : 0;
+		report.width = options.width;
+		report.height = options.height;
+		report.frames = int(frameTimes.Count());
+		report.threads = pool.ThreadCount();
+		report.frame = frameTimes.Summary();
+		report.simulation = simulationTimes.Summary();
+		FixedStepStats ticks;
+		if(scene->TickStats(ticks))
+		{
+			report.ticks = ticks.ticks;
+			report.droppedTicks = ticks.droppedTicks;
+			report.tick = ticks.tick;
+		}
+		if(frameTimes.Count() > 0)
+		{
+			const double frames = double(frameTimes.Count());
+			report.draws = queueTotals.draws / frames;
+			report.drawCalls = queueTotals.drawCalls / frames;
+			report.stateChanges = queueTotals.stateChanges / frames;
+			report.unbatchedStateChanges = queueTotals.unbatchedStateChanges / frames;
+		}
+		report.seconds = Milliseconds(std::chrono::steady_clock::now() - measureStart) / 1000.0;
 
-Image LoadImage(const char *filename) {
-	int width, height, nbComponents;
-	unsigned char *picture = stbi_load(filename, &width, &height, &nbComponents, 0);
+		if(options.json == "-")
+		{
+			WriteBenchmarkJson(std::cout, report);
+		}
+		else
+		{
+			std::ofstream out(options.json);
+			WriteBenchmarkJson(out, report);
+			if(!out.good())
+			{
+				throw std::runtime_error("Cannot write file: " + options.json);
+			}
+		}
+	}
 
-	if (!picture)
+	if(!options.trace.empty())
 	{
-		stbi_image_free(picture);
-		throw std::runtime_error("File not found: " + std::string(filename));
-		exit(EXIT_FAILURE);
+		// the queries of the last frame
+		gpuProfiler->FrameEnd();
+
+		std::ofstream out(options.trace);
+		WriteChromeTrace(out);
+		if(!out.good())
+		{
+			throw std::runtime_error("Cannot write file: " + options.trace);
+		}
 	}
 
-	return { picture, width, height };
+	// GL objects go while the context is alive
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteTextures(1, &ct);
+	glDeleteTextures(1, &dt);
+	gpuProfiler.reset();
+	scene.reset();
+	queue.reset();
+	arena.reset();
+	assets.reset();
+	shaders.reset();
 }
 
-int main(void)
+static int RunHeadless(const RunOptions &options)
+{
+#ifdef GAMAGORA_HAS_EGL
+	HeadlessContext context;
+
+	// a fixed step keeps headless runs comparable
+	RunFrames(options, [](Scene &, GLuint, float &) {
+		// the frame is over when the GPU is done, as a swap would wait for
+		glFinish();
+		return true;
+	});
+	return EXIT_SUCCESS;
+#else
+	(void)options;
+	std::cerr << "Built without EGL: --headless is not available" << std::endl;
+	return EXIT_FAILURE;
+#endif
+}
+
+static int RunWindowed(const RunOptions &options)
 {
 	GLFWwindow* window;
 	glfwSetErrorCallback(error_callback);
@@ -151,7 +293,7 @@ int main(void)
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
 	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
 
-	window = glfwCreateWindow(1200, 1200, "Simple example", NULL, NULL);
+	window = glfwCreateWindow(options.width, options.height, "Simple example", NULL, NULL);
 
 	if (!window)
 	{
@@ -161,7 +303,7 @@ int main(void)
 
 	glfwSetKeyCallback(window, key_callback);
 	glfwMakeContextCurrent(window);
-	glfwSwapInterval(1);
+	glfwSwapInterval(options.vsync ? 1 : 0);
 	// NOTE: OpenGL error checks have been omitted for brevity
 
 	if(!gladLoadGL()) {
@@ -172,122 +314,63 @@ int main(void)
 	// Callbacks
 	glDebugMessageCallback(opengl_error_callback, nullptr);
 
-	// Shader
-	const auto vertex = MakeShader(GL_VERTEX_SHADER, "resources/shaders/shaderStl.vert");
-	const auto fragment = MakeShader(GL_FRAGMENT_SHADER, "resources/shaders/shaderStl.frag");
-
-	// Program
-	const auto program = AttachAndLink({ vertex, fragment });
-	glUseProgram(program);
-
-
-	// Quads
-	//Vertices
-	float triangles[] = {
-		// positions          // colors           // texture coords
-		 0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f,   // top right
-		 0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f,   // bottom right
-		-0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f,   // bottom left
-		-0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f    // top left 
-	};
-	//Indices
-	unsigned int indices[] = {
-		0, 1, 3, // first triangle
-		1, 2, 3  // second triangle
-	};
-
-	// Buffers
-	GLuint vao, vbo, ebo;
-	glGenVertexArrays(1, &vao);
-	glGenBuffers(1, &vbo);
-	glGenBuffers(1, &ebo);
-
-	glBindVertexArray(vao);
-
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(triangles), triangles, GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	
-	// Bindings
-	//Position
-	const auto indexPosition = glGetAttribLocation(program, "position");
-	glVertexAttribPointer(indexPosition, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
-	glEnableVertexAttribArray(indexPosition);
-
-	//Color
-	const auto indexColor = glGetAttribLocation(program, "color");
-	glVertexAttribPointer(indexColor, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float)));
-	glEnableVertexAttribArray(indexColor);
-
-	//UV
-	const auto indexTexUV = glGetAttribLocation(program, "texuv");
-	glVertexAttribPointer(indexTexUV, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
-	glEnableVertexAttribArray(indexTexUV);
-
-
-	//Texture
-	const char *filename = "resources/images/wall.jpg";
-	Image im = LoadImage(filename);
-
-	GLuint tex;
-	glCreateTextures(GL_TEXTURE_2D, 1, &tex);
-	glTextureStorage2D(tex, 1, GL_RGB8, im.width, im.height);
-
-	GLuint texUnit = {0};
-	glTextureSubImage2D(tex, 0, 0, 0, im.width, im.height, GL_RGB, GL_UNSIGNED_BYTE, im.data);
-	glBindTextureUnit(texUnit, tex);
-
-
-	//FrameBuffer
-	GLuint fbo;
-	glCreateFramebuffers(1, &fbo);
-
-	GLuint ct;
-	glCreateTextures(GL_TEXTURE_2D, 1, &ct);
-	glTextureStorage2D(ct, 1, GL_RGB8, width, height);
-
-	GLuint dt;
-	glCreateTextures(GL_TEXTURE_2D, 1, &dt);
-	glTextureStorage2D(dt, 1, GL_DEPTH_COMPONENT32F, width, height);
-
-	glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, ct, 0);
-	glNamedFramebufferTexture(fbo, GL_DEPTH_ATTACHMENT, dt, 0);
+	lastFrame = float(glfwGetTime());
 
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	RunFrames(options, [&](Scene &scene, GLuint fbo, float &nextDelta) {
+		// the offscreen image, scaled to the window
+		int width, height;
+		glfwGetFramebufferSize(window, &width, &height);
+		glBlitNamedFramebuffer(fbo, 0, 0, 0, options.width, options.height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
 
-	//Options
-	glPointSize(10.f);
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_PROGRAM_POINT_SIZE);
+		glfwSwapBuffers(window);
+		glfwPollEvents();
 
-	while (!glfwWindowShouldClose(window))
-	{
-		float currentFrame = glfwGetTime();
+		float currentFrame = float(glfwGetTime());
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
+		nextDelta = deltaTime;
 
-		glfwGetFramebufferSize(window, &width, &height);
-		glViewport(0, 0, width, height);
+		double xpos, ypos;
+		glfwGetCursorPos(window, &xpos, &ypos);
+		int windowWidth, windowHeight;
+		glfwGetWindowSize(window, &windowWidth, &windowHeight);
+		scene.Pointer(ScreenCoordinatesToWorldCoordinates(xpos, ypos, windowWidth, windowHeight));
 
-		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		return !glfwWindowShouldClose(window);
+	});
 
+	glfwDestroyWindow(window);
+	glfwTerminate();
 
+	return EXIT_SUCCESS;
+}
 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+int main(int argc, char **argv)
+{
+	RunOptions options;
+	try
+	{
+		options = ParseRunOptions(argc, argv);
+	}
+	catch(const std::exception &e)
+	{
+		std::cerr << e.what() << "\n" << RunOptionsUsage();
+		return EXIT_FAILURE;
 	}
 
-	stbi_image_free(im.data);
-
-	glfwDestroyWindow(window);
-	glfwTerminate();
-
-	//system("pause");
+	if(options.help)
+	{
+		std::cout << RunOptionsUsage();
+		return EXIT_SUCCESS;
+	}
 
-	exit(EXIT_SUCCESS);
+	try
+	{
+		return options.headless ? RunHeadless(options) : RunWindowed(options);
+	}
+	catch(const std::exception &e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
 }
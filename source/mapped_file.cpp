@@ -0,0 +1,105 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const char *filename)
+	: data(nullptr), size(0), file(INVALID_HANDLE_VALUE), mapping(nullptr)
+{
+	file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error(std::string("Cannot open file: ") + filename);
+	}
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	size = std::size_t(fileSize.QuadPart);
+
+	// an empty file cannot be mapped, it is simply left without data
+	if(size > 0)
+	{
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if(mapping)
+		{
+			data = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+		if(!data)
+		{
+			if(mapping)
+			{
+				CloseHandle(mapping);
+			}
+			CloseHandle(file);
+			throw std::runtime_error(std::string("Cannot map file: ") + filename);
+		}
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if(data)
+	{
+		UnmapViewOfFile(data);
+	}
+	if(mapping)
+	{
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+}
+#else
+MappedFile::MappedFile(const char *filename)
+	: data(nullptr), size(0)
+{
+	const int fd = open(filename, O_RDONLY);
+	if(fd < 0)
+	{
+		throw std::runtime_error(std::string("Cannot open file: ") + filename);
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0)
+	{
+		close(fd);
+		throw std::runtime_error(std::string("Cannot stat file: ") + filename);
+	}
+	size = std::size_t(st.st_size);
+
+	// an empty file cannot be mapped, it is simply left without data
+	if(size > 0)
+	{
+		void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(p == MAP_FAILED)
+		{
+			close(fd);
+			throw std::runtime_error(std::string("Cannot map file: ") + filename);
+		}
+		madvise(p, size, MADV_WILLNEED);
+		data = static_cast<const unsigned char *>(p);
+	}
+
+	// the mapping stays valid once the descriptor is closed
+	close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+	if(data)
+	{
+		munmap(const_cast<unsigned char *>(data), size);
+	}
+}
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+// Read-only memory mapping of a whole file, unmapped on destruction.
+class MappedFile
+{
+public:
+	explicit MappedFile(const char *filename);
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	const unsigned char *Data() const { return data; }
+	std::size_t Size() const { return size; }
+
+private:
+	const unsigned char *data;
+	std::size_t size;
+
+#ifdef _WIN32
+	void *file;
+	void *mapping;
+#endif
+};
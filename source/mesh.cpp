@@ -0,0 +1,461 @@
+#include "mesh.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+static const uint32_t invalidIndex = std::numeric_limits<uint32_t>::max();
+
+/* WELDING */
+
+struct CellKey
+{
+	int64_t x, y, z;
+
+	bool operator==(const CellKey &o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+static uint64_t HashCell(const CellKey &k)
+{
+	// large primes from Teschner et al., "Optimized Spatial Hashing"
+	return uint64_t(k.x) * 73856093ull ^ uint64_t(k.y) * 19349663ull ^ uint64_t(k.z) * 83492791ull;
+}
+
+// Open addressing table from cell to the first vertex stored in it
+class CellTable
+{
+public:
+	explicit CellTable(std::size_t maxCells)
+	{
+		std::size_t size = 16;
+		while(size < maxCells * 2)
+		{
+			size *= 2;
+		}
+		keys.resize(size);
+		heads.assign(size, invalidIndex);
+		mask = size - 1;
+	}
+
+	// Slot of `key`, or of the empty slot where it would go
+	std::size_t Find(const CellKey &key) const
+	{
+		std::size_t slot = std::size_t(HashCell(key)) & mask;
+		while(heads[slot] != invalidIndex && !(keys[slot] == key))
+		{
+			slot = (slot + 1) & mask;
+		}
+		return slot;
+	}
+
+	std::vector<CellKey> keys;
+	std::vector<uint32_t> heads;
+
+private:
+	std::size_t mask;
+};
+
+static CellKey CellOf(const glm::vec3 &p, float epsilon)
+{
+	if(epsilon <= 0.0f)
+	{
+		// exact welding: the cell is the bit pattern itself (with -0 folded into +0)
+		uint32_t bits[3];
+		const float v[3] = {p.x + 0.0f, p.y + 0.0f, p.z + 0.0f};
+		std::memcpy(bits, v, sizeof(bits));
+		return {bits[0], bits[1], bits[2]};
+	}
+
+	return {
+		int64_t(std::floor(p.x / epsilon)),
+		int64_t(std::floor(p.y / epsilon)),
+		int64_t(std::floor(p.z / epsilon))
+	};
+}
+
+Mesh WeldTriangles(const std::vector<Triangle> &tris, float epsilon)
+{
+	Mesh mesh;
+	mesh.indices.reserve(tris.size() * 3);
+
+	CellTable table(tris.size() * 3);
+	// next vertex in the same cell
+	std::vector<uint32_t> next;
+
+	const float epsilon2 = epsilon * epsilon;
+	const int reach = epsilon > 0.0f ? 1 : 0;
+
+	const auto weld = [&](const glm::vec3 &p) -> uint32_t {
+		const CellKey cell = CellOf(p, epsilon);
+
+		// a match within epsilon can only sit in the 27 surrounding cells
+		for(int dz = -reach; dz <= reach; ++dz)
+		for(int dy = -reach; dy <= reach; ++dy)
+		for(int dx = -reach; dx <= reach; ++dx)
+		{
+			const std::size_t slot = table.Find({cell.x + dx, cell.y + dy, cell.z + dz});
+			for(uint32_t v = table.heads[slot]; v != invalidIndex; v = next[v])
+			{
+				const glm::vec3 d = mesh.positions[v] - p;
+				if(glm::dot(d, d) <= epsilon2)
+				{
+					return v;
+				}
+			}
+		}
+
+		const uint32_t index = uint32_t(mesh.positions.size());
+		const std::size_t slot = table.Find(cell);
+		next.push_back(table.heads[slot]);
+		table.keys[slot] = cell;
+		table.heads[slot] = index;
+		mesh.positions.push_back(p);
+		return index;
+	};
+
+	for(const auto &t : tris)
+	{
+		mesh.indices.push_back(weld(t.p0));
+		mesh.indices.push_back(weld(t.p1));
+		mesh.indices.push_back(weld(t.p2));
+	}
+
+	return mesh;
+}
+
+/* NORMALS */
+
+static glm::vec3 FaceNormal(const Mesh &mesh, std::size_t triangle)
+{
+	const glm::vec3 &a = mesh.positions[mesh.indices[3 * triangle + 0]];
+	const glm::vec3 &b = mesh.positions[mesh.indices[3 * triangle + 1]];
+	const glm::vec3 &c = mesh.positions[mesh.indices[3 * triangle + 2]];
+
+	// length is twice the area, which weights the smooth average
+	return glm::cross(b - a, c - a);
+}
+
+static glm::vec3 SafeNormalize(const glm::vec3 &n)
+{
+	const float length = glm::length(n);
+	return length > 0.0f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+}
+
+void ComputeNormals(Mesh &mesh, NormalMode mode)
+{
+	const std::size_t triCount = mesh.indices.size() / 3;
+
+	if(mode == NormalMode::Smooth)
+	{
+		mesh.normals.assign(mesh.positions.size(), glm::vec3(0.0f));
+		for(std::size_t t = 0; t < triCount; ++t)
+		{
+			const glm::vec3 n = FaceNormal(mesh, t);
+			for(int k = 0; k < 3; ++k)
+			{
+				mesh.normals[mesh.indices[3 * t + k]] += n;
+			}
+		}
+
+		for(auto &n : mesh.normals)
+		{
+			n = SafeNormalize(n);
+		}
+		return;
+	}
+
+	// Faceted: every corner reuses a copy of its vertex with the same normal,
+	// or makes a new one. Copies of a vertex are chained through nextCopy.
+	const float coplanar = 0.9999f;
+
+	const std::size_t originalCount = mesh.positions.size();
+	std::vector<uint32_t> firstCopy(originalCount, invalidIndex);
+	std::vector<uint32_t> nextCopy;
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	positions.reserve(originalCount);
+	normals.reserve(originalCount);
+
+	for(std::size_t t = 0; t < triCount; ++t)
+	{
+		const glm::vec3 n = FaceNormal(mesh, t);
+		const float length = glm::length(n);
+
+		for(int k = 0; k < 3; ++k)
+		{
+			const uint32_t v = mesh.indices[3 * t + k];
+
+			uint32_t copy = firstCopy[v];
+			// degenerate faces take whichever copy already exists
+			while(copy != invalidIndex && length > 0.0f && glm::dot(normals[copy], n / length) < coplanar)
+			{
+				copy = nextCopy[copy];
+			}
+
+			if(copy == invalidIndex)
+			{
+				copy = uint32_t(positions.size());
+				positions.push_back(mesh.positions[v]);
+				normals.push_back(SafeNormalize(n));
+				nextCopy.push_back(firstCopy[v]);
+				firstCopy[v] = copy;
+			}
+
+			mesh.indices[3 * t + k] = copy;
+		}
+	}
+
+	mesh.positions = std::move(positions);
+	mesh.normals = std::move(normals);
+}
+
+/* VERTEX CACHE */
+
+namespace
+{
+	const int forsythCacheSize = 32;
+
+	// scoring constants from the original article
+	const float cacheDecayPower = 1.5f;
+	const float lastTriangleScore = 0.75f;
+	const float valenceBoostScale = 2.0f;
+	const float valenceBoostPower = 0.5f;
+
+	float VertexScore(int cachePosition, uint32_t remaining)
+	{
+		if(remaining == 0)
+		{
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if(cachePosition >= 0)
+		{
+			if(cachePosition < 3)
+			{
+				// the triangle just emitted, slightly penalized to avoid strips
+				score = lastTriangleScore;
+			}
+			else
+			{
+				const float scale = 1.0f / (forsythCacheSize - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scale, cacheDecayPower);
+			}
+		}
+
+		// favour vertices with few triangles left, so they get finished
+		return score + valenceBoostScale * std::pow(float(remaining), -valenceBoostPower);
+	}
+}
+
+void OptimizeVertexCache(Mesh &mesh)
+{
+	const std::size_t vertexCount = mesh.positions.size();
+	const std::size_t triCount = mesh.indices.size() / 3;
+	if(triCount == 0)
+	{
+		return;
+	}
+
+	// vertex -> triangles adjacency, compacted as triangles get emitted
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for(const uint32_t v : mesh.indices)
+	{
+		++remaining[v];
+	}
+
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for(std::size_t v = 0; v < vertexCount; ++v)
+	{
+		offsets[v + 1] = offsets[v] + remaining[v];
+	}
+
+	std::vector<uint32_t> adjacency(mesh.indices.size());
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for(std::size_t t = 0; t < triCount; ++t)
+		{
+			for(int k = 0; k < 3; ++k)
+			{
+				adjacency[fill[mesh.indices[3 * t + k]]++] = uint32_t(t);
+			}
+		}
+	}
+
+	std::vector<float> vertexScore(vertexCount);
+	for(std::size_t v = 0; v < vertexCount; ++v)
+	{
+		vertexScore[v] = VertexScore(-1, remaining[v]);
+	}
+
+	const auto triangleScore = [&](std::size_t t) {
+		return vertexScore[mesh.indices[3 * t]] + vertexScore[mesh.indices[3 * t + 1]] + vertexScore[mesh.indices[3 * t + 2]];
+	};
+	std::vector<bool> emitted(triCount, false);
+
+	std::vector<uint32_t> cache, newCache;
+	cache.reserve(forsythCacheSize + 3);
+	newCache.reserve(forsythCacheSize + 3);
+
+	std::vector<uint32_t> output;
+	output.reserve(mesh.indices.size());
+
+	uint32_t best = 0;
+	for(std::size_t t = 1; t < triCount; ++t)
+	{
+		if(triangleScore(t) > triangleScore(best))
+		{
+			best = uint32_t(t);
+		}
+	}
+
+	// triangles not touching the cache are picked in order from here
+	std::size_t scan = 0;
+
+	for(std::size_t emittedCount = 0; emittedCount < triCount; ++emittedCount)
+	{
+		if(best == invalidIndex)
+		{
+			while(emitted[scan])
+			{
+				++scan;
+			}
+			best = uint32_t(scan);
+		}
+
+		emitted[best] = true;
+
+		newCache.clear();
+		for(int k = 0; k < 3; ++k)
+		{
+			const uint32_t v = mesh.indices[3 * best + k];
+			output.push_back(v);
+			newCache.push_back(v);
+
+			// drop the triangle from the vertex adjacency
+			uint32_t *begin = &adjacency[offsets[v]];
+			uint32_t *end = begin + remaining[v];
+			for(uint32_t *it = begin; it != end; ++it)
+			{
+				if(*it == best)
+				{
+					*it = *(end - 1);
+					break;
+				}
+			}
+			--remaining[v];
+		}
+
+		// LRU: emitted vertices move to the front
+		for(const uint32_t v : cache)
+		{
+			if(v != newCache[0] && v != newCache[1] && v != newCache[2])
+			{
+				newCache.push_back(v);
+			}
+		}
+
+		for(std::size_t i = forsythCacheSize; i < newCache.size(); ++i)
+		{
+			vertexScore[newCache[i]] = VertexScore(-1, remaining[newCache[i]]);
+		}
+		if(newCache.size() > std::size_t(forsythCacheSize))
+		{
+			newCache.resize(forsythCacheSize);
+		}
+		cache.swap(newCache);
+
+		for(std::size_t i = 0; i < cache.size(); ++i)
+		{
+			vertexScore[cache[i]] = VertexScore(int(i), remaining[cache[i]]);
+		}
+
+		// only triangles around cached vertices changed score
+		best = invalidIndex;
+		float bestScore = -1.0f;
+		for(const uint32_t v : cache)
+		{
+			for(uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; ++a)
+			{
+				const uint32_t t = adjacency[a];
+				const float score = triangleScore(t);
+				if(score > bestScore)
+				{
+					bestScore = score;
+					best = t;
+				}
+			}
+		}
+	}
+
+	mesh.indices.swap(output);
+}
+
+void OptimizeVertexFetch(Mesh &mesh)
+{
+	std::vector<uint32_t> remap(mesh.positions.size(), invalidIndex);
+	uint32_t count = 0;
+
+	for(auto &index : mesh.indices)
+	{
+		if(remap[index] == invalidIndex)
+		{
+			remap[index] = count++;
+		}
+		index = remap[index];
+	}
+
+	// unreferenced vertices are dropped
+	std::vector<glm::vec3> positions(count);
+	std::vector<glm::vec3> normals(mesh.normals.empty() ? 0 : count);
+	for(std::size_t v = 0; v < remap.size(); ++v)
+	{
+		if(remap[v] == invalidIndex)
+		{
+			continue;
+		}
+		positions[remap[v]] = mesh.positions[v];
+		if(!normals.empty())
+		{
+			normals[remap[v]] = mesh.normals[v];
+		}
+	}
+
+	mesh.positions = std::move(positions);
+	mesh.normals = std::move(normals);
+}
+
+float ComputeAcmr(const std::vector<uint32_t> &indices, std::size_t vertexCount, unsigned cacheSize)
+{
+	if(indices.empty())
+	{
+		return 0.0f;
+	}
+
+	// FIFO cache: a vertex is cached while fewer than cacheSize misses happened since its own
+	std::vector<uint64_t> insertedAt(vertexCount, 0);
+	uint64_t misses = 0;
+
+	for(const uint32_t v : indices)
+	{
+		if(insertedAt[v] == 0 || misses + 1 - insertedAt[v] > cacheSize)
+		{
+			++misses;
+			insertedAt[v] = misses;
+		}
+	}
+
+	return float(misses) / float(indices.size() / 3);
+}
+
+Mesh BuildMesh(const std::vector<Triangle> &tris, float epsilon, NormalMode mode)
+{
+	Mesh mesh = WeldTriangles(tris, epsilon);
+	ComputeNormals(mesh, mode);
+	OptimizeVertexCache(mesh);
+	OptimizeVertexFetch(mesh);
+	return mesh;
+}
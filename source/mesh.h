@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "stl.h"
+
+// Indexed triangle mesh, ready to be uploaded as vertex and index buffers
+struct Mesh
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<uint32_t> indices;
+};
+
+enum class NormalMode
+{
+	// area-weighted average of the faces around each vertex
+	Smooth,
+	// vertices are split wherever adjacent faces are not coplanar
+	Faceted
+};
+
+// Merges the vertices of a triangle soup closer than epsilon, through a
+// spatial hash with cells of size epsilon. epsilon = 0 merges exact copies.
+Mesh WeldTriangles(const std::vector<Triangle> &tris, float epsilon);
+
+// Fills mesh.normals, duplicating vertices in Faceted mode
+void ComputeNormals(Mesh &mesh, NormalMode mode);
+
+// Reorders triangles for post-transform cache reuse (Forsyth, "Linear-speed
+// vertex cache optimisation")
+void OptimizeVertexCache(Mesh &mesh);
+
+// Renumbers vertices in order of first use so fetches walk memory forward
+void OptimizeVertexFetch(Mesh &mesh);
+
+// Average cache miss ratio: transformed vertices per triangle for a FIFO
+// cache of the given size. 3 for a triangle soup, 0.5 at best.
+float ComputeAcmr(const std::vector<uint32_t> &indices, std::size_t vertexCount, unsigned cacheSize = 16);
+
+// Weld, normals, then cache and fetch optimizations
+Mesh BuildMesh(const std::vector<Triangle> &tris, float epsilon, NormalMode mode);
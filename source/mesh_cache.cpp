@@ -0,0 +1,231 @@
+#include "mesh_cache.h"
+#include "ply.h"
+#include "stl.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+
+using namespace MeshCacheFormat;
+
+static const uint64_t sectionAlignment = 64;
+
+static_assert(sizeof(glm::vec3) == 12, "glm::vec3 must be three packed floats");
+
+MeshCache::MeshCache(const char * filename)
+	: file(filename), header(nullptr)
+{
+	const std::string name(filename);
+	if(file.Size() < sizeof(Header) || std::memcmp(file.Data(), magic, sizeof(magic)) != 0)
+	{
+		throw std::runtime_error("Not a mesh cache: " + name);
+	}
+
+	header = reinterpret_cast<const Header *>(file.Data());
+	if(header->version != version || header->headerSize != sizeof(Header))
+	{
+		throw std::runtime_error("Mesh cache version mismatch: " + name);
+	}
+	if(header->normalMode > uint32_t(NormalMode::Faceted))
+	{
+		throw std::runtime_error("Corrupt mesh cache: " + name);
+	}
+
+	const uint64_t expected[SectionCount] = {
+		uint64_t(header->vertexCount) * sizeof(glm::vec3),
+		uint64_t(header->vertexCount) * sizeof(glm::vec3),
+		uint64_t(header->indexCount) * sizeof(uint32_t)
+	};
+
+	for(int s = 0; s < SectionCount; ++s)
+	{
+		const auto & section = header->sections[s];
+		if(section.size != expected[s] || section.offset % sectionAlignment != 0
+				|| section.offset > file.Size() || section.size > file.Size() - section.offset)
+		{
+			throw std::runtime_error("Truncated mesh cache: " + name);
+		}
+	}
+}
+
+glm::vec3 MeshCache::BoundsMin() const
+{
+	return glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+}
+
+glm::vec3 MeshCache::BoundsMax() const
+{
+	return glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+}
+
+MeshOptions MeshCache::Options() const
+{
+	MeshOptions options;
+	options.epsilon = header->weldEpsilon;
+	options.normals = NormalMode(header->normalMode);
+	return options;
+}
+
+bool MeshCache::IsUpToDate(const char * sourcePath) const
+{
+	return CompareSource(sourcePath) != FileMatch::Different;
+}
+
+FileMatch MeshCache::CompareSource(const char * sourcePath, FileIdentity * current) const
+{
+	return CompareFile({header->sourceSize, header->sourceTime, header->sourceHash}, sourcePath, current);
+}
+
+Mesh MeshCache::ToMesh() const
+{
+	Mesh mesh;
+	mesh.positions.assign(Positions(), Positions() + VertexCount());
+	mesh.normals.assign(Normals(), Normals() + VertexCount());
+	mesh.indices.assign(Indices(), Indices() + IndexCount());
+	return mesh;
+}
+
+static bool HasExtension(const char * path, const char * extension)
+{
+	std::string ext = std::filesystem::path(path).extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+	return ext == extension;
+}
+
+Mesh LoadSourceMesh(const char * sourcePath, const MeshOptions & options)
+{
+	if(HasExtension(sourcePath, ".ply"))
+	{
+		Mesh mesh = ReadPly(sourcePath);
+		if(mesh.normals.size() != mesh.positions.size())
+		{
+			ComputeNormals(mesh, options.normals);
+		}
+		OptimizeVertexCache(mesh);
+		OptimizeVertexFetch(mesh);
+		return mesh;
+	}
+
+	if(HasExtension(sourcePath, ".stl"))
+	{
+		return BuildMesh(ReadStlMapped(sourcePath), options.epsilon, options.normals);
+	}
+
+	throw std::runtime_error(std::string("Unknown mesh format: ") + sourcePath);
+}
+
+void WriteMeshCache(const char * cachePath, const Mesh & mesh, const char * sourcePath, const MeshOptions & options)
+{
+	if(mesh.normals.size() != mesh.positions.size())
+	{
+		throw std::runtime_error("Mesh cache needs one normal per vertex");
+	}
+	if(mesh.positions.size() > std::numeric_limits<uint32_t>::max() || mesh.indices.size() > std::numeric_limits<uint32_t>::max())
+	{
+		throw std::runtime_error("Mesh too large for a mesh cache");
+	}
+
+	Header header = {};
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.headerSize = sizeof(Header);
+
+	const FileIdentity source = IdentifyFile(sourcePath);
+	header.sourceSize = source.size;
+	header.sourceTime = source.time;
+	header.sourceHash = source.hash;
+
+	header.weldEpsilon = options.epsilon;
+	header.normalMode = uint32_t(options.normals);
+
+	header.vertexCount = uint32_t(mesh.positions.size());
+	header.indexCount = uint32_t(mesh.indices.size());
+
+	glm::vec3 lo(0.0f), hi(0.0f);
+	if(!mesh.positions.empty())
+	{
+		lo = hi = mesh.positions[0];
+		for(const auto & p : mesh.positions)
+		{
+			lo = glm::min(lo, p);
+			hi = glm::max(hi, p);
+		}
+	}
+	for(int k = 0; k < 3; ++k)
+	{
+		header.boundsMin[k] = lo[k];
+		header.boundsMax[k] = hi[k];
+	}
+
+	const void * data[SectionCount] = {mesh.positions.data(), mesh.normals.data(), mesh.indices.data()};
+	const uint64_t sizes[SectionCount] = {
+		mesh.positions.size() * sizeof(glm::vec3),
+		mesh.normals.size() * sizeof(glm::vec3),
+		mesh.indices.size() * sizeof(uint32_t)
+	};
+
+	uint64_t offset = sizeof(Header);
+	for(int s = 0; s < SectionCount; ++s)
+	{
+		offset = (offset + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+		header.sections[s] = {offset, sizes[s]};
+		offset += sizes[s];
+	}
+
+	std::vector<FileRange> ranges;
+	for(int s = 0; s < SectionCount; ++s)
+	{
+		ranges.push_back({header.sections[s].offset, data[s], sizes[s]});
+	}
+	WriteFileAside(cachePath, &header, sizeof(header), ranges);
+}
+
+std::string MeshCachePath(const char * sourcePath)
+{
+	return std::string(sourcePath) + ".meshcache";
+}
+
+static bool SameOptions(const MeshOptions & a, const MeshOptions & b)
+{
+	return a.epsilon == b.epsilon && a.normals == b.normals;
+}
+
+std::unique_ptr<MeshCache> LoadMeshCached(const char * sourcePath, const MeshOptions & options, const std::string & cachePath)
+{
+	const std::string path = cachePath.empty() ? MeshCachePath(sourcePath) : cachePath;
+
+	if(std::filesystem::exists(path))
+	{
+		try
+		{
+			std::unique_ptr<MeshCache> cache(new MeshCache(path.c_str()));
+			FileIdentity current;
+			const FileMatch match = SameOptions(cache->Options(), options) ? cache->CompareSource(sourcePath, &current)
+					: FileMatch::Different;
+			if(match == FileMatch::Touched)
+			{
+				// unmapped while its header is patched
+				cache.reset();
+				RewriteRecordedTime(path.c_str(), offsetof(Header, sourceTime), current.time);
+				cache.reset(new MeshCache(path.c_str()));
+			}
+			if(match != FileMatch::Different)
+			{
+				return cache;
+			}
+		}
+		catch(const std::runtime_error &)
+		{
+			// corrupt or from another version: rebuilt below
+		}
+	}
+
+	WriteMeshCache(path.c_str(), LoadSourceMesh(sourcePath, options), sourcePath, options);
+	return std::unique_ptr<MeshCache>(new MeshCache(path.c_str()));
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "file_identity.h"
+#include "mapped_file.h"
+#include "mesh.h"
+
+// How the source is turned into the cached mesh
+struct MeshOptions
+{
+	// vertices closer than this are welded (STL only)
+	float epsilon = 1e-5f;
+	NormalMode normals = NormalMode::Smooth;
+};
+
+// On-disk layout of a preprocessed mesh. Every section starts on a 64-byte
+// boundary and holds tightly packed little-endian data, ready for glBufferData.
+namespace MeshCacheFormat
+{
+	const char magic[8] = {'G', 'G', 'L', 'M', 'E', 'S', 'H', '\0'};
+	const uint32_t version = 2;
+
+	enum Section
+	{
+		Positions,
+		Normals,
+		Indices,
+		SectionCount
+	};
+
+	struct SectionEntry
+	{
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+
+		// source identity: size and mtime are checked first, the hash
+		// only when the mtime moved
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		uint64_t sourceHash;
+
+		// the MeshOptions it was built with
+		float weldEpsilon;
+		uint32_t normalMode;
+
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		float boundsMin[3];
+		float boundsMax[3];
+
+		SectionEntry sections[SectionCount];
+	};
+}
+
+// Read-only view of a mesh cache file, the streams point into the mapping
+class MeshCache
+{
+public:
+	// Maps and validates the file, throws if it is not a usable cache
+	explicit MeshCache(const char * filename);
+
+	uint32_t VertexCount() const { return header->vertexCount; }
+	uint32_t IndexCount() const { return header->indexCount; }
+	MeshOptions Options() const;
+	glm::vec3 BoundsMin() const;
+	glm::vec3 BoundsMax() const;
+
+	const glm::vec3 * Positions() const { return Section<glm::vec3>(MeshCacheFormat::Positions); }
+	const glm::vec3 * Normals() const { return Section<glm::vec3>(MeshCacheFormat::Normals); }
+	const uint32_t * Indices() const { return Section<uint32_t>(MeshCacheFormat::Indices); }
+
+	// Whether `sourcePath` is still the file this cache was built from
+	bool IsUpToDate(const char * sourcePath) const;
+	FileMatch CompareSource(const char * sourcePath, FileIdentity * current = nullptr) const;
+
+	// Copies the streams back into an owning Mesh
+	Mesh ToMesh() const;
+
+private:
+	template<typename T>
+	const T * Section(MeshCacheFormat::Section s) const
+	{
+		return reinterpret_cast<const T *>(file.Data() + header->sections[s].offset);
+	}
+
+	MappedFile file;
+	const MeshCacheFormat::Header * header;
+};
+
+// STL or PLY by extension, welded, with normals and cache-optimized
+Mesh LoadSourceMesh(const char * sourcePath, const MeshOptions & options = MeshOptions());
+
+// `options` are those `mesh` was built with, recorded for LoadMeshCached
+void WriteMeshCache(const char * cachePath, const Mesh & mesh, const char * sourcePath, const MeshOptions & options = MeshOptions());
+
+// Default cache location: next to the source, with a .meshcache suffix
+std::string MeshCachePath(const char * sourcePath);
+
+// Opens the cache of `sourcePath`, (re)building it first when missing, stale
+// or built with other options
+std::unique_ptr<MeshCache> LoadMeshCached(const char * sourcePath, const MeshOptions & options = MeshOptions(),
+		const std::string & cachePath = std::string());
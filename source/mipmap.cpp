@@ -0,0 +1,239 @@
+#include "mipmap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIPMAP_SSE2
+#endif
+
+namespace
+{
+	float SrgbToLinear(float c)
+	{
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSrgb(float c)
+	{
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	// 8-bit sRGB -> linear float
+	struct DecodeTable
+	{
+		float values[256];
+
+		DecodeTable()
+		{
+			for(int i = 0; i < 256; ++i)
+			{
+				values[i] = SrgbToLinear(i / 255.0f);
+			}
+		}
+	};
+
+	// linear float -> 8-bit sRGB, fine enough near black where sRGB is steep
+	struct EncodeTable
+	{
+		static const int size = 1 << 16;
+		unsigned char values[size];
+
+		EncodeTable()
+		{
+			for(int i = 0; i < size; ++i)
+			{
+				values[i] = (unsigned char)(LinearToSrgb(i / float(size - 1)) * 255.0f + 0.5f);
+			}
+		}
+
+		unsigned char operator()(float linear) const
+		{
+			return values[int(std::min(std::max(linear, 0.0f), 1.0f) * (size - 1) + 0.5f)];
+		}
+	};
+
+	const DecodeTable &Decode()
+	{
+		static const DecodeTable table;
+		return table;
+	}
+
+	const EncodeTable &Encode()
+	{
+		static const EncodeTable table;
+		return table;
+	}
+
+	// Source texels under one destination texel along an axis, with the
+	// fraction of each it covers
+	struct Taps
+	{
+		int index[3];
+		float weight[3];
+		int count;
+	};
+
+	// 2 to 1 takes two halves. An odd size (2n + 1 to n) spreads each
+	// destination texel over 3 source texels, weighted by overlap, so the
+	// odd row or column is averaged in rather than dropped. 1 stays 1.
+	void AxisTaps(int srcSize, int dstSize, std::vector<Taps> &taps)
+	{
+		taps.resize(dstSize);
+		for(int i = 0; i < dstSize; ++i)
+		{
+			Taps &t = taps[i];
+			if(srcSize == 1)
+			{
+				t = {{0, 0, 0}, {1.0f, 0.0f, 0.0f}, 1};
+			}
+			else if(srcSize % 2 == 0)
+			{
+				t = {{2 * i, 2 * i + 1, 0}, {0.5f, 0.5f, 0.0f}, 2};
+			}
+			else
+			{
+				const float n = float(dstSize), total = float(srcSize);
+				t = {{2 * i, 2 * i + 1, 2 * i + 2}, {(n - i) / total, n / total, (i + 1) / total}, 3};
+			}
+		}
+	}
+
+	// Box filters RGBA float texels, 2x2 or up to 3x3 for odd sizes
+	void Downsample(const std::vector<float> &src, int srcWidth, int srcHeight, std::vector<float> &dst, int dstWidth, int dstHeight)
+	{
+		dst.resize(std::size_t(dstWidth) * dstHeight * 4);
+
+		std::vector<Taps> columns, rows;
+		AxisTaps(srcWidth, dstWidth, columns);
+		AxisTaps(srcHeight, dstHeight, rows);
+
+		for(int y = 0; y < dstHeight; ++y)
+		{
+			const Taps &ty = rows[y];
+			float *out = &dst[std::size_t(y) * dstWidth * 4];
+
+			for(int x = 0; x < dstWidth; ++x)
+			{
+				const Taps &tx = columns[x];
+
+#ifdef MIPMAP_SSE2
+				// one RGBA texel per register
+				__m128 sum = _mm_setzero_ps();
+				for(int j = 0; j < ty.count; ++j)
+				{
+					const float *row = &src[std::size_t(ty.index[j]) * srcWidth * 4];
+					__m128 line = _mm_setzero_ps();
+					for(int i = 0; i < tx.count; ++i)
+					{
+						line = _mm_add_ps(line, _mm_mul_ps(_mm_loadu_ps(row + tx.index[i] * 4), _mm_set1_ps(tx.weight[i])));
+					}
+					sum = _mm_add_ps(sum, _mm_mul_ps(line, _mm_set1_ps(ty.weight[j])));
+				}
+				_mm_storeu_ps(out + 4 * x, sum);
+#else
+				for(int c = 0; c < 4; ++c)
+				{
+					float sum = 0.0f;
+					for(int j = 0; j < ty.count; ++j)
+					{
+						const float *row = &src[std::size_t(ty.index[j]) * srcWidth * 4];
+						float line = 0.0f;
+						for(int i = 0; i < tx.count; ++i)
+						{
+							line += row[tx.index[i] * 4 + c] * tx.weight[i];
+						}
+						sum += line * ty.weight[j];
+					}
+					out[4 * x + c] = sum;
+				}
+#endif
+			}
+		}
+	}
+}
+
+int MipLevelCount(int width, int height)
+{
+	int levels = 1;
+	while(width > 1 || height > 1)
+	{
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		++levels;
+	}
+	return levels;
+}
+
+std::vector<MipLevel> GenerateMipChain(const Image &image, bool srgb)
+{
+	return GenerateMipChain(image.data.get(), image.width, image.height, image.channels, srgb);
+}
+
+std::vector<MipLevel> GenerateMipChain(const unsigned char *pixels, int width, int height, int channels, bool srgb)
+{
+	if(channels < 1 || channels > 4)
+	{
+		throw std::runtime_error("Unsupported channel count: " + std::to_string(channels));
+	}
+
+	const DecodeTable &decode = Decode();
+	const EncodeTable &encode = Encode();
+
+	// level 0: the image expanded to RGBA, grey replicated and alpha opaque by default
+	MipLevel base = {width, height, {}};
+	const std::size_t texelCount = std::size_t(width) * height;
+	base.rgba.resize(texelCount * 4);
+
+	const int n = channels;
+	for(std::size_t i = 0; i < texelCount; ++i)
+	{
+		const unsigned char *p = pixels + i * n;
+		unsigned char *q = &base.rgba[i * 4];
+		q[0] = p[0];
+		q[1] = n >= 3 ? p[1] : p[0];
+		q[2] = n >= 3 ? p[2] : p[0];
+		q[3] = n == 2 ? p[1] : n == 4 ? p[3] : 255;
+	}
+
+	// every level is filtered from the previous one, kept in linear float
+	std::vector<float> linear(texelCount * 4);
+	for(std::size_t i = 0; i < texelCount * 4; ++i)
+	{
+		const unsigned char value = base.rgba[i];
+		linear[i] = srgb && i % 4 != 3 ? decode.values[value] : value / 255.0f;
+	}
+
+	std::vector<MipLevel> chain;
+	chain.reserve(MipLevelCount(width, height));
+	chain.push_back(std::move(base));
+
+	std::vector<float> next;
+
+	while(width > 1 || height > 1)
+	{
+		const int nextWidth = std::max(width / 2, 1);
+		const int nextHeight = std::max(height / 2, 1);
+		Downsample(linear, width, height, next, nextWidth, nextHeight);
+
+		MipLevel level = {nextWidth, nextHeight, std::vector<unsigned char>(next.size())};
+		for(std::size_t i = 0; i < next.size(); ++i)
+		{
+			// alpha is coverage, never gamma encoded
+			level.rgba[i] = srgb && i % 4 != 3
+					? encode(next[i])
+					: (unsigned char)(std::min(std::max(next[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+		}
+		chain.push_back(std::move(level));
+
+		linear.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+
+	return chain;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+
+#include "texture.h"
+
+// One level of a mip chain, always 8-bit RGBA
+struct MipLevel
+{
+	int width, height;
+	std::vector<unsigned char> rgba;
+};
+
+// Full chain down to 1x1 with a box filter: 2x2, or 3 weighted taps along
+// an odd size so its last row/column still counts. With `srgb` the texels are
+// averaged in linear space, so minified levels keep the image brightness.
+std::vector<MipLevel> GenerateMipChain(const Image &image, bool srgb);
+std::vector<MipLevel> GenerateMipChain(const unsigned char *pixels, int width, int height, int channels, bool srgb);
+
+// Number of levels of a full chain for this size
+int MipLevelCount(int width, int height);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+// Unbounded lock-free multi-producer single-consumer queue (Vyukov).
+// Producers only exchange the head pointer; the consumer owns the tail.
+template<typename T>
+class MpscQueue
+{
+public:
+	MpscQueue()
+		: head(new Node), tail(head.load())
+	{
+	}
+
+	~MpscQueue()
+	{
+		T discarded;
+		while(TryPop(discarded))
+		{
+		}
+		delete tail;
+	}
+
+	MpscQueue(const MpscQueue &) = delete;
+	MpscQueue &operator=(const MpscQueue &) = delete;
+
+	// Any thread
+	void Push(T value)
+	{
+		Node *node = new Node;
+		node->value = std::move(value);
+
+		Node *previous = head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	// Consumer thread only. May miss an element whose Push is half done;
+	// it shows up on the next call.
+	bool TryPop(T &value)
+	{
+		Node *next = tail->next.load(std::memory_order_acquire);
+		if(!next)
+		{
+			return false;
+		}
+
+		// `next` becomes the new empty sentinel
+		value = std::move(next->value);
+		delete tail;
+		tail = next;
+		return true;
+	}
+
+private:
+	struct Node
+	{
+		std::atomic<Node *> next{nullptr};
+		T value;
+	};
+
+	std::atomic<Node *> head;
+	Node *tail;
+};
@@ -0,0 +1,202 @@
+#include "particles.h"
+#include "cpu.h"
+#include "profiler.h"
+#include "random.h"
+#include "thread_pool.h"
+
+#include <random>
+
+std::default_random_engine generator;
+std::uniform_real_distribution<float> distribution01(0, 1);
+std::uniform_real_distribution<float> distributionWorld(-1, 1);
+
+std::vector<Particle> MakeParticles(const int n) {
+
+	std::vector<Particle> p;
+	p.reserve(n);
+
+	for(int i = 0; i < n; i++)
+	{
+		p.push_back(Particle{
+				{
+				distributionWorld(generator),
+				distributionWorld(generator),
+				distributionWorld(generator)
+				},
+				{
+				distribution01(generator),
+				distribution01(generator),
+				distribution01(generator)
+				},
+				{0.f, 0.f, 0.f},
+				20.0f * distribution01(generator)
+				});
+	}
+
+	return p;
+}
+
+bool IsOutsideScreen(glm::vec3 pos) {
+	return pos.y < -1.0f || pos.x < -1.0f ||pos.x > 1.0f;
+}
+
+glm::vec3 ScreenCoordinatesToWorldCoordinates(double xpos, double ypos, int width, int height) {
+	return glm::vec3(xpos / width * 2.0f - 1.0f, (ypos / height * 2.0f - 1.0f) * -1.0f, 1.0f);
+}
+
+void ApplyGravity(std::vector<Particle> &particules, const glm::vec3 &spawn, float deltaTime) {
+	PROFILE_ZONE("ApplyGravity");
+
+	for (auto &particle : particules)
+	{
+
+		if (IsOutsideScreen(particle.position)) {
+			particle.position = spawn;
+			particle.speed = glm::vec3(distribution01(generator) * -1.0f, distribution01(generator) * -1.0f, 0.0f) * 5.0f;
+		}
+
+		//Compute acceleration
+		glm::vec3 acceleration = (-particle.size * g * gravityDirection - particle.speed) / particle.size;
+
+		//Compute next speed & position
+		glm::vec3 nextSpeed = particle.speed + acceleration * deltaTime;
+		glm::vec3 nextPosition = particle.position + particle.speed * deltaTime;
+
+		particle.speed = nextSpeed;
+		particle.position = nextPosition;
+	}
+
+}
+
+/* STRUCTURE OF ARRAYS */
+
+void ParticleStreams::Resize(std::size_t n)
+{
+	for(auto stream : {&px, &py, &pz, &vx, &vy, &vz, &size, &red, &green, &blue})
+	{
+		stream->resize(n);
+	}
+}
+
+ParticleStreams ToStreams(const std::vector<Particle> &particules)
+{
+	ParticleStreams s;
+	s.Resize(particules.size());
+
+	for(std::size_t i = 0; i < particules.size(); ++i)
+	{
+		const auto &p = particules[i];
+		s.px[i] = p.position.x; s.py[i] = p.position.y; s.pz[i] = p.position.z;
+		s.vx[i] = p.speed.x; s.vy[i] = p.speed.y; s.vz[i] = p.speed.z;
+		s.size[i] = p.size;
+		s.red[i] = p.color.x; s.green[i] = p.color.y; s.blue[i] = p.color.z;
+	}
+
+	return s;
+}
+
+ParticleStreams MakeParticleStreams(const int n)
+{
+	return ToStreams(MakeParticles(n));
+}
+
+void RespawnParticle(ParticleStreams &particules, std::size_t i, const GravityParams &params)
+{
+	particules.px[i] = params.spawn.x;
+	particules.py[i] = params.spawn.y;
+	particules.pz[i] = params.spawn.z;
+
+	const auto random = Philox4x32::Generate(uint32_t(i), params.frame, 0, 0, params.seed, 0);
+
+	particules.vx[i] = ToUnitFloat(random.v[0]) * -1.0f * 5.0f;
+	particules.vy[i] = ToUnitFloat(random.v[1]) * -1.0f * 5.0f;
+	particules.vz[i] = 0.0f;
+}
+
+void IntegrateGravityScalar(ParticleStreams &particules, std::size_t begin, std::size_t end, const GravityParams &params)
+{
+	const float dt = params.deltaTime;
+
+	for(std::size_t i = begin; i < end; ++i)
+	{
+		const float x = particules.px[i];
+		const float y = particules.py[i];
+		if(y < -1.0f || x < -1.0f || x > 1.0f)
+		{
+			RespawnParticle(particules, i, params);
+		}
+
+		const float size = particules.size[i];
+		const float vx = particules.vx[i];
+		const float vy = particules.vy[i];
+		const float vz = particules.vz[i];
+
+		// Same operations as ApplyGravity with gravityDirection = +y
+		const float ax = -vx / size;
+		const float ay = (-size * g - vy) / size;
+		const float az = -vz / size;
+
+		particules.px[i] += vx * dt;
+		particules.py[i] += vy * dt;
+		particules.pz[i] += vz * dt;
+
+		particules.vx[i] = vx + ax * dt;
+		particules.vy[i] = vy + ay * dt;
+		particules.vz[i] = vz + az * dt;
+	}
+}
+
+const char *SimdLevelName(SimdLevel level)
+{
+	switch(level)
+	{
+	case SimdLevel::Avx2: return "avx2";
+	case SimdLevel::Sse41: return "sse4.1";
+	default: return "scalar";
+	}
+}
+
+SimdLevel BestSimdLevel()
+{
+	const auto &cpu = GetCpuFeatures();
+	if(cpu.avx2)
+	{
+		return SimdLevel::Avx2;
+	}
+	if(cpu.sse41)
+	{
+		return SimdLevel::Sse41;
+	}
+	return SimdLevel::Scalar;
+}
+
+GravityKernel SelectGravityKernel(SimdLevel level)
+{
+	switch(level)
+	{
+	case SimdLevel::Avx2: return IntegrateGravityAvx2;
+	case SimdLevel::Sse41: return IntegrateGravitySse41;
+	default: return IntegrateGravityScalar;
+	}
+}
+
+void IntegrateGravity(ParticleStreams &particules, const GravityParams &params)
+{
+	static const GravityKernel kernel = SelectGravityKernel(BestSimdLevel());
+	kernel(particules, 0, particules.Count(), params);
+}
+
+void SimulateGravity(ParticleStreams &particules, const GravityParams &params, ThreadPool &pool)
+{
+	PROFILE_ZONE("SimulateGravity");
+	static const GravityKernel kernel = SelectGravityKernel(BestSimdLevel());
+
+	// multiple of 16 floats: every chunk starts on a 64-byte boundary
+	const std::size_t grain = 16 * 1024;
+
+	AddProfileCounter(ProfileCounter::ParticlesSimulated, particules.Count());
+	pool.ParallelFor(particules.Count(), grain, [&](std::size_t begin, std::size_t end) {
+		PROFILE_ZONE("gravity chunk");
+		kernel(particules, begin, end, params);
+	});
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "aligned.h"
+
+class ThreadPool;
+
+/* PARTICULES */
+struct Particle {
+	glm::vec3 position;
+	glm::vec3 color;
+	glm::vec3 speed;
+	float size;
+};
+
+static const float g = 3.711f; //m.s-2
+static const glm::vec3 gravityDirection(0.0f, 1.0f, 0.0f);
+
+std::vector<Particle> MakeParticles(const int n);
+
+bool IsOutsideScreen(glm::vec3 pos);
+glm::vec3 ScreenCoordinatesToWorldCoordinates(double xpos, double ypos, int width, int height);
+
+// Reference array-of-structs integrator, respawning particles at `spawn`
+void ApplyGravity(std::vector<Particle> &particules, const glm::vec3 &spawn, float deltaTime);
+
+/* STRUCTURE OF ARRAYS */
+
+// Each attribute lives in its own 64-byte aligned stream so the integrator
+// can load 4 (SSE) or 8 (AVX) particles per instruction.
+// The SIMD kernels assume gravityDirection is +y.
+struct ParticleStreams
+{
+	AlignedVector<float> px, py, pz;
+	AlignedVector<float> vx, vy, vz;
+	AlignedVector<float> size;
+	AlignedVector<float> red, green, blue;
+
+	std::size_t Count() const { return px.size(); }
+	void Resize(std::size_t n);
+};
+
+ParticleStreams MakeParticleStreams(const int n);
+ParticleStreams ToStreams(const std::vector<Particle> &particules);
+
+struct GravityParams
+{
+	float deltaTime;
+	glm::vec3 spawn;
+
+	// Respawn speeds are drawn from Philox keyed by (seed) and countered by
+	// (particle index, frame), so they do not depend on the thread layout
+	uint32_t seed;
+	uint32_t frame;
+};
+
+enum class SimdLevel
+{
+	Scalar,
+	Sse41,
+	Avx2
+};
+
+const char *SimdLevelName(SimdLevel level);
+
+// Widest level supported by both the build and the running CPU
+SimdLevel BestSimdLevel();
+
+typedef void (*GravityKernel)(ParticleStreams &, std::size_t begin, std::size_t end, const GravityParams &);
+
+void IntegrateGravityScalar(ParticleStreams &particules, std::size_t begin, std::size_t end, const GravityParams &params);
+void IntegrateGravitySse41(ParticleStreams &particules, std::size_t begin, std::size_t end, const GravityParams &params);
+void IntegrateGravityAvx2(ParticleStreams &particules, std::size_t begin, std::size_t end, const GravityParams &params);
+
+GravityKernel SelectGravityKernel(SimdLevel level);
+
+// Integrates every particle with the best kernel available at runtime
+void IntegrateGravity(ParticleStreams &particules, const GravityParams &params);
+
+// Same as IntegrateGravity, split in chunks over the pool's threads.
+// Results are bit-identical whatever the thread count.
+void SimulateGravity(ParticleStreams &particules, const GravityParams &params, ThreadPool &pool);
+
+// Shared by all kernels: moves particle i back to the spawn point
+void RespawnParticle(ParticleStreams &particules, std::size_t i, const GravityParams &params);
@@ -0,0 +1,71 @@
+#include "particles.h"
+#include "cpu.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+// Compiled with AVX2 enabled for this file only, called through SelectGravityKernel
+void IntegrateGravityAvx2(ParticleStreams &particules, std::size_t begin, std::size_t end, const GravityParams &params)
+{
+	const __m256 dt = _mm256_set1_ps(params.deltaTime);
+	const __m256 gravity = _mm256_set1_ps(g);
+	const __m256 minusOne = _mm256_set1_ps(-1.0f);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 signBit = _mm256_set1_ps(-0.0f);
+
+	float *px = particules.px.data();
+	float *py = particules.py.data();
+	float *pz = particules.pz.data();
+	float *vx = particules.vx.data();
+	float *vy = particules.vy.data();
+	float *vz = particules.vz.data();
+	const float *size = particules.size.data();
+
+	std::size_t i = begin;
+	for(; i + 8 <= end; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(px + i);
+		__m256 y = _mm256_loadu_ps(py + i);
+
+		const __m256 outside = _mm256_or_ps(_mm256_cmp_ps(y, minusOne, _CMP_LT_OQ),
+				_mm256_or_ps(_mm256_cmp_ps(x, minusOne, _CMP_LT_OQ), _mm256_cmp_ps(x, one, _CMP_GT_OQ)));
+
+		// Respawns are rare, handle them one by one and reload the block
+		int mask = _mm256_movemask_ps(outside);
+		if(mask)
+		{
+			for(; mask; mask &= mask - 1)
+			{
+				RespawnParticle(particules, i + CountTrailingZeros(mask), params);
+			}
+			x = _mm256_loadu_ps(px + i);
+			y = _mm256_loadu_ps(py + i);
+		}
+
+		const __m256 z = _mm256_loadu_ps(pz + i);
+		const __m256 sx = _mm256_loadu_ps(vx + i);
+		const __m256 sy = _mm256_loadu_ps(vy + i);
+		const __m256 sz = _mm256_loadu_ps(vz + i);
+		const __m256 s = _mm256_loadu_ps(size + i);
+
+		const __m256 ax = _mm256_div_ps(_mm256_xor_ps(sx, signBit), s);
+		const __m256 ay = _mm256_div_ps(_mm256_sub_ps(_mm256_xor_ps(_mm256_mul_ps(s, gravity), signBit), sy), s);
+		const __m256 az = _mm256_div_ps(_mm256_xor_ps(sz, signBit), s);
+
+		_mm256_storeu_ps(px + i, _mm256_add_ps(x, _mm256_mul_ps(sx, dt)));
+		_mm256_storeu_ps(py + i, _mm256_add_ps(y, _mm256_mul_ps(sy, dt)));
+		_mm256_storeu_ps(pz + i, _mm256_add_ps(z, _mm256_mul_ps(sz, dt)));
+
+		_mm256_storeu_ps(vx + i, _mm256_add_ps(sx, _mm256_mul_ps(ax, dt)));
+		_mm256_storeu_ps(vy + i, _mm256_add_ps(sy, _mm256_mul_ps(ay, dt)));
+		_mm256_storeu_ps(vz + i, _mm256_add_ps(sz, _mm256_mul_ps(az, dt)));
+	}
+
+	IntegrateGravityScalar(particules, i, end, params);
+}
+#else
+void IntegrateGravityAvx2(ParticleStreams &particules, std::size_t begin, std::size_t end, const GravityParams &params)
+{
+	IntegrateGravityScalar(particules, begin, end, params);
+}
+#endif
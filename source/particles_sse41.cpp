@@ -0,0 +1,71 @@
+#include "particles.h"
+#include "cpu.h"
+
+#if defined(__SSE4_1__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <smmintrin.h>
+
+// Compiled with SSE4.1 enabled for this file only, called through SelectGravityKernel
+void IntegrateGravitySse41(ParticleStreams &particules, std::size_t begin, std::size_t end, const GravityParams &params)
+{
+	const __m128 dt = _mm_set1_ps(params.deltaTime);
+	const __m128 gravity = _mm_set1_ps(g);
+	const __m128 minusOne = _mm_set1_ps(-1.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+
+	float *px = particules.px.data();
+	float *py = particules.py.data();
+	float *pz = particules.pz.data();
+	float *vx = particules.vx.data();
+	float *vy = particules.vy.data();
+	float *vz = particules.vz.data();
+	const float *size = particules.size.data();
+
+	std::size_t i = begin;
+	for(; i + 4 <= end; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(px + i);
+		__m128 y = _mm_loadu_ps(py + i);
+
+		const __m128 outside = _mm_or_ps(_mm_cmplt_ps(y, minusOne),
+				_mm_or_ps(_mm_cmplt_ps(x, minusOne), _mm_cmpgt_ps(x, one)));
+
+		// Respawns are rare, handle them one by one and reload the block
+		int mask = _mm_movemask_ps(outside);
+		if(mask)
+		{
+			for(; mask; mask &= mask - 1)
+			{
+				RespawnParticle(particules, i + CountTrailingZeros(mask), params);
+			}
+			x = _mm_loadu_ps(px + i);
+			y = _mm_loadu_ps(py + i);
+		}
+
+		const __m128 z = _mm_loadu_ps(pz + i);
+		const __m128 sx = _mm_loadu_ps(vx + i);
+		const __m128 sy = _mm_loadu_ps(vy + i);
+		const __m128 sz = _mm_loadu_ps(vz + i);
+		const __m128 s = _mm_loadu_ps(size + i);
+
+		const __m128 ax = _mm_div_ps(_mm_xor_ps(sx, signBit), s);
+		const __m128 ay = _mm_div_ps(_mm_sub_ps(_mm_xor_ps(_mm_mul_ps(s, gravity), signBit), sy), s);
+		const __m128 az = _mm_div_ps(_mm_xor_ps(sz, signBit), s);
+
+		_mm_storeu_ps(px + i, _mm_add_ps(x, _mm_mul_ps(sx, dt)));
+		_mm_storeu_ps(py + i, _mm_add_ps(y, _mm_mul_ps(sy, dt)));
+		_mm_storeu_ps(pz + i, _mm_add_ps(z, _mm_mul_ps(sz, dt)));
+
+		_mm_storeu_ps(vx + i, _mm_add_ps(sx, _mm_mul_ps(ax, dt)));
+		_mm_storeu_ps(vy + i, _mm_add_ps(sy, _mm_mul_ps(ay, dt)));
+		_mm_storeu_ps(vz + i, _mm_add_ps(sz, _mm_mul_ps(az, dt)));
+	}
+
+	IntegrateGravityScalar(particules, i, end, params);
+}
+#else
+void IntegrateGravitySse41(ParticleStreams &particules, std::size_t begin, std::size_t end, const GravityParams &params)
+{
+	IntegrateGravityScalar(particules, begin, end, params);
+}
+#endif
@@ -0,0 +1,106 @@
+#include "ply.h"
+
+#define TINYPLY_IMPLEMENTATION
+#include "tinyply.h"
+
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+using namespace tinyply;
+
+// Reads `count * components` numbers of any PLY type as T
+template<typename T>
+static void ConvertData(PlyData & data, std::size_t components, T * out)
+{
+	const std::size_t n = data.count * components;
+	uint8_t * p = data.buffer.get();
+
+	for(std::size_t i = 0; i < n; ++i)
+	{
+		switch(data.t)
+		{
+		case Type::INT8: out[i] = T(reinterpret_cast<int8_t *>(p)[i]); break;
+		case Type::UINT8: out[i] = T(p[i]); break;
+		case Type::INT16: { int16_t v; std::memcpy(&v, p + 2 * i, 2); out[i] = T(v); break; }
+		case Type::UINT16: { uint16_t v; std::memcpy(&v, p + 2 * i, 2); out[i] = T(v); break; }
+		case Type::INT32: { int32_t v; std::memcpy(&v, p + 4 * i, 4); out[i] = T(v); break; }
+		case Type::UINT32: { uint32_t v; std::memcpy(&v, p + 4 * i, 4); out[i] = T(v); break; }
+		case Type::FLOAT32: { float v; std::memcpy(&v, p + 4 * i, 4); out[i] = T(v); break; }
+		case Type::FLOAT64: { double v; std::memcpy(&v, p + 8 * i, 8); out[i] = T(v); break; }
+		default: throw std::runtime_error("Unsupported PLY property type");
+		}
+	}
+}
+
+static bool HasProperty(const PlyElement & element, const char * name)
+{
+	for(const auto & property : element.properties)
+	{
+		if(property.name == name)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+Mesh ReadPly(const char * filename)
+{
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	if(!file.is_open())
+	{
+		throw std::runtime_error(std::string("Cannot open file: ") + filename);
+	}
+
+	PlyFile ply;
+	if(!ply.parse_header(file))
+	{
+		throw std::runtime_error(std::string("Invalid PLY header: ") + filename);
+	}
+
+	bool hasNormals = false;
+	const char * indexProperty = "vertex_indices";
+	for(const auto & element : ply.get_elements())
+	{
+		if(element.name == "vertex")
+		{
+			hasNormals = HasProperty(element, "nx") && HasProperty(element, "ny") && HasProperty(element, "nz");
+		}
+		if(element.name == "face" && !HasProperty(element, "vertex_indices"))
+		{
+			indexProperty = "vertex_index";
+		}
+	}
+
+	const auto positions = ply.request_properties_from_element("vertex", {"x", "y", "z"});
+	const auto normals = hasNormals ? ply.request_properties_from_element("vertex", {"nx", "ny", "nz"}) : nullptr;
+	const auto faces = ply.request_properties_from_element("face", {indexProperty}, 3);
+
+	ply.read(file);
+
+	Mesh mesh;
+	mesh.positions.resize(positions->count);
+	ConvertData(*positions, 3, reinterpret_cast<float *>(mesh.positions.data()));
+
+	if(normals)
+	{
+		mesh.normals.resize(normals->count);
+		ConvertData(*normals, 3, reinterpret_cast<float *>(mesh.normals.data()));
+	}
+
+	mesh.indices.resize(faces->count * 3);
+	ConvertData(*faces, 3, mesh.indices.data());
+
+	for(const uint32_t index : mesh.indices)
+	{
+		if(index >= mesh.positions.size())
+		{
+			throw std::runtime_error(std::string("PLY face index out of range: ") + filename);
+		}
+	}
+
+	return mesh;
+}
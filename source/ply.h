@@ -0,0 +1,7 @@
+#pragma once
+
+#include "mesh.h"
+
+// Triangle meshes only: vertex x/y/z (float or double), optional normals,
+// faces as a 3-item "vertex_indices" or "vertex_index" list
+Mesh ReadPly(const char * filename);
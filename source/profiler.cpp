@@ -0,0 +1,267 @@
+#include "profiler.h"
+
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> profilerEnabled(false);
+std::atomic<uint64_t> profileCounters[int(ProfileCounter::Count)];
+
+namespace
+{
+	struct ZoneEvent
+	{
+		const char *name;
+		uint64_t begin;
+		uint64_t end;
+	};
+
+	// Single producer (its thread), single consumer (ProfilerFrameEnd)
+	struct ThreadRing
+	{
+		static const uint64_t capacity = 1 << 14;
+
+		ZoneEvent events[capacity];
+		std::atomic<uint64_t> head{0};
+		std::atomic<uint64_t> tail{0};
+		std::atomic<uint64_t> dropped{0};
+
+		unsigned id = 0;
+		std::string name;
+	};
+
+	struct CollectedZone
+	{
+		ZoneEvent event;
+		unsigned thread;
+	};
+
+	struct CounterSample
+	{
+		uint64_t time;
+		ProfileCounterValues values;
+	};
+
+	// Past this many zones the trace stops growing, the rest count as dropped
+	const std::size_t maxCollectedZones = 1 << 22;
+
+	const unsigned gpuThread = 0;
+
+	struct Registry
+	{
+		std::mutex mutex;
+		// rings outlive their threads: pool workers come and go
+		std::vector<std::unique_ptr<ThreadRing>> rings;
+		std::vector<CollectedZone> zones;
+		std::vector<CounterSample> counters;
+		ProfileCounterValues lastFrame = {};
+		uint64_t dropped = 0;
+	};
+
+	Registry &GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	thread_local ThreadRing *currentRing = nullptr;
+	// a ring is only allocated by the first zone of the thread
+	thread_local std::string currentName;
+
+	ThreadRing &CurrentRing()
+	{
+		if(!currentRing)
+		{
+			Registry &registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			registry.rings.emplace_back(new ThreadRing);
+			currentRing = registry.rings.back().get();
+			// id 0 is the GPU track
+			currentRing->id = unsigned(registry.rings.size());
+			currentRing->name = currentName.empty() ? "thread " + std::to_string(currentRing->id) : currentName;
+		}
+		return *currentRing;
+	}
+
+	void Drain(Registry &registry, ThreadRing &ring)
+	{
+		const uint64_t head = ring.head.load(std::memory_order_acquire);
+		uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+
+		for(; tail != head; ++tail)
+		{
+			if(registry.zones.size() < maxCollectedZones)
+			{
+				registry.zones.push_back({ring.events[tail % ThreadRing::capacity], ring.id});
+			}
+			else
+			{
+				++registry.dropped;
+			}
+		}
+
+		ring.tail.store(tail, std::memory_order_release);
+		registry.dropped += ring.dropped.exchange(0, std::memory_order_relaxed);
+	}
+
+	void WriteEscaped(std::ostream &out, const std::string &text)
+	{
+		for(const char c : text)
+		{
+			if(c == '"' || c == '\\')
+			{
+				out << '\\';
+			}
+			if(static_cast<unsigned char>(c) >= 0x20)
+			{
+				out << c;
+			}
+		}
+	}
+}
+
+void EnableProfiler(bool enabled)
+{
+	profilerEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t ProfilerNow()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+void RecordProfileZone(const char *name, uint64_t begin, uint64_t end)
+{
+	ThreadRing &ring = CurrentRing();
+	const uint64_t head = ring.head.load(std::memory_order_relaxed);
+
+	if(head - ring.tail.load(std::memory_order_acquire) >= ThreadRing::capacity)
+	{
+		// full until the next ProfilerFrameEnd
+		ring.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	ring.events[head % ThreadRing::capacity] = {name, begin, end};
+	ring.head.store(head + 1, std::memory_order_release);
+}
+
+void RecordGpuZone(const char *name, uint64_t begin, uint64_t duration)
+{
+	Registry &registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	if(registry.zones.size() < maxCollectedZones)
+	{
+		registry.zones.push_back({{name, begin, begin + duration}, gpuThread});
+	}
+	else
+	{
+		++registry.dropped;
+	}
+}
+
+void SetProfilerThreadName(const std::string &name)
+{
+	currentName = name;
+	if(currentRing)
+	{
+		std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+		currentRing->name = name;
+	}
+}
+
+const char *ProfileCounterName(ProfileCounter counter)
+{
+	switch(counter)
+	{
+	case ProfileCounter::DrawCalls: return "draw calls";
+	case ProfileCounter::DrawsSubmitted: return "draws submitted";
+	case ProfileCounter::StateChanges: return "state changes";
+	case ProfileCounter::UnbatchedStateChanges: return "unbatched state changes";
+	case ProfileCounter::BytesUploaded: return "bytes uploaded";
+	case ProfileCounter::ParticlesSimulated: return "particles simulated";
+	case ProfileCounter::TrianglesDrawn: return "triangles drawn";
+	default: return "?";
+	}
+}
+
+void ProfilerFrameEnd()
+{
+	Registry &registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	for(auto &ring : registry.rings)
+	{
+		Drain(registry, *ring);
+	}
+
+	ProfileCounterValues values;
+	for(int c = 0; c < int(ProfileCounter::Count); ++c)
+	{
+		values.values[c] = profileCounters[c].exchange(0, std::memory_order_relaxed);
+	}
+	registry.lastFrame = values;
+
+	if(ProfilerEnabled())
+	{
+		registry.counters.push_back({ProfilerNow(), values});
+	}
+}
+
+ProfileCounterValues LastFrameCounters()
+{
+	Registry &registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	return registry.lastFrame;
+}
+
+void WriteChromeTrace(std::ostream &out)
+{
+	Registry &registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	for(auto &ring : registry.rings)
+	{
+		Drain(registry, *ring);
+	}
+
+	// timestamps in microseconds, to the nanosecond
+	const auto flags = out.flags();
+	const auto precision = out.precision();
+	out << std::fixed << std::setprecision(3);
+
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << gpuThread << ", \"args\": {\"name\": \"GPU\"}}";
+	for(const auto &ring : registry.rings)
+	{
+		out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << ring->id << ", \"args\": {\"name\": \"";
+		WriteEscaped(out, ring->name);
+		out << "\"}}";
+	}
+
+	for(const auto &zone : registry.zones)
+	{
+		out << ",\n{\"name\": \"";
+		WriteEscaped(out, zone.event.name);
+		out << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << zone.thread
+			<< ", \"ts\": " << zone.event.begin / 1000.0 << ", \"dur\": " << (zone.event.end - zone.event.begin) / 1000.0 << "}";
+	}
+
+	for(const auto &sample : registry.counters)
+	{
+		for(int c = 0; c < int(ProfileCounter::Count); ++c)
+		{
+			out << ",\n{\"name\": \"" << ProfileCounterName(ProfileCounter(c)) << "\", \"ph\": \"C\", \"pid\": 1, \"ts\": "
+				<< sample.time / 1000.0 << ", \"args\": {\"value\": " << sample.values.values[c] << "}}";
+		}
+	}
+
+	out << "\n],\n\"otherData\": {\"droppedZones\": " << registry.dropped << "}}\n";
+
+	out.flags(flags);
+	out.precision(precision);
+}
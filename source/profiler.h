@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Lightweight instrumentation: scoped CPU zones, per-frame counters and GPU
+// zones (gpu_profiler.h), exported as a Chrome trace (chrome://tracing,
+// Perfetto). Every thread records its zones into its own lock-free ring,
+// drained once per frame by ProfilerFrameEnd. While disabled a zone costs
+// one relaxed load; defining GAMAGORA_NO_PROFILER compiles zones out.
+
+extern std::atomic<bool> profilerEnabled;
+
+inline bool ProfilerEnabled()
+{
+	return profilerEnabled.load(std::memory_order_relaxed);
+}
+
+void EnableProfiler(bool enabled);
+
+// Nanoseconds since the process started profiling
+uint64_t ProfilerNow();
+
+// `name` must outlive the profiler: string literals
+void RecordProfileZone(const char *name, uint64_t begin, uint64_t end);
+// GPU durations go to their own track, placed at the CPU time they began
+void RecordGpuZone(const char *name, uint64_t begin, uint64_t duration);
+
+// Label of the calling thread in the trace
+void SetProfilerThreadName(const std::string &name);
+
+enum class ProfileCounter
+{
+	DrawCalls,
+	// draws given to the render queue: its draw calls without batching
+	DrawsSubmitted,
+	// program and texture binds, with and without batching
+	StateChanges,
+	UnbatchedStateChanges,
+	BytesUploaded,
+	ParticlesSimulated,
+	TrianglesDrawn,
+	Count
+};
+
+const char *ProfileCounterName(ProfileCounter counter);
+
+extern std::atomic<uint64_t> profileCounters[int(ProfileCounter::Count)];
+
+inline void AddProfileCounter(ProfileCounter counter, uint64_t amount)
+{
+	if(ProfilerEnabled())
+	{
+		profileCounters[int(counter)].fetch_add(amount, std::memory_order_relaxed);
+	}
+}
+
+struct ProfileCounterValues
+{
+	uint64_t values[int(ProfileCounter::Count)];
+};
+
+// Collects the zones recorded since the last call and closes the counters
+// of the frame. Call once per frame from the main thread.
+void ProfilerFrameEnd();
+
+// Counters of the last closed frame
+ProfileCounterValues LastFrameCounters();
+
+// Every zone and counter sample collected so far, as trace-event JSON
+void WriteChromeTrace(std::ostream &out);
+
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char *name)
+		: name(ProfilerEnabled() ? name : nullptr), begin(this->name ? ProfilerNow() : 0)
+	{
+	}
+
+	~ProfileZone()
+	{
+		if(name)
+		{
+			RecordProfileZone(name, begin, ProfilerNow());
+		}
+	}
+
+	ProfileZone(const ProfileZone &) = delete;
+	ProfileZone &operator=(const ProfileZone &) = delete;
+
+private:
+	const char *name;
+	uint64_t begin;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef GAMAGORA_NO_PROFILER
+#define PROFILE_ZONE(name) ((void)0)
+#else
+// Times the rest of the enclosing scope
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#endif
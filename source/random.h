@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+// Philox4x32-10 counter-based generator (Salmon et al., "Parallel random
+// numbers: as easy as 1, 2, 3"). It is a pure function of (counter, key):
+// the same particle index and frame always give the same numbers, whichever
+// thread asks for them.
+struct Philox4x32
+{
+	uint32_t v[4];
+
+	static Philox4x32 Generate(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint32_t k0, uint32_t k1)
+	{
+		Philox4x32 r = {{c0, c1, c2, c3}};
+
+		for(int round = 0; round < 10; ++round)
+		{
+			if(round > 0)
+			{
+				k0 += 0x9E3779B9u;
+				k1 += 0xBB67AE85u;
+			}
+
+			const uint64_t p0 = uint64_t(0xD2511F53u) * r.v[0];
+			const uint64_t p1 = uint64_t(0xCD9E8D57u) * r.v[2];
+
+			const uint32_t hi0 = uint32_t(p0 >> 32), lo0 = uint32_t(p0);
+			const uint32_t hi1 = uint32_t(p1 >> 32), lo1 = uint32_t(p1);
+
+			r.v[0] = hi1 ^ r.v[1] ^ k0;
+			r.v[1] = lo1;
+			r.v[2] = hi0 ^ r.v[3] ^ k1;
+			r.v[3] = lo0;
+		}
+
+		return r;
+	}
+};
+
+// Uniform float in [0, 1) from the top 24 bits
+inline float ToUnitFloat(uint32_t x)
+{
+	return float(x >> 8) * (1.0f / 16777216.0f);
+}
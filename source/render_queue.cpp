@@ -0,0 +1,302 @@
+#include "render_queue.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+/* GEOMETRY ARENA */
+
+GeometryArena::GeometryArena(std::size_t vertexCapacity, std::size_t indexCapacity)
+	: vao(0), buffers{0, 0}, vertexCapacity(std::max<std::size_t>(vertexCapacity, 1)),
+	indexCapacity(std::max<std::size_t>(indexCapacity, 1)), vertexCount(0), indexCount(0)
+{
+	glCreateBuffers(2, buffers);
+	glNamedBufferStorage(buffers[0], GLsizeiptr(this->vertexCapacity * sizeof(ArenaVertex)), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glNamedBufferStorage(buffers[1], GLsizeiptr(this->indexCapacity * sizeof(uint32_t)), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	glCreateVertexArrays(1, &vao);
+	glVertexArrayVertexBuffer(vao, 0, buffers[0], 0, sizeof(ArenaVertex));
+	glVertexArrayElementBuffer(vao, buffers[1]);
+
+	const struct
+	{
+		GLuint location;
+		GLint size;
+		GLuint offset;
+		GLuint binding;
+	} attributes[] = {
+		{0, 3, GLuint(offsetof(ArenaVertex, position)), 0},
+		{1, 3, GLuint(offsetof(ArenaVertex, normal)), 0},
+		{2, 3, GLuint(offsetof(ArenaVertex, color)), 0},
+		{3, 2, GLuint(offsetof(ArenaVertex, uv)), 0},
+		// per instance, from the buffer RenderQueue binds at each flush
+		{4, 4, GLuint(offsetof(DrawInstance, offsetScale)), 1},
+		{5, 4, GLuint(offsetof(DrawInstance, color)), 1}
+	};
+	for(const auto &a : attributes)
+	{
+		glVertexArrayAttribFormat(vao, a.location, a.size, GL_FLOAT, GL_FALSE, a.offset);
+		glVertexArrayAttribBinding(vao, a.location, a.binding);
+		glEnableVertexArrayAttrib(vao, a.location);
+	}
+	glVertexArrayBindingDivisor(vao, 1, 1);
+}
+
+GeometryArena::~GeometryArena()
+{
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(2, buffers);
+}
+
+void GeometryArena::Grow(std::size_t vertices, std::size_t indices)
+{
+	PROFILE_ZONE("GeometryArena::Grow");
+	while(vertexCapacity < vertices)
+	{
+		vertexCapacity *= 2;
+	}
+	while(indexCapacity < indices)
+	{
+		indexCapacity *= 2;
+	}
+
+	// copied on the GPU, the old buffers go once the copies are done
+	GLuint grown[2];
+	glCreateBuffers(2, grown);
+	glNamedBufferStorage(grown[0], GLsizeiptr(vertexCapacity * sizeof(ArenaVertex)), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glNamedBufferStorage(grown[1], GLsizeiptr(indexCapacity * sizeof(uint32_t)), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glCopyNamedBufferSubData(buffers[0], grown[0], 0, 0, GLsizeiptr(vertexCount * sizeof(ArenaVertex)));
+	glCopyNamedBufferSubData(buffers[1], grown[1], 0, 0, GLsizeiptr(indexCount * sizeof(uint32_t)));
+	glDeleteBuffers(2, buffers);
+	buffers[0] = grown[0];
+	buffers[1] = grown[1];
+
+	glVertexArrayVertexBuffer(vao, 0, buffers[0], 0, sizeof(ArenaVertex));
+	glVertexArrayElementBuffer(vao, buffers[1]);
+}
+
+MeshHandle GeometryArena::Add(const std::vector<ArenaVertex> &vertices, const std::vector<uint32_t> &indices)
+{
+	if(vertexCount + vertices.size() > vertexCapacity || indexCount + indices.size() > indexCapacity)
+	{
+		Grow(vertexCount + vertices.size(), indexCount + indices.size());
+	}
+
+	glNamedBufferSubData(buffers[0], GLintptr(vertexCount * sizeof(ArenaVertex)), GLsizeiptr(vertices.size() * sizeof(ArenaVertex)),
+			vertices.data());
+	glNamedBufferSubData(buffers[1], GLintptr(indexCount * sizeof(uint32_t)), GLsizeiptr(indices.size() * sizeof(uint32_t)),
+			indices.data());
+	AddProfileCounter(ProfileCounter::BytesUploaded, vertices.size() * sizeof(ArenaVertex) + indices.size() * sizeof(uint32_t));
+
+	ranges.push_back({uint32_t(indexCount), uint32_t(indices.size()), int32_t(vertexCount)});
+	vertexCount += vertices.size();
+	indexCount += indices.size();
+	return MeshHandle(ranges.size() - 1);
+}
+
+/* SORTING */
+
+uint64_t MakeSortKey(GLuint program, GLuint texture, MeshHandle mesh, float depth)
+{
+	// NaN lands in front
+	const float clamped = depth > 0.0f ? (depth < 1.0f ? depth : 1.0f) : 0.0f;
+	return uint64_t(program & 0xffff) << 48 | uint64_t(texture & 0xffff) << 32 | uint64_t(mesh & 0xffff) << 16
+			| uint64_t(clamped * 65535.0f);
+}
+
+void RadixSort(std::vector<SortEntry> &entries, std::vector<SortEntry> &scratch)
+{
+	const std::size_t count = entries.size();
+	if(count < 2)
+	{
+		return;
+	}
+	scratch.resize(count);
+
+	// the histograms of every pass in one read
+	std::vector<std::size_t> histograms(8 * 256, 0);
+	for(const SortEntry &e : entries)
+	{
+		for(int pass = 0; pass < 8; ++pass)
+		{
+			++histograms[pass * 256 + ((e.key >> (8 * pass)) & 0xff)];
+		}
+	}
+
+	std::vector<SortEntry> *from = &entries, *to = &scratch;
+	for(int pass = 0; pass < 8; ++pass)
+	{
+		std::size_t *histogram = &histograms[pass * 256];
+		const unsigned shift = 8 * pass;
+		if(histogram[(entries[0].key >> shift) & 0xff] == count)
+		{
+			continue;
+		}
+
+		std::size_t offset = 0;
+		for(int digit = 0; digit < 256; ++digit)
+		{
+			const std::size_t n = histogram[digit];
+			histogram[digit] = offset;
+			offset += n;
+		}
+
+		for(const SortEntry &e : *from)
+		{
+			(*to)[histogram[(e.key >> shift) & 0xff]++] = e;
+		}
+		std::swap(from, to);
+	}
+
+	if(from != &entries)
+	{
+		entries.swap(scratch);
+	}
+}
+
+/* DRAW LIST */
+
+void DrawList::Clear()
+{
+	items.clear();
+	order.clear();
+}
+
+void DrawList::Add(GLuint program, GLuint texture, MeshHandle mesh, float depth, const DrawInstance &instance)
+{
+	order.push_back({MakeSortKey(program, texture, mesh, depth), uint32_t(items.size())});
+	items.push_back({program, texture, mesh, instance});
+}
+
+void DrawList::Build(const std::vector<MeshRange> &ranges)
+{
+	stats = RenderQueueStats();
+	stats.draws = items.size();
+	commands.clear();
+	instances.clear();
+	batches.clear();
+
+	// program and texture binds, as if each draw was issued where it was submitted
+	for(std::size_t i = 0; i < items.size(); ++i)
+	{
+		stats.unbatchedStateChanges += i == 0 || items[i].program != items[i - 1].program;
+		stats.unbatchedStateChanges += i == 0 || items[i].texture != items[i - 1].texture;
+	}
+
+	RadixSort(order, scratch);
+
+	instances.reserve(items.size());
+	MeshHandle lastMesh = 0;
+	for(const SortEntry &entry : order)
+	{
+		const Item &item = items[entry.item];
+
+		if(batches.empty() || batches.back().program != item.program || batches.back().texture != item.texture)
+		{
+			stats.stateChanges += batches.empty() || batches.back().program != item.program;
+			stats.stateChanges += batches.empty() || batches.back().texture != item.texture;
+			batches.push_back({item.program, item.texture, uint32_t(commands.size()), 0});
+		}
+
+		DrawBatch &batch = batches.back();
+		if(batch.commandCount > 0 && item.mesh == lastMesh)
+		{
+			++commands.back().instanceCount;
+		}
+		else
+		{
+			const MeshRange &range = ranges[item.mesh];
+			commands.push_back({range.indexCount, 1, range.firstIndex, range.baseVertex, uint32_t(instances.size())});
+			++batch.commandCount;
+		}
+		stats.triangles += commands.back().count / 3;
+
+		instances.push_back(item.instance);
+		lastMesh = item.mesh;
+	}
+
+	stats.commands = commands.size();
+	stats.drawCalls = batches.size();
+}
+
+/* RENDER QUEUE */
+
+// A region holds the commands, then the instances on a 16-byte boundary
+static std::size_t InstanceOffset(std::size_t draws)
+{
+	return (draws * sizeof(DrawCommand) + 15) & ~std::size_t(15);
+}
+
+static std::size_t RegionSize(std::size_t draws)
+{
+	return InstanceOffset(draws) + draws * sizeof(DrawInstance);
+}
+
+RenderQueue::RenderQueue(GeometryArena &arena, std::size_t initialDraws)
+	: arena(arena), stream(new StreamBuffer(RegionSize(std::max<std::size_t>(initialDraws, 1)))),
+	capacity(std::max<std::size_t>(initialDraws, 1))
+{
+}
+
+void RenderQueue::Flush()
+{
+	PROFILE_ZONE("RenderQueue::Flush");
+	list.Build(arena.Ranges());
+	list.Clear();
+
+	const RenderQueueStats &stats = list.Stats();
+	if(stats.draws == 0)
+	{
+		return;
+	}
+
+	if(stats.draws > capacity)
+	{
+		while(capacity < stats.draws)
+		{
+			capacity *= 2;
+		}
+		stream.reset(new StreamBuffer(RegionSize(capacity)));
+	}
+
+	const auto &commands = list.Commands();
+	const auto &instances = list.Instances();
+	const std::size_t instanceOffset = InstanceOffset(capacity);
+
+	unsigned char *region = static_cast<unsigned char *>(stream->Map());
+	std::memcpy(region, commands.data(), commands.size() * sizeof(DrawCommand));
+	std::memcpy(region + instanceOffset, instances.data(), instances.size() * sizeof(DrawInstance));
+
+	const GLuint vao = arena.Vao();
+	glVertexArrayVertexBuffer(vao, 1, stream->Buffer(), stream->Offset() + GLintptr(instanceOffset), sizeof(DrawInstance));
+	glBindVertexArray(vao);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stream->Buffer());
+
+	const auto &batches = list.Batches();
+	for(std::size_t b = 0; b < batches.size(); ++b)
+	{
+		const DrawBatch &batch = batches[b];
+		if(b == 0 || batch.program != batches[b - 1].program)
+		{
+			glUseProgram(batch.program);
+		}
+		if(b == 0 || batch.texture != batches[b - 1].texture)
+		{
+			glBindTextureUnit(0, batch.texture);
+		}
+
+		const GLintptr offset = stream->Offset() + GLintptr(batch.firstCommand * sizeof(DrawCommand));
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void *>(offset), GLsizei(batch.commandCount),
+				sizeof(DrawCommand));
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	stream->Unmap(commands.size() * sizeof(DrawCommand) + instances.size() * sizeof(DrawInstance));
+
+	AddProfileCounter(ProfileCounter::DrawCalls, stats.drawCalls);
+	AddProfileCounter(ProfileCounter::DrawsSubmitted, stats.draws);
+	AddProfileCounter(ProfileCounter::StateChanges, stats.stateChanges);
+	AddProfileCounter(ProfileCounter::UnbatchedStateChanges, stats.unbatchedStateChanges);
+	AddProfileCounter(ProfileCounter::TrianglesDrawn, stats.triangles);
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "stream_buffer.h"
+
+// Vertex layout of every mesh in a GeometryArena
+struct ArenaVertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec3 color;
+	glm::vec2 uv;
+};
+
+typedef uint32_t MeshHandle;
+
+// Where a mesh sits in the arena buffers
+struct MeshRange
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	int32_t baseVertex;
+};
+
+// Meshes packed into one vertex and one index buffer behind a single VAO,
+// so draws of different meshes need no rebinding and can share a
+// multi-draw. The buffers double when full. Attribute locations:
+// 0 position, 1 normal, 2 color, 3 uv, then per instance 4 offset and
+// scale, 5 color (DrawInstance).
+class GeometryArena
+{
+public:
+	GeometryArena(std::size_t vertexCapacity = 64 * 1024, std::size_t indexCapacity = 192 * 1024);
+	~GeometryArena();
+
+	GeometryArena(const GeometryArena &) = delete;
+	GeometryArena &operator=(const GeometryArena &) = delete;
+
+	MeshHandle Add(const std::vector<ArenaVertex> &vertices, const std::vector<uint32_t> &indices);
+
+	const MeshRange &Range(MeshHandle mesh) const { return ranges[mesh]; }
+	const std::vector<MeshRange> &Ranges() const { return ranges; }
+	GLuint Vao() const { return vao; }
+
+private:
+	void Grow(std::size_t vertices, std::size_t indices);
+
+	GLuint vao;
+	// vertices, indices
+	GLuint buffers[2];
+	std::size_t vertexCapacity, indexCapacity;
+	std::size_t vertexCount, indexCount;
+	std::vector<MeshRange> ranges;
+};
+
+// Per-draw data, read as instanced attributes
+struct DrawInstance
+{
+	// positions are scaled by w, then moved by xyz
+	glm::vec4 offsetScale;
+	glm::vec4 color;
+};
+
+// Program, texture, mesh and depth, 16 bits each from the most significant:
+// sorted draws are grouped by state, then by mesh, then front to back.
+// Names above 16 bits only cost extra state changes, never wrong draws.
+uint64_t MakeSortKey(GLuint program, GLuint texture, MeshHandle mesh, float depth);
+
+struct SortEntry
+{
+	uint64_t key;
+	uint32_t item;
+};
+
+// Stable LSD radix sort on the keys, 8 bits a pass; passes where every key
+// has the same byte are skipped. `scratch` is resized as needed.
+void RadixSort(std::vector<SortEntry> &entries, std::vector<SortEntry> &scratch);
+
+// Layout of glMultiDrawElementsIndirect commands
+struct DrawCommand
+{
+	uint32_t count;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t baseVertex;
+	uint32_t baseInstance;
+};
+
+// One glMultiDrawElementsIndirect: commands sharing program and texture
+struct DrawBatch
+{
+	GLuint program, texture;
+	uint32_t firstCommand, commandCount;
+};
+
+struct RenderQueueStats
+{
+	std::size_t draws = 0;
+	// had every draw been issued on its own, in submission order
+	std::size_t unbatchedStateChanges = 0;
+	// once sorted and merged
+	std::size_t commands = 0;
+	std::size_t drawCalls = 0;
+	std::size_t stateChanges = 0;
+	std::size_t triangles = 0;
+};
+
+// The CPU half of the render queue, without any GL call: sorts the draws of
+// a frame and merges them. Consecutive draws of one mesh become one
+// instanced command, and commands sharing program and texture one batch.
+class DrawList
+{
+public:
+	// Drops the draws; Stats stay those of the last Build
+	void Clear();
+	void Add(GLuint program, GLuint texture, MeshHandle mesh, float depth, const DrawInstance &instance);
+
+	// Fills Commands, Instances and Batches; `ranges` from GeometryArena
+	void Build(const std::vector<MeshRange> &ranges);
+
+	std::size_t Size() const { return items.size(); }
+	const std::vector<DrawCommand> &Commands() const { return commands; }
+	// in sorted order, as the commands' baseInstance index them
+	const std::vector<DrawInstance> &Instances() const { return instances; }
+	const std::vector<DrawBatch> &Batches() const { return batches; }
+	const RenderQueueStats &Stats() const { return stats; }
+
+private:
+	struct Item
+	{
+		GLuint program, texture;
+		MeshHandle mesh;
+		DrawInstance instance;
+	};
+
+	std::vector<Item> items;
+	std::vector<SortEntry> order, scratch;
+
+	std::vector<DrawCommand> commands;
+	std::vector<DrawInstance> instances;
+	std::vector<DrawBatch> batches;
+	RenderQueueStats stats;
+};
+
+// Draws submitted over a frame from a GeometryArena, issued on Flush as one
+// glMultiDrawElementsIndirect per program and texture. Commands and
+// instances go through a StreamBuffer, regrown when a frame outgrows it.
+class RenderQueue
+{
+public:
+	explicit RenderQueue(GeometryArena &arena, std::size_t initialDraws = 4096);
+
+	GeometryArena &Arena() { return arena; }
+
+	void Submit(GLuint program, GLuint texture, MeshHandle mesh, float depth, const DrawInstance &instance)
+	{
+		list.Add(program, texture, mesh, depth, instance);
+	}
+
+	// Sorts, merges and draws everything submitted since the last flush
+	void Flush();
+
+	// Of the last flush
+	const RenderQueueStats &Stats() const { return list.Stats(); }
+
+private:
+	GeometryArena &arena;
+	DrawList list;
+	std::unique_ptr<StreamBuffer> stream;
+	std::size_t capacity;
+};
@@ -0,0 +1,152 @@
+#include "run_options.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+static int ParseCount(const char *option, const char *value, int minimum)
+{
+	char *end = nullptr;
+	const long n = std::strtol(value, &end, 10);
+	if(end == value || *end != '\0' || n < minimum || n > 1 << 30)
+	{
+		throw std::runtime_error(std::string("Invalid value for ") + option + ": " + value);
+	}
+	return int(n);
+}
+
+RunOptions ParseRunOptions(int argc, char **argv)
+{
+	RunOptions options;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		const char *option = argv[i];
+		const auto value = [&]() -> const char * {
+			if(i + 1 >= argc)
+			{
+				throw std::runtime_error(std::string("Missing value for ") + option);
+			}
+			return argv[++i];
+		};
+
+		if(std::strcmp(option, "--help") == 0 || std::strcmp(option, "-h") == 0)
+		{
+			options.help = true;
+		}
+		else if(std::strcmp(option, "--headless") == 0)
+		{
+			options.headless = true;
+		}
+		else if(std::strcmp(option, "--no-vsync") == 0)
+		{
+			options.vsync = false;
+		}
+		else if(std::strcmp(option, "--scene") == 0)
+		{
+			options.scene = value();
+		}
+		else if(std::strcmp(option, "--particles") == 0)
+		{
+			options.particles = ParseCount(option, value(), 1);
+		}
+		else if(std::strcmp(option, "--quads") == 0)
+		{
+			options.quads = ParseCount(option, value(), 1);
+		}
+		else if(std::strcmp(option, "--simulation") == 0)
+		{
+			options.simulation = value();
+			if(options.simulation != "cpu" && options.simulation != "gpu")
+			{
+				throw std::runtime_error("Invalid value for --simulation: " + options.simulation + " (cpu or gpu)");
+			}
+		}
+		else if(std::strcmp(option, "--collisions") == 0)
+		{
+			options.collisions = true;
+		}
+		else if(std::strcmp(option, "--mesh") == 0)
+		{
+			options.mesh = value();
+		}
+		else if(std::strcmp(option, "--tick-rate") == 0)
+		{
+			options.tickRate = ParseCount(option, value(), 0);
+		}
+		else if(std::strcmp(option, "--size") == 0)
+		{
+			const std::string size = value();
+			const std::size_t x = size.find('x');
+			if(x == std::string::npos)
+			{
+				throw std::runtime_error("Invalid value for --size: " + size + " (expected WIDTHxHEIGHT)");
+			}
+			options.width = ParseCount(option, size.substr(0, x).c_str(), 1);
+			options.height = ParseCount(option, size.substr(x + 1).c_str(), 1);
+		}
+		else if(std::strcmp(option, "--frames") == 0)
+		{
+			options.frames = ParseCount(option, value(), 1);
+		}
+		else if(std::strcmp(option, "--warmup") == 0)
+		{
+			options.warmup = ParseCount(option, value(), 0);
+		}
+		else if(std::strcmp(option, "--threads") == 0)
+		{
+			options.threads = unsigned(ParseCount(option, value(), 0));
+		}
+		else if(std::strcmp(option, "--json") == 0)
+		{
+			options.json = value();
+		}
+		else if(std::strcmp(option, "--trace") == 0)
+		{
+			options.trace = value();
+		}
+		else
+		{
+			throw std::runtime_error(std::string("Unknown option: ") + option);
+		}
+	}
+
+	if(options.headless)
+	{
+		// a headless run only makes sense as a measurement
+		if(options.frames == 0)
+		{
+			options.frames = 600;
+		}
+		if(options.json.empty())
+		{
+			options.json = "-";
+		}
+	}
+
+	return options;
+}
+
+const char *RunOptionsUsage()
+{
+	return
+		"usage: GamagoraGL [options]\n"
+		"  --help              print this message\n"
+		"  --headless          render offscreen through EGL, no window (needs EGL)\n"
+		"  --scene NAME        quad (default), atlas or particles\n"
+		"  --particles N       particle count of the particles scene (default 100000)\n"
+		"  --quads N           quads of the atlas scene (default 4096)\n"
+		"  --simulation WHERE  particles simulated on the cpu (default) or the gpu\n"
+		"  --collisions        soft collisions between cpu simulated particles\n"
+		"  --mesh PATH         STL the cpu simulated particles bounce on, clicks pick\n"
+		"                      the spawn point on it\n"
+		"  --tick-rate HZ      cpu simulation at a fixed step on its own thread,\n"
+		"                      0 steps once per frame (default 0)\n"
+		"  --size WxH          framebuffer resolution (default 1200x1200)\n"
+		"  --frames N          measure N frames then exit (default 600 when headless)\n"
+		"  --warmup N          unmeasured frames first (default 10)\n"
+		"  --threads N         simulation threads, 0 for one per core (default 0)\n"
+		"  --json PATH         frame time report, - for stdout (default - when headless)\n"
+		"  --trace PATH        profile and write a Chrome trace (chrome://tracing, Perfetto)\n"
+		"  --no-vsync          do not wait for the display between frames\n";
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+
+// Command line of the application
+struct RunOptions
+{
+	bool help = false;
+
+	// EGL surfaceless context instead of a window
+	bool headless = false;
+	bool vsync = true;
+
+	std::string scene = "quad";
+	int particles = 100000;
+	// quads of the atlas scene
+	int quads = 4096;
+	// where the particles are simulated: "cpu" or "gpu" (compute shader)
+	std::string simulation = "cpu";
+	// fixed simulation steps per second on a thread of their own, 0 steps
+	// once per frame (cpu simulation only)
+	int tickRate = 0;
+	bool collisions = false;
+	// STL the cpu simulated particles bounce on
+	std::string mesh;
+	int width = 1200;
+	int height = 1200;
+
+	// frames measured after `warmup` unmeasured ones, 0 runs until the window closes
+	int frames = 0;
+	int warmup = 10;
+
+	// simulation threads including the main one, 0 means one per core
+	unsigned threads = 0;
+
+	// frame time report, "-" for stdout; defaults to stdout when headless
+	std::string json;
+
+	// Chrome trace of the CPU and GPU zones; profiling is off without it
+	std::string trace;
+};
+
+// Throws std::runtime_error on an unknown or malformed option
+RunOptions ParseRunOptions(int argc, char **argv);
+
+const char *RunOptionsUsage();
@@ -0,0 +1,541 @@
+#include "scene.h"
+#include "atlas.h"
+#include "profiler.h"
+#include "random.h"
+#include "simplify.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+/* QUAD */
+
+QuadScene::QuadScene(ShaderLibrary &shaders, AssetManager &assets, RenderQueue &queue)
+	: shaders(shaders), assets(assets), queue(queue)
+{
+	program = shaders.Load({
+		{GL_VERTEX_SHADER, "resources/shaders/shaderStl.vert"},
+		{GL_FRAGMENT_SHADER, "resources/shaders/shaderStl.frag"}
+	});
+
+	texture = assets.LoadTexture("resources/images/wall.jpg");
+
+	// Quad
+	const glm::vec3 normal(0.0f, 0.0f, 1.0f);
+	const std::vector<ArenaVertex> vertices = {
+		// position                    normal  color                        texture coords
+		{{ 0.5f,  0.5f, 0.0f}, normal, {1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},   // top right
+		{{ 0.5f, -0.5f, 0.0f}, normal, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},   // bottom right
+		{{-0.5f, -0.5f, 0.0f}, normal, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f}},   // bottom left
+		{{-0.5f,  0.5f, 0.0f}, normal, {1.0f, 1.0f, 0.0f}, {0.0f, 1.0f}}    // top left
+	};
+	const std::vector<uint32_t> indices = {
+		0, 1, 3, // first triangle
+		1, 2, 3  // second triangle
+	};
+	quad = queue.Arena().Add(vertices, indices);
+}
+
+void QuadScene::Update(float /*deltaTime*/)
+{
+}
+
+void QuadScene::Render()
+{
+	// a placeholder is bound until the image is decoded
+	queue.Submit(shaders.Program(program), assets.Texture(texture), quad, 0.0f,
+			{glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec4(1.0f)});
+}
+
+/* ATLAS */
+
+// wall.jpg, then generated sprites
+static const uint32_t atlasImageCount = 64;
+
+// Two-colored rings of a random size, so the sprites tell apart on screen
+static Image MakeSpriteImage(uint32_t seed)
+{
+	const Philox4x32 r = Philox4x32::Generate(seed, 0, 0, 0, 0x5b1du, 0);
+	Image image = AllocateImage(16 + int(r.v[0] % 113), 16 + int(r.v[1] % 113), 4);
+
+	// RGBA bytes, alpha opaque
+	const uint32_t colors[2] = {r.v[2] | 0xff000000u, r.v[3] | 0xff000000u};
+	for(int y = 0; y < image.height; ++y)
+	{
+		for(int x = 0; x < image.width; ++x)
+		{
+			const float dx = (x + 0.5f) / image.width - 0.5f, dy = (y + 0.5f) / image.height - 0.5f;
+			const int ring = int(std::sqrt(dx * dx + dy * dy) * 12.0f);
+			std::memcpy(image.data.get() + (std::size_t(y) * image.width + x) * 4, &colors[ring & 1], 4);
+		}
+	}
+	return image;
+}
+
+AtlasScene::AtlasScene(ShaderLibrary &shaders, RenderQueue &queue, int quadCount)
+	: shaders(shaders), queue(queue)
+{
+	PROFILE_ZONE("AtlasScene::AtlasScene");
+
+	std::vector<Image> images;
+	images.push_back(LoadImage("resources/images/wall.jpg"));
+	for(uint32_t i = 1; i < atlasImageCount; ++i)
+	{
+		images.push_back(MakeSpriteImage(i));
+	}
+
+	std::vector<const Image *> sources;
+	for(const Image &image : images)
+	{
+		sources.push_back(&image);
+	}
+	const Atlas atlas = BuildAtlas(sources);
+	texture = MakeAtlasTexture(atlas);
+
+	program = shaders.Load({
+		{GL_VERTEX_SHADER, "resources/shaders/shaderAtlas.vert"},
+		{GL_FRAGMENT_SHADER, "resources/shaders/shaderAtlas.frag"}
+	}, atlas.layers > 1 ? std::vector<ShaderDefine>{{"ATLAS_LAYERS", "1"}} : std::vector<ShaderDefine>());
+
+	// one quad per image, at its aspect ratio, uv remapped into the atlas
+	std::vector<MeshHandle> quads;
+	const glm::vec3 normal(0.0f, 0.0f, 1.0f), white(1.0f);
+	for(std::size_t i = 0; i < images.size(); ++i)
+	{
+		const float extent = float(std::max(images[i].width, images[i].height));
+		const float w = 0.5f * images[i].width / extent, h = 0.5f * images[i].height / extent;
+		std::vector<ArenaVertex> vertices = {
+			{{ w,  h, 0.0f}, normal, white, {1.0f, 1.0f}},
+			{{ w, -h, 0.0f}, normal, white, {1.0f, 0.0f}},
+			{{-w, -h, 0.0f}, normal, white, {0.0f, 0.0f}},
+			{{-w,  h, 0.0f}, normal, white, {0.0f, 1.0f}}
+		};
+		RemapQuadUVs(vertices.data(), vertices.size(), atlas.regions[i]);
+		quads.push_back(queue.Arena().Add(vertices, {0, 1, 3, 1, 2, 3}));
+	}
+
+	for(int q = 0; q < quadCount; ++q)
+	{
+		const Philox4x32 r = Philox4x32::Generate(uint32_t(q), 1, 0, 0, 0x5b1du, 0);
+		const uint32_t image = r.v[0] % atlasImageCount;
+		const glm::vec4 offsetScale(1.9f * ToUnitFloat(r.v[1]) - 0.95f, 1.9f * ToUnitFloat(r.v[2]) - 0.95f, 0.0f,
+				0.03f + 0.07f * ToUnitFloat(r.v[3]));
+		// the shader reads the layer of the image from the tint alpha
+		sprites.push_back({quads[image], ToUnitFloat(r.v[3]), {offsetScale, glm::vec4(1.0f, 1.0f, 1.0f, float(atlas.regions[image].layer))}});
+	}
+}
+
+AtlasScene::~AtlasScene()
+{
+	glDeleteTextures(1, &texture);
+}
+
+void AtlasScene::Update(float /*deltaTime*/)
+{
+}
+
+void AtlasScene::Render()
+{
+	PROFILE_ZONE("AtlasScene::Render");
+	const GLuint prg = shaders.Program(program);
+	for(const Sprite &sprite : sprites)
+	{
+		queue.Submit(prg, texture, sprite.quad, sprite.depth, sprite.instance);
+	}
+}
+
+/* PARTICLES */
+
+static const std::size_t interleaveGrain = 16 * 1024;
+
+// a particle is a sphere of this radius in world units
+static const CollisionParams collisionParams = {0.0f, 0.01f, 50.0f};
+
+// speed kept by a particle bouncing on the mesh
+static const float meshRestitution = 0.5f;
+
+// the mesh is drawn at the coarsest level off by at most this on screen
+static const float meshLodPixels = 1.0f;
+
+static void InterleavePositions(const ParticleStreams &streams, float *out, ThreadPool &pool)
+{
+	pool.ParallelFor(streams.Count(), interleaveGrain, [&](std::size_t begin, std::size_t end) {
+		for(std::size_t i = begin; i < end; ++i)
+		{
+			out[3 * i + 0] = streams.px[i];
+			out[3 * i + 1] = streams.py[i];
+			out[3 * i + 2] = streams.pz[i];
+		}
+	});
+}
+
+ParticleScene::ParticleScene(ShaderLibrary &shaders, ThreadPool &pool, RenderQueue &queue, int count, double ticksPerSecond,
+		bool collisions, const std::string &meshPath)
+	: shaders(shaders), pool(pool), queue(queue), streams(MakeParticleStreams(count)), frame(0),
+	spawn(0.0f, 1.0f, 0.0f), positions(std::size_t(count) * 3 * sizeof(float))
+{
+	program = shaders.Load({
+		{GL_VERTEX_SHADER, "resources/shaders/shaderGravity.vert"},
+		{GL_FRAGMENT_SHADER, "resources/shaders/shaderGravity.frag"}
+	});
+
+	// colors and sizes never change: uploaded once
+	std::vector<float> colors(std::size_t(count) * 3);
+	for(std::size_t i = 0; i < streams.Count(); ++i)
+	{
+		colors[3 * i + 0] = streams.red[i];
+		colors[3 * i + 1] = streams.green[i];
+		colors[3 * i + 2] = streams.blue[i];
+	}
+
+	glCreateBuffers(2, buffers);
+	glNamedBufferStorage(buffers[0], colors.size() * sizeof(float), colors.data(), 0);
+	glNamedBufferStorage(buffers[1], streams.size.size() * sizeof(float), streams.size.data(), 0);
+
+	const GLuint prg = shaders.Program(program);
+	const GLint attributes[3] = {
+		glGetAttribLocation(prg, "position"),
+		glGetAttribLocation(prg, "color"),
+		glGetAttribLocation(prg, "pointSize")
+	};
+	const GLint components[3] = {3, 3, 1};
+
+	glCreateVertexArrays(1, &vao);
+	for(GLuint b = 0; b < 3; ++b)
+	{
+		if(attributes[b] < 0)
+		{
+			continue;
+		}
+		const GLuint attribute = GLuint(attributes[b]);
+		// the position region moves every frame: bound in Render
+		if(b > 0)
+		{
+			glVertexArrayVertexBuffer(vao, b, buffers[b - 1], 0, GLsizei(components[b] * sizeof(float)));
+		}
+		glVertexArrayAttribFormat(vao, attribute, components[b], GL_FLOAT, GL_FALSE, 0);
+		glVertexArrayAttribBinding(vao, attribute, b);
+		glEnableVertexArrayAttrib(vao, attribute);
+	}
+
+	if(collisions)
+	{
+		grid.reset(new SpatialGrid(2.0f * collisionParams.radius));
+	}
+
+	if(!meshPath.empty())
+	{
+		LoadMesh(meshPath);
+	}
+
+	if(ticksPerSecond > 0.0)
+	{
+		loop.reset(new FixedStepLoop(ticksPerSecond, [this](float deltaTime, uint64_t) { Tick(deltaTime); }));
+	}
+}
+
+ParticleScene::~ParticleScene()
+{
+	loop.reset();
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(2, buffers);
+}
+
+void ParticleScene::LoadMesh(const std::string &path)
+{
+	std::vector<Triangle> triangles = ReadStlMapped(path.c_str(), &pool);
+	if(triangles.empty())
+	{
+		throw std::runtime_error("No triangle in " + path);
+	}
+
+	// fitted in the lower part of the screen, the plane the particles
+	// start in (z = 0) through its middle
+	glm::vec3 low(std::numeric_limits<float>::max()), high(-std::numeric_limits<float>::max());
+	for(const Triangle &t : triangles)
+	{
+		low = glm::min(glm::min(low, t.p0), glm::min(t.p1, t.p2));
+		high = glm::max(glm::max(high, t.p0), glm::max(t.p1, t.p2));
+	}
+	const glm::vec3 center = (low + high) * 0.5f;
+	const float extent = std::max(std::max(high.x - low.x, high.y - low.y), high.z - low.z);
+	const float scale = extent > 0.0f ? 1.2f / extent : 1.0f;
+	const glm::vec3 target(0.0f, -0.3f, 0.0f);
+
+	for(Triangle &t : triangles)
+	{
+		t.p0 = (t.p0 - center) * scale + target;
+		t.p1 = (t.p1 - center) * scale + target;
+		t.p2 = (t.p2 - center) * scale + target;
+	}
+
+	// collisions against the full mesh
+	mesh.reset(new Bvh(triangles, &pool));
+
+	// drawn from an LOD chain, every level a mesh of the arena
+	for(const MeshLod &lod : BuildLodChain(WeldTriangles(triangles, 1e-5f)))
+	{
+		std::vector<ArenaVertex> vertices(lod.mesh.positions.size());
+		for(std::size_t v = 0; v < vertices.size(); ++v)
+		{
+			vertices[v] = {lod.mesh.positions[v], lod.mesh.normals[v], glm::vec3(1.0f), glm::vec2(0.0f)};
+		}
+		meshLevels.push_back(queue.Arena().Add(vertices, lod.mesh.indices));
+		meshErrors.push_back(lod.error);
+	}
+
+	meshProgram = shaders.Load({
+		{GL_VERTEX_SHADER, "resources/shaders/shaderMesh.vert"},
+		{GL_FRAGMENT_SHADER, "resources/shaders/shaderMesh.frag"}
+	});
+}
+
+void ParticleScene::Pointer(const glm::vec3 &world)
+{
+	glm::vec3 at = world;
+	if(mesh)
+	{
+		// picked on the surface under the cursor, just in front of it; off
+		// the mesh, the particles stay in their plane
+		RayHit hit;
+		const glm::vec3 origin(world.x, world.y, -1.0f), direction(0.0f, 0.0f, 1.0f);
+		if(mesh->Raycast(origin, direction, 2.0f, hit))
+		{
+			at = origin + direction * (hit.t - 1e-3f);
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(spawnMutex);
+			at.z = spawn.z;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(spawnMutex);
+	spawn = at;
+}
+
+bool ParticleScene::TickStats(FixedStepStats &stats) const
+{
+	if(!loop)
+	{
+		return false;
+	}
+	stats = loop->Stats();
+	return true;
+}
+
+void ParticleScene::ResetTickStats()
+{
+	if(loop)
+	{
+		loop->ResetStats();
+	}
+}
+
+void ParticleScene::Tick(float deltaTime)
+{
+	glm::vec3 at;
+	{
+		std::lock_guard<std::mutex> lock(spawnMutex);
+		at = spawn;
+	}
+	Step(deltaTime, at);
+
+	Snapshot &snapshot = snapshots.Back();
+	snapshot.current.resize(streams.Count() * 3);
+	InterleavePositions(streams, snapshot.current.data(), pool);
+
+	// the first tick has nothing to interpolate from
+	snapshot.previous.swap(lastPositions);
+	if(snapshot.previous.size() != snapshot.current.size())
+	{
+		snapshot.previous = snapshot.current;
+	}
+	lastPositions = snapshot.current;
+
+	snapshot.time = std::chrono::steady_clock::now();
+	snapshots.Publish();
+}
+
+void ParticleScene::Step(float deltaTime, const glm::vec3 &at)
+{
+	if(mesh)
+	{
+		stepStart.resize(streams.Count() * 3);
+		InterleavePositions(streams, stepStart.data(), pool);
+	}
+
+	SimulateGravity(streams, {deltaTime, at, 0x9e3779b9u, frame++}, pool);
+
+	if(grid)
+	{
+		grid->Build(streams.px.data(), streams.py.data(), streams.pz.data(), streams.Count(), pool);
+		CollisionParams params = collisionParams;
+		params.deltaTime = deltaTime;
+		ApplySoftCollisions(streams, *grid, params, pool);
+	}
+
+	if(mesh)
+	{
+		CollideWithMesh(streams, stepStart.data(), *mesh, meshRestitution, pool);
+	}
+}
+
+void ParticleScene::Update(float deltaTime)
+{
+	if(!loop)
+	{
+		Step(deltaTime, spawn);
+	}
+}
+
+void ParticleScene::Render()
+{
+	PROFILE_ZONE("ParticleScene::Render");
+	const std::size_t count = streams.Count();
+
+	if(mesh)
+	{
+		// drawn in clip space: the viewport height spans 2 units
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		const MeshHandle level = meshLevels[SelectLod(meshErrors, viewport[3] * 0.5f, meshLodPixels)];
+		queue.Submit(shaders.Program(meshProgram), 0, level, 0.0f, {glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec4(1.0f)});
+	}
+
+	// written straight into the mapped region, by chunks on the pool
+	float *mapped = static_cast<float *>(positions.Map());
+	if(!loop)
+	{
+		InterleavePositions(streams, mapped, pool);
+	}
+	else
+	{
+		const Snapshot &snapshot = snapshots.Read();
+		if(snapshot.current.size() != count * 3)
+		{
+			// no tick yet
+			positions.Unmap(0);
+			return;
+		}
+
+		// one tick behind wall time: from `previous` at the publication of
+		// the snapshot to `current` a tick later
+		const float alpha = std::min(1.0f, std::chrono::duration<float>(std::chrono::steady_clock::now() - snapshot.time)
+				/ std::chrono::duration<float>(loop->TickDuration()));
+
+		pool.ParallelFor(count, interleaveGrain, [&](std::size_t begin, std::size_t end) {
+			const float *previous = snapshot.previous.data();
+			const float *current = snapshot.current.data();
+			for(std::size_t i = begin; i < end; ++i)
+			{
+				const float x = previous[3 * i], y = previous[3 * i + 1];
+				// respawned during the tick: no trail across the screen
+				const float t = y < -1.0f || x < -1.0f || x > 1.0f ? 1.0f : alpha;
+				for(std::size_t k = 3 * i; k < 3 * i + 3; ++k)
+				{
+					mapped[k] = previous[k] + (current[k] - previous[k]) * t;
+				}
+			}
+		});
+	}
+	glVertexArrayVertexBuffer(vao, 0, positions.Buffer(), positions.Offset(), 3 * sizeof(float));
+
+	glUseProgram(shaders.Program(program));
+	glBindVertexArray(vao);
+	glDrawArrays(GL_POINTS, 0, GLsizei(count));
+	AddProfileCounter(ProfileCounter::DrawCalls, 1);
+
+	positions.Unmap(count * 3 * sizeof(float));
+}
+
+/* GPU PARTICLES */
+
+GpuParticleScene::GpuParticleScene(ShaderLibrary &shaders, const ParticleStreams &initial)
+	: shaders(shaders), particles(shaders, initial),
+	deltaTime(0.0f), spawn(0.0f, 1.0f, 0.0f), frame(0)
+{
+	program = shaders.Load({
+		{GL_VERTEX_SHADER, "resources/shaders/shaderGravity.vert"},
+		{GL_FRAGMENT_SHADER, "resources/shaders/shaderGravity.frag"}
+	});
+
+	// colors never change: they stay on the CPU side of the simulation
+	std::vector<float> rgb(initial.Count() * 3);
+	for(std::size_t i = 0; i < initial.Count(); ++i)
+	{
+		rgb[3 * i + 0] = initial.red[i];
+		rgb[3 * i + 1] = initial.green[i];
+		rgb[3 * i + 2] = initial.blue[i];
+	}
+
+	glCreateBuffers(1, &colors);
+	glNamedBufferStorage(colors, rgb.size() * sizeof(float), rgb.data(), 0);
+
+	// locations fixed in shaderGravity.vert; position and size share a buffer
+	glCreateVertexArrays(1, &vao);
+	glVertexArrayVertexBuffer(vao, 0, particles.PositionBuffer(), 0, GpuParticles::positionStride);
+	glVertexArrayVertexBuffer(vao, 1, colors, 0, 3 * sizeof(float));
+
+	glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+	glVertexArrayAttribBinding(vao, 0, 0);
+	glVertexArrayAttribFormat(vao, 1, 3, GL_FLOAT, GL_FALSE, 0);
+	glVertexArrayAttribBinding(vao, 1, 1);
+	glVertexArrayAttribFormat(vao, 2, 1, GL_FLOAT, GL_FALSE, GpuParticles::sizeOffset);
+	glVertexArrayAttribBinding(vao, 2, 0);
+
+	for(GLuint attribute = 0; attribute < 3; ++attribute)
+	{
+		glEnableVertexArrayAttrib(vao, attribute);
+	}
+}
+
+GpuParticleScene::~GpuParticleScene()
+{
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(1, &colors);
+}
+
+void GpuParticleScene::Update(float delta)
+{
+	// the step is a GL call: dispatched in Render
+	deltaTime = delta;
+}
+
+void GpuParticleScene::Render()
+{
+	PROFILE_ZONE("GpuParticleScene::Render");
+	particles.Simulate({deltaTime, spawn, 0x9e3779b9u, frame++});
+
+	glUseProgram(shaders.Program(program));
+	glBindVertexArray(vao);
+	glDrawArrays(GL_POINTS, 0, GLsizei(particles.Count()));
+	AddProfileCounter(ProfileCounter::DrawCalls, 1);
+}
+
+std::unique_ptr<Scene> MakeScene(const std::string &name, ShaderLibrary &shaders, AssetManager &assets, ThreadPool &pool,
+		RenderQueue &queue, const SceneOptions &options)
+{
+	if(name == "quad")
+	{
+		return std::unique_ptr<Scene>(new QuadScene(shaders, assets, queue));
+	}
+	if(name == "atlas")
+	{
+		return std::unique_ptr<Scene>(new AtlasScene(shaders, queue, options.quads));
+	}
+	if(name == "particles" && options.simulation == ParticleSimulation::Gpu)
+	{
+		return std::unique_ptr<Scene>(new GpuParticleScene(shaders, MakeParticleStreams(options.particles)));
+	}
+	if(name == "particles")
+	{
+		return std::unique_ptr<Scene>(new ParticleScene(shaders, pool, queue, options.particles, options.tickRate, options.collisions,
+				options.mesh));
+	}
+	throw std::runtime_error("Unknown scene: " + name + " (quad, atlas or particles)");
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/vec3.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "assets.h"
+#include "bvh.h"
+#include "collisions.h"
+#include "fixed_step.h"
+#include "gpu_particles.h"
+#include "particles.h"
+#include "render_queue.h"
+#include "shader_library.h"
+#include "stream_buffer.h"
+#include "thread_pool.h"
+#include "triple_buffer.h"
+
+// What the main loop runs: CPU work in Update, GL calls in Render. Meshes
+// are submitted to the RenderQueue, drawn once the scene has rendered.
+class Scene
+{
+public:
+	virtual ~Scene() {}
+
+	virtual void Update(float deltaTime) = 0;
+	virtual void Render() = 0;
+
+	// Cursor in world coordinates, when there is a window
+	virtual void Pointer(const glm::vec3 & /*world*/) {}
+
+	// Fills `stats` when the scene simulates on a fixed step thread
+	virtual bool TickStats(FixedStepStats & /*stats*/) const { return false; }
+	// Starts the tick statistics over, with the measured frames
+	virtual void ResetTickStats() {}
+};
+
+// The textured quad
+class QuadScene : public Scene
+{
+public:
+	QuadScene(ShaderLibrary &shaders, AssetManager &assets, RenderQueue &queue);
+
+	void Update(float deltaTime) override;
+	void Render() override;
+
+private:
+	ShaderLibrary &shaders;
+	AssetManager &assets;
+	RenderQueue &queue;
+
+	ProgramId program;
+	AssetId texture;
+	MeshHandle quad;
+};
+
+// Thousands of quads showing the images of one texture atlas: they share the
+// program and the texture, so the queue draws them with a single bind
+class AtlasScene : public Scene
+{
+public:
+	AtlasScene(ShaderLibrary &shaders, RenderQueue &queue, int quadCount);
+	~AtlasScene();
+
+	void Update(float deltaTime) override;
+	void Render() override;
+
+private:
+	struct Sprite
+	{
+		MeshHandle quad;
+		float depth;
+		DrawInstance instance;
+	};
+
+	ShaderLibrary &shaders;
+	RenderQueue &queue;
+
+	ProgramId program;
+	GLuint texture;
+	std::vector<Sprite> sprites;
+};
+
+// Falling particles simulated on the CPU, drawn as points. With a tick
+// rate the simulation runs on its own thread at that fixed step and Render
+// interpolates between the last two ticks; without, it steps once per frame
+// by the frame time. Given an STL, the particles bounce on it, the pointer
+// picks the spawn point on its surface and it is drawn at the level of
+// detail its size on screen calls for.
+class ParticleScene : public Scene
+{
+public:
+	ParticleScene(ShaderLibrary &shaders, ThreadPool &pool, RenderQueue &queue, int count, double ticksPerSecond = 0.0,
+			bool collisions = false, const std::string &meshPath = std::string());
+	~ParticleScene();
+
+	void Update(float deltaTime) override;
+	void Render() override;
+	void Pointer(const glm::vec3 &world) override;
+	bool TickStats(FixedStepStats &stats) const override;
+	void ResetTickStats() override;
+
+private:
+	// Positions before and after a tick, interleaved
+	struct Snapshot
+	{
+		std::chrono::steady_clock::time_point time;
+		std::vector<float> previous, current;
+	};
+
+	void Tick(float deltaTime);
+	void Step(float deltaTime, const glm::vec3 &at);
+	void LoadMesh(const std::string &path);
+
+	ShaderLibrary &shaders;
+	ThreadPool &pool;
+	RenderQueue &queue;
+
+	// owned by the simulation thread when there is one
+	ParticleStreams streams;
+	// soft collisions when set
+	std::unique_ptr<SpatialGrid> grid;
+	std::vector<float> lastPositions;
+	// mesh collisions when set, from the positions before the step
+	std::unique_ptr<Bvh> mesh;
+	std::vector<float> stepStart;
+	uint32_t frame;
+
+	std::mutex spawnMutex;
+	glm::vec3 spawn;
+
+	TripleBuffer<Snapshot> snapshots;
+
+	ProgramId program;
+	GLuint vao;
+	// positions interleaved for the vertex shader, written in place every frame
+	StreamBuffer positions;
+	// colors and sizes
+	GLuint buffers[2];
+
+	// one arena mesh per level of detail
+	ProgramId meshProgram;
+	std::vector<MeshHandle> meshLevels;
+	std::vector<float> meshErrors;
+
+	// last: stopped before anything it touches goes away
+	std::unique_ptr<FixedStepLoop> loop;
+};
+
+// The same particles simulated by a compute shader and drawn from its buffers
+class GpuParticleScene : public Scene
+{
+public:
+	GpuParticleScene(ShaderLibrary &shaders, const ParticleStreams &initial);
+	~GpuParticleScene();
+
+	void Update(float deltaTime) override;
+	void Render() override;
+	void Pointer(const glm::vec3 &world) override { spawn = world; }
+
+private:
+	ShaderLibrary &shaders;
+
+	GpuParticles particles;
+	float deltaTime;
+	glm::vec3 spawn;
+	uint32_t frame;
+
+	ProgramId program;
+	GLuint vao;
+	GLuint colors;
+};
+
+enum class ParticleSimulation
+{
+	Cpu,
+	Gpu
+};
+
+struct SceneOptions
+{
+	int particles = 100000;
+	ParticleSimulation simulation = ParticleSimulation::Cpu;
+	// fixed step of the CPU simulation thread, 0 steps once per frame
+	double tickRate = 0.0;
+	// soft collisions between CPU simulated particles
+	bool collisions = false;
+	// STL the CPU simulated particles collide with, none when empty
+	std::string mesh;
+	// quads of the atlas scene
+	int quads = 4096;
+};
+
+// "quad", "atlas" or "particles", throws on an unknown name
+std::unique_ptr<Scene> MakeScene(const std::string &name, ShaderLibrary &shaders, AssetManager &assets, ThreadPool &pool,
+		RenderQueue &queue, const SceneOptions &options);
@@ -1,13 +1,46 @@
 #include <glad/glad.h>
 
+#include "shader.h"
+
 #include <vector>
 #include <fstream>
 #include <sstream>
-#include <iostream>
+#include <stdexcept>
+
+std::string ShaderInfoLog(GLuint shader)
+{
+	GLint length = 0;
+	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+	if(length <= 1)
+	{
+		return std::string();
+	}
+
+	std::string log(std::size_t(length), '\0');
+	GLsizei written = 0;
+	glGetShaderInfoLog(shader, length, &written, &log[0]);
+	log.resize(std::size_t(written));
+	return log;
+}
+
+std::string ProgramInfoLog(GLuint program)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+	if(length <= 1)
+	{
+		return std::string();
+	}
+
+	std::string log(std::size_t(length), '\0');
+	GLsizei written = 0;
+	glGetProgramInfoLog(program, length, &written, &log[0]);
+	log.resize(std::size_t(written));
+	return log;
+}
 
 GLuint MakeShader(GLuint t, std::string path)
 {
-	std::cout << path << std::endl;
 	std::ifstream file(path.c_str(), std::ios::in);
 
 	if(!file.good())
@@ -19,9 +52,11 @@ GLuint MakeShader(GLuint t, std::string path)
 	contents << file.rdbuf();
 	file.close();
 
-	const auto content = contents.str();
-	std::cout << content << std::endl;
+	return MakeShaderFromSource(t, contents.str(), path);
+}
 
+GLuint MakeShaderFromSource(GLuint t, const std::string &content, const std::string &name)
+{
 	const auto s = glCreateShader(t);
 
 	GLint sizes[] = {(GLint) content.size()};
@@ -34,11 +69,10 @@ GLuint MakeShader(GLuint t, std::string path)
 	glGetShaderiv(s, GL_COMPILE_STATUS, &success);
 	if(!success)
 	{
-		GLchar infoLog[512];
-		GLsizei l;
-		glGetShaderInfoLog(s, 512, &l, infoLog);
+		const std::string log = ShaderInfoLog(s);
+		glDeleteShader(s);
 
-		throw std::runtime_error(infoLog);
+		throw std::runtime_error(name + ": " + log);
 	}
 
 	return s;
@@ -58,11 +92,10 @@ GLuint AttachAndLink(std::vector<GLuint> shaders)
 	glGetProgramiv(prg, GL_LINK_STATUS, &success);
 	if(!success)
 	{
-		GLchar infoLog[512];
-		GLsizei l;
-		glGetProgramInfoLog(prg, 512, &l, infoLog);
+		const std::string log = ProgramInfoLog(prg);
+		glDeleteProgram(prg);
 
-		throw std::runtime_error(infoLog);
+		throw std::runtime_error(log);
 	}
 
 	return prg;
@@ -4,4 +4,10 @@
 #include <string>
 
 GLuint MakeShader(GLuint t, std::string path);
+// Compiles already loaded source, `name` only labels errors
+GLuint MakeShaderFromSource(GLuint t, const std::string &source, const std::string &name);
 GLuint AttachAndLink(std::vector<GLuint> shaders);
+
+// Whole info logs, however long the driver made them
+std::string ShaderInfoLog(GLuint shader);
+std::string ProgramInfoLog(GLuint program);
@@ -0,0 +1,303 @@
+#include "shader_library.h"
+#include "file_identity.h"
+#include "hash.h"
+#include "shader.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+// On-disk program binary: this header then the driver's blob
+namespace
+{
+	const char binaryMagic[8] = {'G', 'G', 'L', 'P', 'R', 'O', 'G', '\0'};
+	const uint32_t binaryVersion = 1;
+
+	struct BinaryHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t format;
+		uint64_t key;
+		uint64_t size;
+	};
+
+	std::string GlString(GLenum name)
+	{
+		const GLubyte *value = glGetString(name);
+		return value ? reinterpret_cast<const char *>(value) : "";
+	}
+
+	GLuint CompileStage(const ShaderStage &stage, const PreprocessedShader &shader)
+	{
+		const GLuint s = glCreateShader(stage.type);
+		const char *data = shader.source.data();
+		const GLint size = GLint(shader.source.size());
+		glShaderSource(s, 1, &data, &size);
+		glCompileShader(s);
+
+		GLint success;
+		glGetShaderiv(s, GL_COMPILE_STATUS, &success);
+		if(!success)
+		{
+			const std::string log = AnnotateShaderLog(ShaderInfoLog(s), shader.files);
+			glDeleteShader(s);
+			throw std::runtime_error(stage.path + ":\n" + log);
+		}
+
+		return s;
+	}
+}
+
+ShaderLibrary::ShaderLibrary(const std::string &cacheDirectory, const std::string &includeRoot)
+	: cacheDirectory(cacheDirectory), includeRoot(includeRoot)
+{
+	driver = GlString(GL_VENDOR) + "|" + GlString(GL_RENDERER) + "|" + GlString(GL_VERSION);
+
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	binariesSupported = formats > 0 && !cacheDirectory.empty();
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+	for(const auto &entry : programs)
+	{
+		glDeleteProgram(entry.program);
+	}
+}
+
+ProgramId ShaderLibrary::Load(const std::vector<ShaderStage> &stages, const std::vector<ShaderDefine> &defines)
+{
+	Entry entry;
+	entry.stages = stages;
+	entry.defines = defines;
+	entry.program = Build(entry);
+
+	programs.push_back(std::move(entry));
+	return ProgramId(programs.size() - 1);
+}
+
+GLuint ShaderLibrary::Build(Entry &entry)
+{
+	std::vector<Dependency> dependencies;
+	std::vector<PreprocessedShader> shaders;
+
+	uint64_t key = HashBytes(driver.data(), driver.size());
+	for(const auto &stage : entry.stages)
+	{
+		shaders.push_back(PreprocessShader(stage.path, entry.defines, includeRoot));
+		const auto &shader = shaders.back();
+
+		key = HashBytes(&stage.type, sizeof(stage.type), key);
+		key = HashBytes(shader.source.data(), shader.source.size(), key);
+
+		for(const auto &file : shader.files)
+		{
+			dependencies.push_back({file, fs::last_write_time(file)});
+		}
+	}
+	entry.dependencies = std::move(dependencies);
+
+	if(const GLuint cached = LoadBinary(key))
+	{
+		++stats.cacheHits;
+		return cached;
+	}
+
+	std::vector<GLuint> compiled;
+	try
+	{
+		for(std::size_t s = 0; s < entry.stages.size(); ++s)
+		{
+			compiled.push_back(CompileStage(entry.stages[s], shaders[s]));
+		}
+	}
+	catch(...)
+	{
+		for(const GLuint s : compiled)
+		{
+			glDeleteShader(s);
+		}
+		throw;
+	}
+
+	const GLuint program = glCreateProgram();
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	for(const GLuint s : compiled)
+	{
+		glAttachShader(program, s);
+	}
+	glLinkProgram(program);
+
+	for(const GLuint s : compiled)
+	{
+		glDetachShader(program, s);
+		glDeleteShader(s);
+	}
+
+	GLint success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if(!success)
+	{
+		const std::string log = ProgramInfoLog(program);
+		glDeleteProgram(program);
+
+		std::string names;
+		for(const auto &stage : entry.stages)
+		{
+			names += (names.empty() ? "" : " + ") + stage.path;
+		}
+		throw std::runtime_error(names + ": link failed:\n" + log);
+	}
+
+	++stats.compiled;
+	StoreBinary(key, program);
+	return program;
+}
+
+std::string ShaderLibrary::BinaryPath(uint64_t key) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.glprog", static_cast<unsigned long long>(key));
+	return (fs::path(cacheDirectory) / name).string();
+}
+
+GLuint ShaderLibrary::LoadBinary(uint64_t key) const
+{
+	if(!binariesSupported)
+	{
+		return 0;
+	}
+
+	std::ifstream in(BinaryPath(key), std::ios::in | std::ios::binary);
+	if(!in.is_open())
+	{
+		return 0;
+	}
+
+	BinaryHeader header;
+	in.read(reinterpret_cast<char *>(&header), sizeof(header));
+	if(!in.good() || std::memcmp(header.magic, binaryMagic, sizeof(binaryMagic)) != 0
+			|| header.version != binaryVersion || header.key != key || header.size > (1u << 30))
+	{
+		return 0;
+	}
+
+	std::vector<char> blob(std::size_t(header.size));
+	in.read(blob.data(), std::streamsize(blob.size()));
+	if(!in.good())
+	{
+		return 0;
+	}
+
+	// the driver may still refuse it (other build, other GPU): compiled again then
+	const GLuint program = glCreateProgram();
+	glProgramBinary(program, GLenum(header.format), blob.data(), GLsizei(blob.size()));
+
+	GLint success = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if(!success)
+	{
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
+void ShaderLibrary::StoreBinary(uint64_t key, GLuint program) const
+{
+	if(!binariesSupported)
+	{
+		return;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0)
+	{
+		return;
+	}
+
+	BinaryHeader header = {};
+	std::memcpy(header.magic, binaryMagic, sizeof(binaryMagic));
+	header.version = binaryVersion;
+	header.key = key;
+
+	std::vector<char> blob(static_cast<std::size_t>(length));
+	GLsizei written = 0;
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &written, &format, blob.data());
+	header.format = format;
+	header.size = uint64_t(written);
+
+	// a cache that cannot be written only costs the next startup a compile
+	std::error_code error;
+	fs::create_directories(cacheDirectory, error);
+
+	try
+	{
+		WriteFileAside(BinaryPath(key).c_str(), &header, sizeof(header), {{sizeof(header), blob.data(), header.size}});
+	}
+	catch(const std::runtime_error &)
+	{
+	}
+}
+
+std::size_t ShaderLibrary::ReloadChanged()
+{
+	std::size_t reloaded = 0;
+
+	for(auto &entry : programs)
+	{
+		bool changed = false;
+		for(const auto &dependency : entry.dependencies)
+		{
+			std::error_code error;
+			const auto time = fs::last_write_time(dependency.path, error);
+			// a file being saved may briefly vanish: try again next time
+			if(!error && time != dependency.time)
+			{
+				changed = true;
+				break;
+			}
+		}
+
+		if(!changed)
+		{
+			continue;
+		}
+
+		try
+		{
+			const GLuint program = Build(entry);
+			glDeleteProgram(entry.program);
+			entry.program = program;
+			++stats.reloads;
+			++reloaded;
+		}
+		catch(const std::exception &e)
+		{
+			std::cerr << e.what() << std::endl;
+			++stats.failures;
+
+			// not retried until the files change again
+			for(auto &dependency : entry.dependencies)
+			{
+				std::error_code error;
+				const auto time = fs::last_write_time(dependency.path, error);
+				if(!error)
+				{
+					dependency.time = time;
+				}
+			}
+		}
+	}
+
+	return reloaded;
+}
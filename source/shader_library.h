@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "shader_preprocessor.h"
+
+struct ShaderStage
+{
+	GLenum type;
+	std::string path;
+};
+
+typedef uint32_t ProgramId;
+
+struct ShaderLibraryStats
+{
+	std::size_t compiled = 0;    // programs built from source
+	std::size_t cacheHits = 0;   // programs restored from a binary
+	std::size_t reloads = 0;     // rebuilds after a file changed
+	std::size_t failures = 0;    // reloads that kept the previous program
+};
+
+// Owns the shader programs: preprocessed sources, a persistent program
+// binary cache and hot reload. Binaries are keyed by a hash of the
+// preprocessed sources and of the driver strings, so an edit anywhere in an
+// include or a driver update never restores a stale program.
+// Every method must be called from the thread owning the GL context.
+class ShaderLibrary
+{
+public:
+	// Binaries go to `cacheDirectory`, created on demand; empty disables the cache
+	explicit ShaderLibrary(const std::string &cacheDirectory = ".shadercache", const std::string &includeRoot = "resources/shaders");
+	~ShaderLibrary();
+
+	ShaderLibrary(const ShaderLibrary &) = delete;
+	ShaderLibrary &operator=(const ShaderLibrary &) = delete;
+
+	// Builds a program, throws with the full diagnostics if it does not compile or link
+	ProgramId Load(const std::vector<ShaderStage> &stages, const std::vector<ShaderDefine> &defines = {});
+
+	// The GL name changes when the program is reloaded
+	GLuint Program(ProgramId id) const { return programs[id].program; }
+
+	// Rebuilds the programs one of whose files (sources or includes) changed
+	// on disk. A program that fails to build keeps its previous version and
+	// the diagnostics go to stderr. Returns how many programs were replaced.
+	std::size_t ReloadChanged();
+
+	const ShaderLibraryStats &Stats() const { return stats; }
+
+private:
+	struct Dependency
+	{
+		std::string path;
+		std::filesystem::file_time_type time;
+	};
+
+	struct Entry
+	{
+		std::vector<ShaderStage> stages;
+		std::vector<ShaderDefine> defines;
+		GLuint program = 0;
+		std::vector<Dependency> dependencies;
+	};
+
+	// New program for the entry, its dependencies updated
+	GLuint Build(Entry &entry);
+	GLuint LoadBinary(uint64_t key) const;
+	void StoreBinary(uint64_t key, GLuint program) const;
+	std::string BinaryPath(uint64_t key) const;
+
+	std::string cacheDirectory;
+	std::string includeRoot;
+	std::string driver;
+	bool binariesSupported;
+
+	std::vector<Entry> programs;
+	ShaderLibraryStats stats;
+};
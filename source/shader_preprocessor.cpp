@@ -0,0 +1,179 @@
+#include "shader_preprocessor.h"
+
+#include <filesystem>
+#include <fstream>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	std::string ReadShaderFile(const fs::path &path)
+	{
+		std::ifstream file(path, std::ios::in | std::ios::binary);
+		if(!file.good())
+		{
+			throw std::runtime_error("File not found: " + path.string());
+		}
+
+		std::ostringstream contents;
+		contents << file.rdbuf();
+		return contents.str();
+	}
+
+	bool StartsWithDirective(const std::string &line, const char *directive, std::size_t &rest)
+	{
+		std::size_t i = line.find_first_not_of(" \t");
+		if(i == std::string::npos || line[i] != '#')
+		{
+			return false;
+		}
+		i = line.find_first_not_of(" \t", i + 1);
+		const std::size_t length = std::char_traits<char>::length(directive);
+		if(i == std::string::npos || line.compare(i, length, directive) != 0)
+		{
+			return false;
+		}
+		rest = i + length;
+		// "#includes" is not "#include"
+		return rest == line.size() || line[rest] == ' ' || line[rest] == '\t' || line[rest] == '"' || line[rest] == '<' || line[rest] == '\r';
+	}
+
+	struct Preprocessor
+	{
+		fs::path includeRoot;
+		const std::vector<ShaderDefine> &defines;
+
+		PreprocessedShader result;
+		std::set<fs::path> included;
+
+		fs::path Resolve(const std::string &name, bool quoted, const fs::path &from) const
+		{
+			if(quoted)
+			{
+				const fs::path local = from.parent_path() / name;
+				if(fs::exists(local))
+				{
+					return local;
+				}
+			}
+
+			const fs::path global = includeRoot / name;
+			if(fs::exists(global))
+			{
+				return global;
+			}
+
+			throw std::runtime_error(from.string() + ": cannot find include " + name);
+		}
+
+		void Process(const fs::path &path, bool root, std::ostringstream &out)
+		{
+			const int fileIndex = int(result.files.size());
+			result.files.push_back(path.string());
+			included.insert(fs::weakly_canonical(path));
+
+			std::istringstream input(ReadShaderFile(path));
+			std::string line;
+			int lineNumber = 0;
+			bool sawVersion = false;
+
+			while(std::getline(input, line))
+			{
+				++lineNumber;
+				std::size_t rest;
+
+				if(StartsWithDirective(line, "version", rest))
+				{
+					if(!root)
+					{
+						throw std::runtime_error(path.string() + ":" + std::to_string(lineNumber) + ": #version in an included file");
+					}
+
+					// defines go right after #version, which must stay first
+					out << line << '\n';
+					for(const auto &define : defines)
+					{
+						out << "#define " << define.name << ' ' << define.value << '\n';
+					}
+					out << "#line " << lineNumber + 1 << ' ' << fileIndex << '\n';
+					sawVersion = true;
+					continue;
+				}
+
+				if(StartsWithDirective(line, "pragma", rest) && line.find("once", rest) != std::string::npos)
+				{
+					// implied for every file
+					out << '\n';
+					continue;
+				}
+
+				if(!StartsWithDirective(line, "include", rest))
+				{
+					out << line << '\n';
+					continue;
+				}
+
+				const std::size_t open = line.find_first_of("\"<", rest);
+				const std::size_t close = open == std::string::npos ? open : line.find(line[open] == '"' ? '"' : '>', open + 1);
+				if(close == std::string::npos)
+				{
+					throw std::runtime_error(path.string() + ":" + std::to_string(lineNumber) + ": malformed #include");
+				}
+
+				const fs::path target = Resolve(line.substr(open + 1, close - open - 1), line[open] == '"', path);
+				if(included.count(fs::weakly_canonical(target)))
+				{
+					out << '\n';
+					continue;
+				}
+
+				out << "#line 1 " << result.files.size() << '\n';
+				Process(target, false, out);
+				out << "#line " << lineNumber + 1 << ' ' << fileIndex << '\n';
+			}
+
+			if(root && !sawVersion && !defines.empty())
+			{
+				throw std::runtime_error(path.string() + ": defines need a #version line to follow");
+			}
+		}
+	};
+}
+
+PreprocessedShader PreprocessShader(const std::string &path, const std::vector<ShaderDefine> &defines, const std::string &includeRoot)
+{
+	Preprocessor preprocessor{includeRoot, defines, {}, {}};
+
+	std::ostringstream out;
+	preprocessor.Process(path, true, out);
+	preprocessor.result.source = out.str();
+	return std::move(preprocessor.result);
+}
+
+std::string AnnotateShaderLog(const std::string &log, const std::vector<std::string> &files)
+{
+	// Mesa "0:12(5):", NVIDIA "0(12) :", AMD "ERROR: 0:12:"
+	static const std::regex location(R"(^((?:ERROR|WARNING): )?(\d+)([:(])(\d+))");
+
+	std::istringstream input(log);
+	std::ostringstream out;
+	std::string line;
+	while(std::getline(input, line))
+	{
+		std::smatch match;
+		if(std::regex_search(line, match, location))
+		{
+			const std::size_t index = std::stoul(match[2].str());
+			if(index < files.size())
+			{
+				line = match[1].str() + files[index] + match[3].str() + match[4].str() + match.suffix().str();
+			}
+		}
+		out << line << '\n';
+	}
+	return out.str();
+}
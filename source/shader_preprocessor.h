@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct ShaderDefine
+{
+	std::string name;
+	std::string value;
+};
+
+struct PreprocessedShader
+{
+	std::string source;
+	// every file read, the root first; the index is the #line source number
+	std::vector<std::string> files;
+};
+
+// Expands #include "file" (next to the including file, then under
+// `includeRoot`) and #include <file> (under `includeRoot`). A file is
+// included at most once per shader, so headers need no guards. `defines`
+// are inserted right after #version. #line directives keep the compiler
+// diagnostics pointing at the original files.
+PreprocessedShader PreprocessShader(const std::string &path, const std::vector<ShaderDefine> &defines = {},
+		const std::string &includeRoot = "resources/shaders");
+
+// Replaces the source numbers of an info log ("0:12(5): error", "1(7) : error")
+// with the file names they stand for
+std::string AnnotateShaderLog(const std::string &log, const std::vector<std::string> &files);
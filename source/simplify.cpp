@@ -0,0 +1,505 @@
+#include "simplify.h"
+#include "profiler.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+
+namespace
+{
+	// border planes weigh more than faces: borders move only when it is cheap
+	const double borderWeight = 10.0;
+	// a collapse may turn a neighbouring triangle by about 78 degrees at most
+	const double minNormalDot = 0.2;
+
+	// Sum of squared distances to a set of planes, as the symmetric 4x4
+	// matrix of the plane equations
+	struct Quadric
+	{
+		double xx = 0.0, xy = 0.0, xz = 0.0, xw = 0.0;
+		double yy = 0.0, yz = 0.0, yw = 0.0;
+		double zz = 0.0, zw = 0.0;
+		double ww = 0.0;
+
+		static Quadric Plane(const glm::dvec3 &n, double d, double weight)
+		{
+			Quadric q;
+			q.xx = weight * n.x * n.x; q.xy = weight * n.x * n.y; q.xz = weight * n.x * n.z; q.xw = weight * n.x * d;
+			q.yy = weight * n.y * n.y; q.yz = weight * n.y * n.z; q.yw = weight * n.y * d;
+			q.zz = weight * n.z * n.z; q.zw = weight * n.z * d;
+			q.ww = weight * d * d;
+			return q;
+		}
+
+		void Add(const Quadric &q)
+		{
+			xx += q.xx; xy += q.xy; xz += q.xz; xw += q.xw;
+			yy += q.yy; yz += q.yz; yw += q.yw;
+			zz += q.zz; zw += q.zw;
+			ww += q.ww;
+		}
+
+		double Evaluate(const glm::dvec3 &p) const
+		{
+			const double x = p.x, y = p.y, z = p.z;
+			return x * (xx * x + 2.0 * (xy * y + xz * z + xw))
+					+ y * (yy * y + 2.0 * (yz * z + yw))
+					+ z * (zz * z + 2.0 * zw)
+					+ ww;
+		}
+
+		// Point of least error, false when the planes do not pin one down
+		// (flat or creased neighbourhoods)
+		bool Minimum(glm::dvec3 &p) const
+		{
+			const double det = xx * (yy * zz - yz * yz) - xy * (xy * zz - yz * xz) + xz * (xy * yz - yy * xz);
+			const double trace = xx + yy + zz;
+			if(std::abs(det) <= 1e-6 * trace * trace * trace)
+			{
+				return false;
+			}
+
+			// Cramer's rule on A p = -b
+			const double bx = -xw, by = -yw, bz = -zw;
+			p.x = (bx * (yy * zz - yz * yz) - xy * (by * zz - yz * bz) + xz * (by * yz - yy * bz)) / det;
+			p.y = (xx * (by * zz - yz * bz) - bx * (xy * zz - yz * xz) + xz * (xy * bz - by * xz)) / det;
+			p.z = (xx * (yy * bz - by * yz) - xy * (xy * bz - by * xz) + bx * (xy * yz - yy * xz)) / det;
+			return true;
+		}
+	};
+
+	// Merges `from` into `to`, which moves to `target`. Entries whose
+	// vertices changed since they were queued are skipped when popped. Kept
+	// to 32 bytes: the queue is the hot spot of the simplification.
+	struct Collapse
+	{
+		float cost;
+		uint32_t to, from;
+		uint32_t toStamp, fromStamp;
+		glm::vec3 target;
+
+		// std::priority_queue pops the largest: cheapest first
+		bool operator<(const Collapse &o) const { return cost > o.cost; }
+	};
+
+	class Simplifier
+	{
+	public:
+		explicit Simplifier(const Mesh &mesh);
+
+		// Collapses until `target` triangles are left, false when it stopped
+		// short: no collapse left under maxError, or none allowed
+		bool Run(std::size_t target, float maxError);
+
+		std::size_t TriangleCount() const { return liveTriangles; }
+		float Error() const { return float(std::sqrt(maxCost)); }
+
+		// The live triangles, with normals and optimized like BuildMesh
+		Mesh Extract() const;
+
+	private:
+		Collapse Evaluate(uint32_t to, uint32_t from) const;
+		bool IsAllowed(const Collapse &collapse);
+		void Apply(const Collapse &collapse);
+
+		bool HasCorner(uint32_t triangle, uint32_t v) const
+		{
+			return indices[3 * triangle] == v || indices[3 * triangle + 1] == v || indices[3 * triangle + 2] == v;
+		}
+
+		// Vertices sharing a live triangle with `v`, sorted
+		void Neighbours(uint32_t v, std::vector<uint32_t> &out) const;
+
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> indices;
+		std::vector<Quadric> quadrics;
+		// live triangles around each vertex, dead ones dropped on merge
+		std::vector<std::vector<uint32_t>> vertexTriangles;
+		std::vector<uint32_t> stamps;
+		std::vector<bool> removed;
+		std::vector<bool> dead;
+		std::size_t liveTriangles;
+		double maxCost;
+
+		std::priority_queue<Collapse> queue;
+		std::vector<uint32_t> neighboursTo, neighboursFrom;
+	};
+
+	Simplifier::Simplifier(const Mesh &mesh)
+		: positions(mesh.positions), indices(mesh.indices), quadrics(mesh.positions.size()),
+		vertexTriangles(mesh.positions.size()), stamps(mesh.positions.size(), 0), removed(mesh.positions.size(), false),
+		dead(mesh.indices.size() / 3, false), liveTriangles(0), maxCost(0.0)
+	{
+		const std::size_t triCount = indices.size() / 3;
+
+		std::vector<uint32_t> valence(positions.size(), 0);
+		for(const uint32_t v : indices)
+		{
+			++valence[v];
+		}
+		for(std::size_t v = 0; v < positions.size(); ++v)
+		{
+			vertexTriangles[v].reserve(valence[v]);
+		}
+
+		// edges as (smaller, larger) vertex pairs, sorted so copies are adjacent
+		struct Edge
+		{
+			uint64_t key;
+			uint32_t triangle;
+		};
+		std::vector<Edge> edges;
+		edges.reserve(indices.size());
+
+		std::vector<glm::dvec3> normals(triCount);
+		for(std::size_t t = 0; t < triCount; ++t)
+		{
+			const uint32_t *corner = &indices[3 * t];
+			if(corner[0] == corner[1] || corner[1] == corner[2] || corner[2] == corner[0])
+			{
+				dead[t] = true;
+				continue;
+			}
+
+			const glm::dvec3 a(positions[corner[0]]), b(positions[corner[1]]), c(positions[corner[2]]);
+			const glm::dvec3 n = glm::cross(b - a, c - a);
+			const double length = glm::length(n);
+			if(length > 0.0)
+			{
+				normals[t] = n / length;
+				const Quadric q = Quadric::Plane(normals[t], -glm::dot(normals[t], a), 1.0);
+				for(int k = 0; k < 3; ++k)
+				{
+					quadrics[corner[k]].Add(q);
+				}
+			}
+
+			for(int k = 0; k < 3; ++k)
+			{
+				const uint32_t v0 = corner[k], v1 = corner[(k + 1) % 3];
+				edges.push_back({uint64_t(std::min(v0, v1)) << 32 | std::max(v0, v1), uint32_t(t)});
+				vertexTriangles[v0].push_back(uint32_t(t));
+			}
+			++liveTriangles;
+		}
+
+		std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) { return a.key < b.key; });
+
+		for(std::size_t first = 0; first < edges.size();)
+		{
+			std::size_t last = first + 1;
+			while(last < edges.size() && edges[last].key == edges[first].key)
+			{
+				++last;
+			}
+
+			const uint32_t v0 = uint32_t(edges[first].key >> 32), v1 = uint32_t(edges[first].key);
+			if(last - first == 1)
+			{
+				// border: a plane through the edge, perpendicular to its face
+				const glm::dvec3 a(positions[v0]), b(positions[v1]);
+				const glm::dvec3 n = glm::cross(b - a, normals[edges[first].triangle]);
+				const double length = glm::length(n);
+				if(length > 0.0)
+				{
+					const Quadric q = Quadric::Plane(n / length, -glm::dot(n / length, a), borderWeight);
+					quadrics[v0].Add(q);
+					quadrics[v1].Add(q);
+				}
+			}
+			first = last;
+		}
+
+		// every quadric is complete: queue every edge once
+		for(std::size_t first = 0; first < edges.size();)
+		{
+			queue.push(Evaluate(uint32_t(edges[first].key >> 32), uint32_t(edges[first].key)));
+			const uint64_t key = edges[first].key;
+			while(first < edges.size() && edges[first].key == key)
+			{
+				++first;
+			}
+		}
+	}
+
+	Collapse Simplifier::Evaluate(uint32_t to, uint32_t from) const
+	{
+		Quadric q = quadrics[to];
+		q.Add(quadrics[from]);
+
+		const glm::dvec3 a(positions[to]), b(positions[from]);
+		const glm::dvec3 middle = (a + b) * 0.5;
+
+		glm::dvec3 best = middle;
+		double bestCost = q.Evaluate(middle);
+		for(const glm::dvec3 &p : {a, b})
+		{
+			const double cost = q.Evaluate(p);
+			if(cost < bestCost)
+			{
+				best = p;
+				bestCost = cost;
+			}
+		}
+
+		// the optimum of a nearly flat neighbourhood can lie far away
+		glm::dvec3 optimum;
+		if(q.Minimum(optimum) && glm::length(optimum - middle) <= glm::length(b - a))
+		{
+			const double cost = q.Evaluate(optimum);
+			if(cost < bestCost)
+			{
+				best = optimum;
+				bestCost = cost;
+			}
+		}
+
+		return {float(std::max(bestCost, 0.0)), to, from, stamps[to], stamps[from], glm::vec3(best)};
+	}
+
+	void Simplifier::Neighbours(uint32_t v, std::vector<uint32_t> &out) const
+	{
+		out.clear();
+		for(const uint32_t t : vertexTriangles[v])
+		{
+			if(dead[t])
+			{
+				continue;
+			}
+			for(int k = 0; k < 3; ++k)
+			{
+				if(indices[3 * t + k] != v)
+				{
+					out.push_back(indices[3 * t + k]);
+				}
+			}
+		}
+		std::sort(out.begin(), out.end());
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+	}
+
+	bool Simplifier::IsAllowed(const Collapse &collapse)
+	{
+		// link condition: the two ends may only share the vertices opposite
+		// the edge, or the surface would pinch
+		std::size_t shared = 0;
+		for(const uint32_t t : vertexTriangles[collapse.from])
+		{
+			shared += !dead[t] && HasCorner(t, collapse.to);
+		}
+		if(shared == 0)
+		{
+			return false;
+		}
+
+		Neighbours(collapse.to, neighboursTo);
+		Neighbours(collapse.from, neighboursFrom);
+		std::size_t common = 0;
+		for(auto a = neighboursTo.begin(), b = neighboursFrom.begin(); a != neighboursTo.end() && b != neighboursFrom.end();)
+		{
+			if(*a < *b)
+			{
+				++a;
+			}
+			else if(*b < *a)
+			{
+				++b;
+			}
+			else
+			{
+				++common;
+				++a;
+				++b;
+			}
+		}
+		if(common != shared)
+		{
+			return false;
+		}
+
+		// the triangles left around the moved vertex must not fold over
+		const glm::dvec3 target(collapse.target);
+		for(const uint32_t moved : {collapse.to, collapse.from})
+		{
+			for(const uint32_t t : vertexTriangles[moved])
+			{
+				if(dead[t] || (HasCorner(t, collapse.to) && HasCorner(t, collapse.from)))
+				{
+					continue;
+				}
+
+				glm::dvec3 before[3], after[3];
+				for(int k = 0; k < 3; ++k)
+				{
+					const uint32_t v = indices[3 * t + k];
+					before[k] = glm::dvec3(positions[v]);
+					after[k] = v == moved ? target : before[k];
+				}
+				const glm::dvec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+				const glm::dvec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+				const double length1 = glm::length(n1);
+				if(length1 == 0.0 || glm::dot(n0, n1) < minNormalDot * glm::length(n0) * length1)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	void Simplifier::Apply(const Collapse &collapse)
+	{
+		const uint32_t to = collapse.to, from = collapse.from;
+
+		std::vector<uint32_t> &around = vertexTriangles[to];
+		around.erase(std::remove_if(around.begin(), around.end(), [&](uint32_t t) { return dead[t]; }), around.end());
+
+		for(const uint32_t t : vertexTriangles[from])
+		{
+			if(dead[t])
+			{
+				continue;
+			}
+			if(HasCorner(t, to))
+			{
+				dead[t] = true;
+				--liveTriangles;
+				continue;
+			}
+			for(int k = 0; k < 3; ++k)
+			{
+				if(indices[3 * t + k] == from)
+				{
+					indices[3 * t + k] = to;
+				}
+			}
+			around.push_back(t);
+		}
+		around.erase(std::remove_if(around.begin(), around.end(), [&](uint32_t t) { return dead[t]; }), around.end());
+		std::vector<uint32_t>().swap(vertexTriangles[from]);
+
+		positions[to] = collapse.target;
+		quadrics[to].Add(quadrics[from]);
+		removed[from] = true;
+		++stamps[to];
+		maxCost = std::max(maxCost, double(collapse.cost));
+
+		// only the edges of the merged vertex changed cost
+		Neighbours(to, neighboursTo);
+		for(const uint32_t w : neighboursTo)
+		{
+			queue.push(Evaluate(to, w));
+		}
+	}
+
+	bool Simplifier::Run(std::size_t target, float maxError)
+	{
+		const double maxCostAllowed = double(maxError) * double(maxError);
+
+		while(liveTriangles > target)
+		{
+			if(queue.empty())
+			{
+				return false;
+			}
+
+			const Collapse collapse = queue.top();
+			if(removed[collapse.to] || removed[collapse.from]
+					|| stamps[collapse.to] != collapse.toStamp || stamps[collapse.from] != collapse.fromStamp)
+			{
+				queue.pop();
+				continue;
+			}
+			if(double(collapse.cost) > maxCostAllowed)
+			{
+				return false;
+			}
+			queue.pop();
+
+			if(IsAllowed(collapse))
+			{
+				Apply(collapse);
+			}
+		}
+		return true;
+	}
+
+	Mesh Simplifier::Extract() const
+	{
+		Mesh mesh;
+		mesh.positions = positions;
+		mesh.indices.reserve(liveTriangles * 3);
+		for(std::size_t t = 0; t < dead.size(); ++t)
+		{
+			if(!dead[t])
+			{
+				mesh.indices.insert(mesh.indices.end(), &indices[3 * t], &indices[3 * t] + 3);
+			}
+		}
+
+		// drops the collapsed vertices too
+		ComputeNormals(mesh, NormalMode::Smooth);
+		OptimizeVertexCache(mesh);
+		OptimizeVertexFetch(mesh);
+		return mesh;
+	}
+
+	std::size_t TargetTriangles(const Mesh &mesh, float ratio)
+	{
+		return std::size_t(double(mesh.indices.size() / 3) * std::min(std::max(double(ratio), 0.0), 1.0));
+	}
+}
+
+MeshLod SimplifyMesh(const Mesh &mesh, float ratio, float maxError)
+{
+	PROFILE_ZONE("SimplifyMesh");
+	Simplifier simplifier(mesh);
+	simplifier.Run(TargetTriangles(mesh, ratio), maxError);
+	return {simplifier.Extract(), simplifier.Error()};
+}
+
+std::vector<MeshLod> BuildLodChain(const Mesh &mesh, const std::vector<float> &ratios, float maxError)
+{
+	PROFILE_ZONE("BuildLodChain");
+	Simplifier simplifier(mesh);
+
+	std::vector<MeshLod> lods;
+	lods.push_back({simplifier.Extract(), 0.0f});
+
+	// the collapse sequence goes on from one level to the next
+	for(const float ratio : ratios)
+	{
+		const std::size_t previous = lods.back().mesh.indices.size() / 3;
+		const bool reached = simplifier.Run(TargetTriangles(mesh, ratio), maxError);
+		if(simplifier.TriangleCount() < previous)
+		{
+			lods.push_back({simplifier.Extract(), simplifier.Error()});
+		}
+		if(!reached)
+		{
+			break;
+		}
+	}
+	return lods;
+}
+
+float PixelsPerUnit(float viewportHeight, float fovY, float distance)
+{
+	return viewportHeight / (2.0f * std::tan(fovY * 0.5f) * std::max(distance, 1e-6f));
+}
+
+std::size_t SelectLod(const std::vector<float> &errors, float pixelsPerUnit, float maxPixels)
+{
+	// errors only grow along the chain
+	for(std::size_t level = errors.size(); level > 1; --level)
+	{
+		if(errors[level - 1] * pixelsPerUnit <= maxPixels)
+		{
+			return level - 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "mesh.h"
+
+// A simplified mesh and how far it may be from the original: no vertex is
+// farther than `error` (model units) from the planes of the original
+// triangles it stands for.
+struct MeshLod
+{
+	Mesh mesh;
+	float error;
+};
+
+// Edge collapses ordered by quadric error (Garland and Heckbert, "Surface
+// Simplification Using Quadric Error Metrics"), each vertex moved to the
+// point closest to the planes it gathered. Borders are not locked: a plane
+// through each border edge, weighted 10 times a face, penalises moving them,
+// so they move and collapse only within the error budget. Collapses that
+// flip a triangle or pinch the surface are skipped.
+// Works on welded meshes (WeldTriangles, ReadPly): split vertices, as left
+// by Faceted normals, are borders. Normals are recomputed smooth and the
+// result is optimized like BuildMesh.
+//
+// Stops at `ratio` of the triangles or before an error above maxError.
+MeshLod SimplifyMesh(const Mesh &mesh, float ratio, float maxError = std::numeric_limits<float>::infinity());
+
+// Levels of detail from one collapse sequence, each at about ratios[i] of
+// the triangles (decreasing). Level 0 is the mesh itself, optimized, with
+// no error. The chain ends early when maxError or the collapses run out.
+std::vector<MeshLod> BuildLodChain(const Mesh &mesh, const std::vector<float> &ratios = {0.5f, 0.25f, 0.1f, 0.05f},
+		float maxError = std::numeric_limits<float>::infinity());
+
+// Pixels covered by one model unit at `distance` from a perspective camera
+// with the given vertical field of view (radians)
+float PixelsPerUnit(float viewportHeight, float fovY, float distance);
+
+// Coarsest level of a chain, given the error of each, whose error covers
+// at most maxPixels on screen
+std::size_t SelectLod(const std::vector<float> &errors, float pixelsPerUnit, float maxPixels = 1.0f);
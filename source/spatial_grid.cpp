@@ -0,0 +1,140 @@
+#include "spatial_grid.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+static const std::size_t pointGrain = 16 * 1024;
+static const std::size_t bucketGrain = 64 * 1024;
+
+SpatialGrid::SpatialGrid(float cellSize)
+	: cellSize(cellSize), inverseCellSize(1.0f / cellSize), mask(0), cursorCount(0)
+{
+	if(!(cellSize > 0.0f))
+	{
+		throw std::runtime_error("SpatialGrid: the cell size must be positive");
+	}
+}
+
+void SpatialGrid::Build(const float *x, const float *y, const float *z, std::size_t count, ThreadPool &pool)
+{
+	PROFILE_ZONE("SpatialGrid::Build");
+
+	// about two buckets per point keeps collisions between cells rare
+	std::size_t buckets = 1024;
+	while(buckets < count * 2)
+	{
+		buckets *= 2;
+	}
+	mask = buckets - 1;
+
+	if(cursorCount != buckets)
+	{
+		cursors.reset(new std::atomic<uint32_t>[buckets]);
+		cursorCount = buckets;
+	}
+	bucketStart.resize(buckets + 1);
+	pointKeys.resize(count);
+	pointBuckets.resize(count);
+	order.resize(count);
+	xs.resize(count);
+	ys.resize(count);
+	zs.resize(count);
+	keys.resize(count);
+
+	// counting sort: sizes, exclusive scan, scatter
+	pool.ParallelFor(buckets, bucketGrain, [&](std::size_t begin, std::size_t end) {
+		for(std::size_t b = begin; b < end; ++b)
+		{
+			cursors[b].store(0, std::memory_order_relaxed);
+		}
+	});
+
+	pool.ParallelFor(count, pointGrain, [&](std::size_t begin, std::size_t end) {
+		for(std::size_t i = begin; i < end; ++i)
+		{
+			const uint64_t key = CellKey(CellCoordinate(x[i]), CellCoordinate(y[i]), CellCoordinate(z[i]));
+			const uint32_t bucket = Bucket(key);
+			pointKeys[i] = key;
+			pointBuckets[i] = bucket;
+			cursors[bucket].fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+
+	// per block sums, then the blocks offset by the sums before them
+	const std::size_t blocks = (buckets + bucketGrain - 1) / bucketGrain;
+	std::vector<uint32_t> blockStart(blocks);
+	pool.ParallelFor(blocks, 1, [&](std::size_t begin, std::size_t end) {
+		for(std::size_t k = begin; k < end; ++k)
+		{
+			uint32_t sum = 0;
+			for(std::size_t b = k * bucketGrain; b < std::min(buckets, (k + 1) * bucketGrain); ++b)
+			{
+				sum += cursors[b].load(std::memory_order_relaxed);
+			}
+			blockStart[k] = sum;
+		}
+	});
+
+	uint32_t total = 0;
+	for(auto &start : blockStart)
+	{
+		const uint32_t sum = start;
+		start = total;
+		total += sum;
+	}
+
+	pool.ParallelFor(blocks, 1, [&](std::size_t begin, std::size_t end) {
+		for(std::size_t k = begin; k < end; ++k)
+		{
+			uint32_t start = blockStart[k];
+			for(std::size_t b = k * bucketGrain; b < std::min(buckets, (k + 1) * bucketGrain); ++b)
+			{
+				const uint32_t size = cursors[b].load(std::memory_order_relaxed);
+				bucketStart[b] = start;
+				cursors[b].store(start, std::memory_order_relaxed);
+				start += size;
+			}
+		}
+	});
+	bucketStart[buckets] = uint32_t(count);
+
+	pool.ParallelFor(count, pointGrain, [&](std::size_t begin, std::size_t end) {
+		for(std::size_t i = begin; i < end; ++i)
+		{
+			order[cursors[pointBuckets[i]].fetch_add(1, std::memory_order_relaxed)] = uint32_t(i);
+		}
+	});
+
+	// the scatter order depends on the threads: back to index order
+	pool.ParallelFor(buckets, bucketGrain, [&](std::size_t begin, std::size_t end) {
+		for(std::size_t b = begin; b < end; ++b)
+		{
+			uint32_t *first = order.data() + bucketStart[b];
+			const uint32_t size = bucketStart[b + 1] - bucketStart[b];
+			// a handful of points: insertion sort
+			for(uint32_t k = 1; k < size; ++k)
+			{
+				const uint32_t v = first[k];
+				uint32_t j = k;
+				for(; j > 0 && first[j - 1] > v; --j)
+				{
+					first[j] = first[j - 1];
+				}
+				first[j] = v;
+			}
+		}
+	});
+
+	pool.ParallelFor(count, pointGrain, [&](std::size_t begin, std::size_t end) {
+		for(std::size_t s = begin; s < end; ++s)
+		{
+			const uint32_t i = order[s];
+			xs[s] = x[i];
+			ys[s] = y[i];
+			zs[s] = z[i];
+			keys[s] = pointKeys[i];
+		}
+	});
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ThreadPool;
+
+// Uniform grid over an unbounded space, hashed into a table of buckets.
+// Build bins the points with a counting sort, so the points of a bucket
+// are contiguous and the neighbours of a point sit in a few runs of memory.
+// Within a bucket points keep their index order: queries visit neighbours
+// in the same order whatever the thread count.
+class SpatialGrid
+{
+public:
+	// Neighbours are searched within one cell: queries take a radius up to cellSize
+	explicit SpatialGrid(float cellSize);
+
+	void Build(const float *x, const float *y, const float *z, std::size_t count, ThreadPool &pool);
+
+	std::size_t Count() const { return order.size(); }
+	float CellSize() const { return cellSize; }
+
+	// Point indices in bucket order
+	const std::vector<uint32_t> &Order() const { return order; }
+
+	// Calls visit(index, dx, dy, dz, distance2) for every point within
+	// `radius` of (px, py, pz), the point itself included, with d = p - point
+	template<typename Visit>
+	void ForEachNeighbour(float px, float py, float pz, float radius, Visit &&visit) const
+	{
+		const float radius2 = radius * radius;
+		const int cx = CellCoordinate(px), cy = CellCoordinate(py), cz = CellCoordinate(pz);
+
+		for(int dz = -1; dz <= 1; ++dz)
+		for(int dy = -1; dy <= 1; ++dy)
+		for(int dx = -1; dx <= 1; ++dx)
+		{
+			const uint64_t key = CellKey(cx + dx, cy + dy, cz + dz);
+			const uint32_t bucket = Bucket(key);
+
+			for(uint32_t s = bucketStart[bucket]; s < bucketStart[bucket + 1]; ++s)
+			{
+				// other cells can share the bucket
+				if(keys[s] != key)
+				{
+					continue;
+				}
+
+				const float ex = px - xs[s], ey = py - ys[s], ez = pz - zs[s];
+				const float distance2 = ex * ex + ey * ey + ez * ez;
+				if(distance2 <= radius2)
+				{
+					visit(order[s], ex, ey, ez, distance2);
+				}
+			}
+		}
+	}
+
+private:
+	int CellCoordinate(float v) const { return int(std::floor(v * inverseCellSize)); }
+
+	static uint64_t CellKey(int x, int y, int z)
+	{
+		// 21 bits per axis: the grid wraps every two million cells
+		return (uint64_t(uint32_t(x) & 0x1FFFFF) << 42) | (uint64_t(uint32_t(y) & 0x1FFFFF) << 21) | uint64_t(uint32_t(z) & 0x1FFFFF);
+	}
+
+	uint32_t Bucket(uint64_t key) const
+	{
+		// blocks of 4x4x4 cells are hashed (large primes from Teschner et al.,
+		// "Optimized Spatial Hashing") and their cells kept consecutive, so
+		// bucket order stays close to space order
+		const uint64_t x = key >> 42, y = (key >> 21) & 0x1FFFFF, z = key & 0x1FFFFF;
+		const uint64_t block = (x >> 2) * 73856093ull ^ (y >> 2) * 19349663ull ^ (z >> 2) * 83492791ull;
+		return uint32_t(((block << 6) | ((z & 3) << 4) | ((y & 3) << 2) | (x & 3)) & mask);
+	}
+
+	float cellSize;
+	float inverseCellSize;
+	uint64_t mask;
+
+	// bucketStart[b] to bucketStart[b + 1]: the sorted points of bucket b
+	std::vector<uint32_t> bucketStart;
+	std::vector<uint32_t> order;
+
+	// copies in bucket order, so a query reads memory sequentially
+	std::vector<float> xs, ys, zs;
+	std::vector<uint64_t> keys;
+
+	// per point, in index order
+	std::vector<uint64_t> pointKeys;
+	std::vector<uint32_t> pointBuckets;
+	// bucket sizes, then insertion cursors
+	std::unique_ptr<std::atomic<uint32_t>[]> cursors;
+	std::size_t cursorCount;
+};
@@ -1,6 +1,13 @@
 #include "stl.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
 
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <stdexcept>
+#include <string>
 
 std::vector<Triangle> ReadStl(const char * filename)
 {
@@ -41,3 +48,370 @@ std::vector<Triangle> ReadStl(const char * filename)
 		return {};
 	}
 }
+
+/* BINARY */
+
+// 80 bytes header, then a little-endian uint32 triangle count
+static const std::size_t headerSize = 84;
+// normal, three vertices, attribute byte count
+static const std::size_t recordSize = 50;
+
+static_assert(sizeof(Triangle) == 9 * sizeof(float), "Triangle must be three packed vec3");
+
+std::vector<Triangle> ParseBinaryStl(const unsigned char * data, std::size_t size, ThreadPool * pool)
+{
+	if(size < headerSize)
+	{
+		throw std::runtime_error("Truncated STL: missing header");
+	}
+
+	uint32_t triCount;
+	std::memcpy(&triCount, data + 80, 4);
+
+	if((size - headerSize) / recordSize < triCount)
+	{
+		throw std::runtime_error("Truncated STL: " + std::to_string(triCount) + " triangles announced, file holds "
+				+ std::to_string((size - headerSize) / recordSize));
+	}
+
+	std::vector<Triangle> tris(triCount);
+	const unsigned char * records = data + headerSize;
+
+	const auto decode = [&](std::size_t begin, std::size_t end) {
+		for(std::size_t i = begin; i < end; ++i)
+		{
+			// records are 50 bytes so the floats are unaligned: copy, skipping normal and attribute
+			std::memcpy(&tris[i], records + i * recordSize + 12, sizeof(Triangle));
+		}
+	};
+
+	if(pool)
+	{
+		pool->ParallelFor(triCount, 64 * 1024, decode);
+	}
+	else
+	{
+		decode(0, triCount);
+	}
+
+	return tris;
+}
+
+/* ASCII */
+
+static bool IsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static const char * SkipSpaces(const char * p, const char * end)
+{
+	while(p < end && IsSpace(*p))
+	{
+		++p;
+	}
+	return p;
+}
+
+static bool MatchKeyword(const char *& p, const char * end, const char * keyword)
+{
+	const std::size_t n = std::strlen(keyword);
+	if(std::size_t(end - p) < n || std::memcmp(p, keyword, n) != 0 || (p + n < end && !IsSpace(p[n])))
+	{
+		return false;
+	}
+	p += n;
+	return true;
+}
+
+static void ExpectKeyword(const char *& p, const char * end, const char * keyword)
+{
+	p = SkipSpaces(p, end);
+	if(!MatchKeyword(p, end, keyword))
+	{
+		throw std::runtime_error(std::string("Malformed ASCII STL: expected '") + keyword + "'");
+	}
+}
+
+// Eight ASCII digits at once (SWAR), or false if any byte is not a digit.
+// Assumes a little-endian host, like the binary STL path.
+static bool ParseEightDigits(const char * p, uint64_t & value)
+{
+	uint64_t chunk;
+	std::memcpy(&chunk, p, 8);
+
+	// high nibble of every byte is 3, and adding 6 does not carry into it
+	if(((chunk & 0xF0F0F0F0F0F0F0F0ull) | (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) != 0x3333333333333333ull)
+	{
+		return false;
+	}
+
+	// pairwise combine: 8 x 1 digit -> 4 x 2 digits -> 2 x 4 digits -> 8 digits
+	chunk = ((chunk & 0x0F0F0F0F0F0F0F0Full) * 2561) >> 8;
+	chunk = ((chunk & 0x00FF00FF00FF00FFull) * 6553601) >> 16;
+	value = ((chunk & 0x0000FFFF0000FFFFull) * 42949672960001ull) >> 32;
+	return true;
+}
+
+// Digits accumulated into mantissa, returns how many were read
+static int ParseDigits(const char *& p, const char * end, uint64_t & mantissa, int & dropped)
+{
+	int count = 0;
+
+	// bulk path while the mantissa has room for eight more digits
+	uint64_t eight;
+	while(end - p >= 8 && mantissa < 10000000000ull && ParseEightDigits(p, eight))
+	{
+		mantissa = mantissa * 100000000ull + eight;
+		p += 8;
+		count += 8;
+	}
+
+	for(; p < end && *p >= '0' && *p <= '9'; ++p, ++count)
+	{
+		if(mantissa < 1000000000000000000ull)
+		{
+			mantissa = mantissa * 10 + uint64_t(*p - '0');
+		}
+		else
+		{
+			++dropped;
+		}
+	}
+
+	return count;
+}
+
+static float ParseFloat(const char *& p, const char * end)
+{
+	p = SkipSpaces(p, end);
+	const char * start = p;
+
+	bool negative = false;
+	if(p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		++p;
+	}
+
+	uint64_t mantissa = 0;
+	int dropped = 0;
+	int digits = ParseDigits(p, end, mantissa, dropped);
+	int exponent = dropped;
+
+	if(p < end && *p == '.')
+	{
+		++p;
+		int fractionDropped = 0;
+		const int fraction = ParseDigits(p, end, mantissa, fractionDropped);
+		digits += fraction;
+		exponent -= fraction - fractionDropped;
+	}
+
+	if(digits == 0)
+	{
+		throw std::runtime_error("Malformed ASCII STL: expected a number");
+	}
+
+	if(p < end && (*p == 'e' || *p == 'E'))
+	{
+		++p;
+		bool negativeExponent = false;
+		if(p < end && (*p == '-' || *p == '+'))
+		{
+			negativeExponent = *p == '-';
+			++p;
+		}
+
+		int e = 0;
+		for(; p < end && *p >= '0' && *p <= '9'; ++p)
+		{
+			e = e < 10000 ? e * 10 + (*p - '0') : e;
+		}
+		exponent += negativeExponent ? -e : e;
+	}
+
+	// exporters pad with zeros ("3.500000e+01"): drop them while no digit
+	// was lost, so more numbers fit the fast path
+	while(mantissa >= (1ull << 24) && mantissa < 1000000000000000000ull && mantissa % 10 == 0)
+	{
+		mantissa /= 10;
+		++exponent;
+	}
+
+	// exact powers of ten representable as floats
+	static const float powers[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+	// fast path (Clinger): both operands exact floats, so a single rounding
+	// straight to float. Going through double would round twice.
+	if(mantissa < (1ull << 24) && exponent >= -10 && exponent <= 10)
+	{
+		float value = float(mantissa);
+		value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+		return negative ? -value : value;
+	}
+
+	// rare long or extreme numbers go through the C library
+	return std::strtof(std::string(start, p).c_str(), nullptr);
+}
+
+static glm::vec3 ParseVertex(const char *& p, const char * end)
+{
+	ExpectKeyword(p, end, "vertex");
+	glm::vec3 v;
+	v.x = ParseFloat(p, end);
+	v.y = ParseFloat(p, end);
+	v.z = ParseFloat(p, end);
+	return v;
+}
+
+static void SkipLine(const char *& p, const char * end)
+{
+	while(p < end && *p != '\n')
+	{
+		++p;
+	}
+}
+
+// Parses every facet starting before `limit`, returns where it stopped
+static const char * ParseFacets(const char * p, const char * limit, const char * end, std::vector<Triangle> & tris)
+{
+	for(;;)
+	{
+		p = SkipSpaces(p, end);
+		if(p >= limit || !MatchKeyword(p, end, "facet"))
+		{
+			return p;
+		}
+
+		// normals are recomputed from the vertices, like the binary path
+		ExpectKeyword(p, end, "normal");
+		ParseFloat(p, end);
+		ParseFloat(p, end);
+		ParseFloat(p, end);
+
+		ExpectKeyword(p, end, "outer");
+		ExpectKeyword(p, end, "loop");
+
+		Triangle t;
+		t.p0 = ParseVertex(p, end);
+		t.p1 = ParseVertex(p, end);
+		t.p2 = ParseVertex(p, end);
+		tris.push_back(t);
+
+		ExpectKeyword(p, end, "endloop");
+		ExpectKeyword(p, end, "endfacet");
+	}
+}
+
+// First position after an "endfacet" at or after p, or end
+static const char * NextFacetBoundary(const char * p, const char * end)
+{
+	static const char keyword[] = "endfacet";
+	const std::size_t n = sizeof(keyword) - 1;
+
+	while(end - p >= std::ptrdiff_t(n))
+	{
+		const void * found = std::memchr(p, 'e', std::size_t(end - p - n + 1));
+		if(!found)
+		{
+			break;
+		}
+		p = static_cast<const char *>(found);
+		if(std::memcmp(p, keyword, n) == 0)
+		{
+			return p + n;
+		}
+		++p;
+	}
+	return end;
+}
+
+std::vector<Triangle> ParseAsciiStl(const char * begin, const char * end, ThreadPool * pool)
+{
+	const char * p = begin;
+	ExpectKeyword(p, end, "solid");
+	SkipLine(p, end);
+
+	// split the text in roughly equal slices, each one cut just after an "endfacet"
+	const std::size_t sliceSize = 4 * 1024 * 1024;
+	std::vector<const char *> starts = {p};
+	while(pool && std::size_t(end - starts.back()) > sliceSize)
+	{
+		starts.push_back(NextFacetBoundary(starts.back() + sliceSize, end));
+	}
+	starts.push_back(end);
+
+	const std::size_t slices = starts.size() - 1;
+	std::vector<std::vector<Triangle>> parts(slices);
+	std::vector<const char *> stops(slices);
+
+	const auto parse = [&](std::size_t first, std::size_t last) {
+		for(std::size_t i = first; i < last; ++i)
+		{
+			stops[i] = ParseFacets(starts[i], starts[i + 1], end, parts[i]);
+		}
+	};
+
+	if(pool)
+	{
+		pool->ParallelFor(slices, 1, parse);
+	}
+	else
+	{
+		parse(0, slices);
+	}
+
+	// a slice stopping early hit something that is not a facet
+	for(std::size_t i = 0; i + 1 < slices; ++i)
+	{
+		if(stops[i] < starts[i + 1])
+		{
+			throw std::runtime_error("Malformed ASCII STL: expected 'facet'");
+		}
+	}
+	ExpectKeyword(stops.back(), end, "endsolid");
+
+	std::size_t total = 0;
+	for(const auto & part : parts)
+	{
+		total += part.size();
+	}
+
+	std::vector<Triangle> tris;
+	tris.reserve(total);
+	for(const auto & part : parts)
+	{
+		tris.insert(tris.end(), part.begin(), part.end());
+	}
+
+	return tris;
+}
+
+std::vector<Triangle> ReadStlMapped(const char * filename, ThreadPool * pool)
+{
+	const MappedFile file(filename);
+	const unsigned char * data = file.Data();
+	const std::size_t size = file.Size();
+
+	// binary files may also start with "solid", the size is the reliable hint
+	if(size >= headerSize)
+	{
+		uint32_t triCount;
+		std::memcpy(&triCount, data + 80, 4);
+		if(size == headerSize + std::size_t(triCount) * recordSize)
+		{
+			return ParseBinaryStl(data, size, pool);
+		}
+	}
+
+	const char * text = reinterpret_cast<const char *>(data);
+	const char * p = SkipSpaces(text, text + size);
+	if(MatchKeyword(p, text + size, "solid"))
+	{
+		return ParseAsciiStl(text, text + size, pool);
+	}
+
+	// neither valid ASCII nor a binary file of the right size
+	return ParseBinaryStl(data, size, pool);
+}
@@ -2,11 +2,22 @@
 
 #include <glm/vec3.hpp>
 
+#include <cstddef>
 #include <vector>
 
+class ThreadPool;
+
 struct Triangle
 {
 	glm::vec3 p0, p1, p2;
 };
 
 std::vector<Triangle> ReadStl(const char * filename);
+
+// Memory-mapped loader for binary and ASCII STL. The binary header and the
+// file size are checked against the triangle count; records are decoded in
+// parallel when a pool is given.
+std::vector<Triangle> ReadStlMapped(const char * filename, ThreadPool * pool = nullptr);
+
+std::vector<Triangle> ParseBinaryStl(const unsigned char * data, std::size_t size, ThreadPool * pool = nullptr);
+std::vector<Triangle> ParseAsciiStl(const char * begin, const char * end, ThreadPool * pool = nullptr);
@@ -0,0 +1,76 @@
+#include "stream_buffer.h"
+#include "profiler.h"
+
+#include <chrono>
+#include <stdexcept>
+
+StreamBuffer::StreamBuffer(std::size_t regionSize, unsigned regionCount)
+	: regionSize(regionSize), regionCount(regionCount), current(0), fences()
+{
+	if(regionCount == 0 || regionCount > sizeof(fences) / sizeof(fences[0]))
+	{
+		throw std::runtime_error("StreamBuffer: between 1 and 8 regions");
+	}
+
+	// coherent: writes are visible to the GPU without any explicit flush
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glCreateBuffers(1, &buffer);
+	glNamedBufferStorage(buffer, GLsizeiptr(regionSize * regionCount), nullptr, flags);
+	mapped = static_cast<unsigned char *>(glMapNamedBufferRange(buffer, 0, GLsizeiptr(regionSize * regionCount), flags));
+	if(!mapped)
+	{
+		glDeleteBuffers(1, &buffer);
+		throw std::runtime_error("StreamBuffer: persistent mapping failed");
+	}
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	for(GLsync fence : fences)
+	{
+		if(fence)
+		{
+			glDeleteSync(fence);
+		}
+	}
+	glUnmapNamedBuffer(buffer);
+	glDeleteBuffers(1, &buffer);
+}
+
+void *StreamBuffer::Map()
+{
+	GLsync &fence = fences[current];
+	if(fence)
+	{
+		// a non-zero wait only when the CPU is regionCount frames ahead
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		if(status == GL_TIMEOUT_EXPIRED)
+		{
+			PROFILE_ZONE("StreamBuffer stall");
+			const auto start = std::chrono::steady_clock::now();
+			do
+			{
+				status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			}
+			while(status == GL_TIMEOUT_EXPIRED);
+
+			++stats.stalls;
+			stats.stallMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	return mapped + current * regionSize;
+}
+
+void StreamBuffer::Unmap(std::size_t bytesWritten)
+{
+	fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	current = (current + 1) % regionCount;
+
+	++stats.frames;
+	stats.bytes += bytesWritten;
+	AddProfileCounter(ProfileCounter::BytesUploaded, bytesWritten);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+
+struct StreamBufferStats
+{
+	uint64_t frames = 0;
+	// regions the GPU was still reading when the CPU wanted to write them
+	uint64_t stalls = 0;
+	double stallMilliseconds = 0.0;
+	uint64_t bytes = 0;
+
+	double BytesPerFrame() const { return frames ? double(bytes) / double(frames) : 0.0; }
+};
+
+// Per-frame uploads through a persistently mapped ring of `regionCount`
+// regions (triple buffering by default). The CPU writes a region while the
+// GPU reads the previous ones; a fence per region guards against
+// overwriting data still in flight, so there is neither a copy through the
+// driver nor a re-specified buffer.
+// Every method must be called from the thread owning the GL context, but
+// the pointer returned by Map can be written by any thread until Unmap.
+class StreamBuffer
+{
+public:
+	explicit StreamBuffer(std::size_t regionSize, unsigned regionCount = 3);
+	~StreamBuffer();
+
+	StreamBuffer(const StreamBuffer &) = delete;
+	StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+	// Waits until the GPU is done with the next region and returns it
+	void *Map();
+	// Fences the region once the draws reading it are issued and moves on.
+	// `bytesWritten` only feeds the statistics.
+	void Unmap(std::size_t bytesWritten);
+
+	GLuint Buffer() const { return buffer; }
+	// Where the region returned by Map starts in Buffer(), until Unmap
+	GLintptr Offset() const { return GLintptr(current * regionSize); }
+	std::size_t RegionSize() const { return regionSize; }
+
+	const StreamBufferStats &Stats() const { return stats; }
+
+private:
+	GLuint buffer;
+	unsigned char *mapped;
+	std::size_t regionSize;
+	unsigned regionCount;
+	unsigned current;
+	GLsync fences[8];
+
+	StreamBufferStats stats;
+};
@@ -1,19 +1,60 @@
 #include<iostream>
 #include<string>
+#include<stdexcept>
 
 #include "texture.h"
 
-//Image LoadImage(const char *filename)
-//{
-//	int width, height, nbComponents;
-//	unsigned char* picture = stbi_load(filename, &width, &height, &nbComponents, 0);
-//
-//	if (!picture)
-//	{
-//		stbi_image_free(picture);
-//		throw std::runtime_error("File not found: " + std::string(filename));
-//		exit(EXIT_FAILURE);
-//	}
-//
-//	return { picture, width, height };
-//}
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+void ImageDeleter::operator()(unsigned char *data) const
+{
+	stbi_image_free(data);
+}
+
+Image LoadImage(const char *filename)
+{
+	int width, height, nbComponents;
+	unsigned char* picture = stbi_load(filename, &width, &height, &nbComponents, 0);
+
+	if (!picture)
+	{
+		throw std::runtime_error("Cannot load image: " + std::string(filename) + " (" + stbi_failure_reason() + ")");
+	}
+
+	return { std::unique_ptr<unsigned char, ImageDeleter>(picture), width, height, nbComponents };
+}
+
+Image AllocateImage(int width, int height, int channels)
+{
+	unsigned char* pixels = static_cast<unsigned char*>(STBI_MALLOC(std::size_t(width) * height * channels));
+
+	if (!pixels)
+	{
+		throw std::runtime_error("Cannot allocate a " + std::to_string(width) + "x" + std::to_string(height) + " image");
+	}
+
+	return { std::unique_ptr<unsigned char, ImageDeleter>(pixels), width, height, channels };
+}
+
+GLuint MakeTexture(const Image &im)
+{
+	static const GLenum internalFormats[] = {GL_R8, GL_RG8, GL_RGB8, GL_RGBA8};
+	static const GLenum formats[] = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+
+	if (im.channels < 1 || im.channels > 4)
+	{
+		throw std::runtime_error("Unsupported channel count: " + std::to_string(im.channels));
+	}
+
+	GLuint tex;
+	glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+	glTextureStorage2D(tex, 1, internalFormats[im.channels - 1], im.width, im.height);
+
+	// rows of RGB images are not 4-byte aligned in general
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTextureSubImage2D(tex, 0, 0, 0, im.width, im.height, formats[im.channels - 1], GL_UNSIGNED_BYTE, im.data.get());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	return tex;
+}
@@ -1,12 +1,28 @@
 #pragma once
+
+#include <glad/glad.h>
+
+#include <memory>
 #include <vector>
 #include <tuple>
 
+// Releases pixels allocated by stb_image
+struct ImageDeleter
+{
+	void operator()(unsigned char *data) const;
+};
+
 struct Image
 {
-	//std::vector<unsigned char> data;
-	unsigned char* data;
-	int width, height;
+	std::unique_ptr<unsigned char, ImageDeleter> data;
+	int width, height, channels;
 };
 
-//Image LoadImage(const char *filename);
+// Decodes any format stb_image knows, throws if the file cannot be read
+Image LoadImage(const char *filename);
+
+// Uninitialized pixels, released like decoded ones
+Image AllocateImage(int width, int height, int channels);
+
+// Immutable single level texture holding the image, in the matching GL format
+GLuint MakeTexture(const Image &im);
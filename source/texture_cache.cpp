@@ -0,0 +1,258 @@
+#include "texture_cache.h"
+#include "bc.h"
+#include "mipmap.h"
+#include "profiler.h"
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+// S3TC is an extension, glad only knows the core enums
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+using namespace TextureCacheFormat;
+
+static const uint64_t levelAlignment = 64;
+
+const char *TextureEncodingName(TextureEncoding encoding)
+{
+	switch(encoding)
+	{
+	case TextureEncoding::BC1: return "BC1";
+	case TextureEncoding::BC7: return "BC7";
+	default: return "RGBA8";
+	}
+}
+
+static std::size_t EncodedSize(TextureEncoding encoding, uint32_t width, uint32_t height)
+{
+	switch(encoding)
+	{
+	case TextureEncoding::BC1: return CompressedSize(BlockFormat::BC1, int(width), int(height));
+	case TextureEncoding::BC7: return CompressedSize(BlockFormat::BC7, int(width), int(height));
+	default: return std::size_t(width) * height * 4;
+	}
+}
+
+EncodedTexture EncodeTexture(const Image &image, const TextureOptions &options, ThreadPool *pool)
+{
+	std::vector<MipLevel> chain = GenerateMipChain(image, options.srgb);
+
+	EncodedTexture texture;
+	texture.encoding = options.encoding;
+	texture.srgb = options.srgb;
+	texture.levels.reserve(chain.size());
+
+	for(auto &level : chain)
+	{
+		EncodedLevel encoded = {level.width, level.height, {}};
+		switch(options.encoding)
+		{
+		case TextureEncoding::BC1: encoded.data = CompressImage(level.rgba.data(), level.width, level.height, BlockFormat::BC1, pool); break;
+		case TextureEncoding::BC7: encoded.data = CompressImage(level.rgba.data(), level.width, level.height, BlockFormat::BC7, pool); break;
+		default: encoded.data = std::move(level.rgba); break;
+		}
+		texture.levels.push_back(std::move(encoded));
+	}
+
+	return texture;
+}
+
+TextureCache::TextureCache(const char *filename)
+	: file(filename), header(nullptr)
+{
+	const std::string name(filename);
+	if(file.Size() < sizeof(Header) || std::memcmp(file.Data(), magic, sizeof(magic)) != 0)
+	{
+		throw std::runtime_error("Not a texture cache: " + name);
+	}
+
+	header = reinterpret_cast<const Header *>(file.Data());
+	if(header->version != version || header->headerSize != sizeof(Header))
+	{
+		throw std::runtime_error("Texture cache version mismatch: " + name);
+	}
+
+	if(header->encoding > uint32_t(TextureEncoding::BC7) || header->levelCount == 0 || header->levelCount > maxLevels)
+	{
+		throw std::runtime_error("Corrupt texture cache: " + name);
+	}
+
+	for(uint32_t l = 0; l < header->levelCount; ++l)
+	{
+		const auto &level = header->levels[l];
+		if(level.size != EncodedSize(Encoding(), level.width, level.height) || level.offset % levelAlignment != 0
+				|| level.offset > file.Size() || level.size > file.Size() - level.offset)
+		{
+			throw std::runtime_error("Truncated texture cache: " + name);
+		}
+	}
+}
+
+std::size_t TextureCache::DataSize() const
+{
+	std::size_t size = 0;
+	for(uint32_t l = 0; l < LevelCount(); ++l)
+	{
+		size += LevelSize(l);
+	}
+	return size;
+}
+
+bool TextureCache::IsUpToDate(const char *sourcePath) const
+{
+	return CompareSource(sourcePath) != FileMatch::Different;
+}
+
+FileMatch TextureCache::CompareSource(const char *sourcePath, FileIdentity *current) const
+{
+	return CompareFile({header->sourceSize, header->sourceTime, header->sourceHash}, sourcePath, current);
+}
+
+void WriteTextureCache(const char *cachePath, const EncodedTexture &texture, const char *sourcePath)
+{
+	if(texture.levels.empty() || texture.levels.size() > maxLevels)
+	{
+		throw std::runtime_error("Texture cache holds 1 to " + std::to_string(maxLevels) + " levels");
+	}
+
+	Header header = {};
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.headerSize = sizeof(Header);
+
+	const FileIdentity source = IdentifyFile(sourcePath);
+	header.sourceSize = source.size;
+	header.sourceTime = source.time;
+	header.sourceHash = source.hash;
+
+	header.encoding = uint32_t(texture.encoding);
+	header.srgb = texture.srgb ? 1 : 0;
+	header.levelCount = uint32_t(texture.levels.size());
+
+	uint64_t offset = sizeof(Header);
+	for(std::size_t l = 0; l < texture.levels.size(); ++l)
+	{
+		const auto &level = texture.levels[l];
+		offset = (offset + levelAlignment - 1) / levelAlignment * levelAlignment;
+		header.levels[l] = {offset, level.data.size(), uint32_t(level.width), uint32_t(level.height)};
+		offset += level.data.size();
+	}
+
+	std::vector<FileRange> ranges;
+	for(std::size_t l = 0; l < texture.levels.size(); ++l)
+	{
+		ranges.push_back({header.levels[l].offset, texture.levels[l].data.data(), texture.levels[l].data.size()});
+	}
+	WriteFileAside(cachePath, &header, sizeof(header), ranges);
+}
+
+std::string TextureCachePath(const char *sourcePath)
+{
+	return std::string(sourcePath) + ".texcache";
+}
+
+std::unique_ptr<TextureCache> LoadTextureCached(const char *sourcePath, const TextureOptions &options,
+		const std::string &cachePath, ThreadPool *pool)
+{
+	const std::string path = cachePath.empty() ? TextureCachePath(sourcePath) : cachePath;
+
+	if(std::filesystem::exists(path))
+	{
+		try
+		{
+			std::unique_ptr<TextureCache> cache(new TextureCache(path.c_str()));
+			FileIdentity current;
+			const FileMatch match = cache->Encoding() == options.encoding && cache->IsSrgb() == options.srgb
+					? cache->CompareSource(sourcePath, &current) : FileMatch::Different;
+			if(match == FileMatch::Touched)
+			{
+				// unmapped while its header is patched
+				cache.reset();
+				RewriteRecordedTime(path.c_str(), offsetof(Header, sourceTime), current.time);
+				cache.reset(new TextureCache(path.c_str()));
+			}
+			if(match != FileMatch::Different)
+			{
+				return cache;
+			}
+		}
+		catch(const std::runtime_error &)
+		{
+			// corrupt or from another version: rebuilt below
+		}
+	}
+
+	WriteTextureCache(path.c_str(), EncodeTexture(LoadImage(sourcePath), options, pool), sourcePath);
+	return std::unique_ptr<TextureCache>(new TextureCache(path.c_str()));
+}
+
+static bool HasGlExtension(const char *name)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for(GLint i = 0; i < count; ++i)
+	{
+		if(std::strcmp(reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, GLuint(i))), name) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+GLuint MakeTexture(const TextureCache &cache)
+{
+	PROFILE_ZONE("MakeTexture");
+	static const bool hasS3tc = HasGlExtension("GL_EXT_texture_compression_s3tc");
+
+	// sRGB levels are sampled as stored, like every other colour of the frame
+	const bool decodeBc1 = cache.Encoding() == TextureEncoding::BC1 && !hasS3tc;
+
+	GLenum internalFormat = GL_RGBA8;
+	if(cache.Encoding() == TextureEncoding::BC1 && !decodeBc1)
+	{
+		internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	}
+	else if(cache.Encoding() == TextureEncoding::BC7)
+	{
+		internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+	}
+
+	const GLsizei levels = GLsizei(cache.LevelCount());
+
+	GLuint tex;
+	glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+	glTextureStorage2D(tex, levels, internalFormat, GLsizei(cache.Width()), GLsizei(cache.Height()));
+
+	for(GLsizei l = 0; l < levels; ++l)
+	{
+		const GLsizei w = GLsizei(cache.Width(l));
+		const GLsizei h = GLsizei(cache.Height(l));
+
+		if(decodeBc1)
+		{
+			const auto rgba = DecompressImage(cache.LevelData(l), w, h, BlockFormat::BC1);
+			glTextureSubImage2D(tex, l, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+			AddProfileCounter(ProfileCounter::BytesUploaded, rgba.size());
+		}
+		else if(cache.Encoding() == TextureEncoding::RGBA8)
+		{
+			glTextureSubImage2D(tex, l, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, cache.LevelData(l));
+			AddProfileCounter(ProfileCounter::BytesUploaded, cache.LevelSize(l));
+		}
+		else
+		{
+			glCompressedTextureSubImage2D(tex, l, 0, 0, w, h, internalFormat, GLsizei(cache.LevelSize(l)), cache.LevelData(l));
+			AddProfileCounter(ProfileCounter::BytesUploaded, cache.LevelSize(l));
+		}
+	}
+
+	glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	return tex;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "file_identity.h"
+#include "mapped_file.h"
+#include "texture.h"
+
+class ThreadPool;
+
+enum class TextureEncoding : uint32_t
+{
+	RGBA8,
+	BC1,
+	BC7
+};
+
+const char *TextureEncodingName(TextureEncoding encoding);
+
+struct TextureOptions
+{
+	TextureEncoding encoding = TextureEncoding::BC7;
+	// colour data: mips filtered in linear space, the levels stay sRGB encoded
+	bool srgb = true;
+};
+
+// On-disk layout of a preprocessed texture, in the spirit of KTX2: a level
+// index then every mip level, largest first, ready for glCompressedTextureSubImage2D.
+// Levels start on 64-byte boundaries.
+namespace TextureCacheFormat
+{
+	const char magic[8] = {'G', 'G', 'L', 'T', 'E', 'X', '\0', '\0'};
+	const uint32_t version = 1;
+	const uint32_t maxLevels = 16;
+
+	struct LevelEntry
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+
+		// source identity, checked like the mesh cache
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		uint64_t sourceHash;
+
+		uint32_t encoding;
+		uint32_t srgb;
+		uint32_t levelCount;
+		uint32_t reserved;
+
+		LevelEntry levels[maxLevels];
+	};
+}
+
+struct EncodedLevel
+{
+	int width, height;
+	std::vector<unsigned char> data;
+};
+
+// Mip chain in its final GPU encoding
+struct EncodedTexture
+{
+	TextureEncoding encoding;
+	bool srgb;
+	std::vector<EncodedLevel> levels;
+};
+
+// Generates the mip chain and compresses every level, blocks spread over `pool`
+EncodedTexture EncodeTexture(const Image &image, const TextureOptions &options, ThreadPool *pool = nullptr);
+
+// Read-only view of a texture cache file, the levels point into the mapping
+class TextureCache
+{
+public:
+	// Maps and validates the file, throws if it is not a usable cache
+	explicit TextureCache(const char *filename);
+
+	TextureEncoding Encoding() const { return TextureEncoding(header->encoding); }
+	bool IsSrgb() const { return header->srgb != 0; }
+	uint32_t LevelCount() const { return header->levelCount; }
+	uint32_t Width(uint32_t level = 0) const { return header->levels[level].width; }
+	uint32_t Height(uint32_t level = 0) const { return header->levels[level].height; }
+	const unsigned char *LevelData(uint32_t level) const { return file.Data() + header->levels[level].offset; }
+	std::size_t LevelSize(uint32_t level) const { return std::size_t(header->levels[level].size); }
+
+	// Bytes of every level together: what MakeTexture uploads
+	std::size_t DataSize() const;
+
+	// Whether `sourcePath` is still the file this cache was built from
+	bool IsUpToDate(const char *sourcePath) const;
+	FileMatch CompareSource(const char *sourcePath, FileIdentity *current = nullptr) const;
+
+private:
+	MappedFile file;
+	const TextureCacheFormat::Header *header;
+};
+
+void WriteTextureCache(const char *cachePath, const EncodedTexture &texture, const char *sourcePath);
+
+// Default cache location: next to the source, with a .texcache suffix
+std::string TextureCachePath(const char *sourcePath);
+
+// Opens the cache of `sourcePath`, (re)building it first when missing, stale
+// or encoded with other options
+std::unique_ptr<TextureCache> LoadTextureCached(const char *sourcePath, const TextureOptions &options = TextureOptions(),
+		const std::string &cachePath = std::string(), ThreadPool *pool = nullptr);
+
+// Immutable texture with every level of the cache and trilinear filtering.
+// BC1 is decoded to RGBA8 when the driver lacks EXT_texture_compression_s3tc.
+GLuint MakeTexture(const TextureCache &cache);
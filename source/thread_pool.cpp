@@ -0,0 +1,199 @@
+#include "thread_pool.h"
+#include "profiler.h"
+
+#include <exception>
+#include <string>
+
+// Queue owned by the current thread, only meaningful inside a pool worker
+static thread_local const ThreadPool *currentPool = nullptr;
+static thread_local unsigned currentQueue = 0;
+
+ThreadPool::ThreadPool(unsigned threadCount)
+	: pending(0), stop(false)
+{
+	if(threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+	}
+	if(threadCount == 0)
+	{
+		threadCount = 1;
+	}
+
+	// queue 0 is shared by the threads outside the pool
+	for(unsigned i = 0; i < threadCount; ++i)
+	{
+		queues.emplace_back(new Queue);
+	}
+
+	for(unsigned i = 1; i < threadCount; ++i)
+	{
+		workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stop = true;
+	}
+	wake.notify_all();
+
+	for(auto &worker : workers)
+	{
+		worker.join();
+	}
+}
+
+unsigned ThreadPool::CurrentQueue() const
+{
+	return currentPool == this ? currentQueue : 0;
+}
+
+void ThreadPool::Push(unsigned queue, std::function<void()> task)
+{
+	// counted before it is visible so a thief never drops pending below zero
+	pending.fetch_add(1);
+	{
+		std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+		queues[queue]->tasks.push_back(std::move(task));
+	}
+
+	{
+		// pairs with the predicate check in WorkerLoop so no wake up is lost
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wake.notify_one();
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	// nothing would drain the queue: ParallelFor only runs its own chunks
+	if(workers.empty())
+	{
+		task();
+		return;
+	}
+	Push(CurrentQueue(), std::move(task));
+}
+
+bool ThreadPool::TryRunOne(unsigned self)
+{
+	std::function<void()> task;
+
+	{
+		// own queue, newest first: its data is most likely still in cache
+		auto &own = *queues[self];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if(!own.tasks.empty())
+		{
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+		}
+	}
+
+	for(unsigned i = 1; !task && i < queues.size(); ++i)
+	{
+		// steal the oldest task of another thread
+		auto &victim = *queues[(self + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if(!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+		}
+	}
+
+	if(!task)
+	{
+		return false;
+	}
+
+	pending.fetch_sub(1);
+	task();
+	return true;
+}
+
+void ThreadPool::WorkerLoop(unsigned self)
+{
+	currentPool = this;
+	currentQueue = self;
+	SetProfilerThreadName("worker " + std::to_string(self));
+
+	for(;;)
+	{
+		if(TryRunOne(self))
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wake.wait(lock, [this] { return stop || pending.load() > 0; });
+		if(stop)
+		{
+			return;
+		}
+	}
+}
+
+void ThreadPool::ParallelFor(std::size_t count, std::size_t grain, const std::function<void(std::size_t, std::size_t)> &body)
+{
+	if(grain == 0)
+	{
+		grain = 1;
+	}
+
+	const std::size_t chunks = (count + grain - 1) / grain;
+	if(chunks <= 1 || queues.size() == 1)
+	{
+		if(count > 0)
+		{
+			body(0, count);
+		}
+		return;
+	}
+
+	std::atomic<std::size_t> remaining(chunks);
+	const unsigned self = CurrentQueue();
+
+	// the first exception thrown by a chunk is rethrown to the caller
+	std::mutex errorMutex;
+	std::exception_ptr error;
+
+	// spread the chunks over every queue so the workers start without stealing
+	for(std::size_t c = 0; c < chunks; ++c)
+	{
+		const std::size_t begin = c * grain;
+		const std::size_t end = begin + grain < count ? begin + grain : count;
+
+		Push(unsigned((self + c) % queues.size()), [&body, &remaining, &errorMutex, &error, begin, end] {
+			try
+			{
+				body(begin, end);
+			}
+			catch(...)
+			{
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if(!error)
+				{
+					error = std::current_exception();
+				}
+			}
+			remaining.fetch_sub(1);
+		});
+	}
+
+	while(remaining.load() > 0)
+	{
+		if(!TryRunOne(self))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	if(error)
+	{
+		std::rethrow_exception(error);
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool: every thread owns a task queue, pops its own
+// tasks from the back and steals from the front of the others when idle.
+// The thread calling ParallelFor takes part in the work.
+class ThreadPool
+{
+public:
+	// threadCount includes the calling thread, 0 means one per core
+	explicit ThreadPool(unsigned threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	unsigned ThreadCount() const { return unsigned(queues.size()); }
+
+	// Runs the task on a worker, or right away when there is none
+	void Submit(std::function<void()> task);
+
+	// Runs body(begin, end) over [0, count) in chunks of `grain` items and
+	// returns once every chunk is done, rethrowing the first exception
+	void ParallelFor(std::size_t count, std::size_t grain, const std::function<void(std::size_t, std::size_t)> &body);
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	void Push(unsigned queue, std::function<void()> task);
+	bool TryRunOne(unsigned self);
+	void WorkerLoop(unsigned self);
+	unsigned CurrentQueue() const;
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<std::size_t> pending;
+	bool stop;
+};
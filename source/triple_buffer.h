@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+
+// Lock-free single-producer single-consumer triple buffer: the writer fills
+// the back slot and publishes it, the reader always gets the latest
+// published slot. Neither side ever waits; the reader skips snapshots it was
+// too slow to see, and keeps the same one while nothing new was published.
+template<typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() = default;
+
+	TripleBuffer(const TripleBuffer &) = delete;
+	TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+	// Writer thread: the slot to fill, owned until Publish
+	T &Back() { return slots[back]; }
+
+	// Writer thread: hands the back slot over, gets a free one in exchange
+	void Publish()
+	{
+		back = middle.exchange(back | dirty, std::memory_order_acq_rel) & indexMask;
+	}
+
+	// Reader thread: the latest published slot, valid until the next call
+	const T &Read()
+	{
+		if(middle.load(std::memory_order_relaxed) & dirty)
+		{
+			front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+		}
+		return slots[front];
+	}
+
+private:
+	static const unsigned dirty = 4;
+	static const unsigned indexMask = 3;
+
+	T slots[3] = {};
+	// the slot between the two sides, with the dirty bit when not read yet
+	std::atomic<unsigned> middle{1};
+	unsigned back = 0;
+	unsigned front = 2;
+};
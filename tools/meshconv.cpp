@@ -0,0 +1,75 @@
+// Offline converter: builds the .meshcache of an STL or PLY model so the
+// application maps it at startup instead of parsing the source.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+
+#include "mesh_cache.h"
+
+static void Usage()
+{
+	std::fprintf(stderr,
+			"usage: meshconv [--epsilon e] [--faceted] input.{stl,ply} [output.meshcache]\n"
+			"  --epsilon e   weld vertices closer than e (default 1e-5)\n"
+			"  --faceted     split vertices at creases instead of smoothing normals\n");
+}
+
+int main(int argc, char **argv)
+{
+	MeshOptions options;
+	const char *input = nullptr;
+	const char *output = nullptr;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "--epsilon") == 0 && i + 1 < argc)
+		{
+			options.epsilon = float(std::atof(argv[++i]));
+		}
+		else if(std::strcmp(argv[i], "--faceted") == 0)
+		{
+			options.normals = NormalMode::Faceted;
+		}
+		else if(!input)
+		{
+			input = argv[i];
+		}
+		else if(!output)
+		{
+			output = argv[i];
+		}
+		else
+		{
+			Usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if(!input)
+	{
+		Usage();
+		return EXIT_FAILURE;
+	}
+
+	const std::string cachePath = output ? std::string(output) : MeshCachePath(input);
+
+	try
+	{
+		const Mesh mesh = LoadSourceMesh(input, options);
+		WriteMeshCache(cachePath.c_str(), mesh, input, options);
+
+		const MeshCache cache(cachePath.c_str());
+		std::printf("%s -> %s: %u vertices, %u indices, ACMR %.3f\n", input, cachePath.c_str(),
+				cache.VertexCount(), cache.IndexCount(),
+				ComputeAcmr(mesh.indices, mesh.positions.size()));
+	}
+	catch(const std::exception &e)
+	{
+		std::fprintf(stderr, "meshconv: %s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,87 @@
+// Offline converter: builds the .texcache of an image (mip chain, block
+// compressed) so the application maps and uploads it at startup.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+
+#include "texture_cache.h"
+#include "thread_pool.h"
+
+static void Usage()
+{
+	std::fprintf(stderr,
+			"usage: texconv [--bc1 | --bc7 | --rgba8] [--linear] input [output.texcache]\n"
+			"  --bc1         opaque 4 bpp block compression\n"
+			"  --bc7         RGBA 8 bpp block compression (default)\n"
+			"  --rgba8       uncompressed mip chain\n"
+			"  --linear      data texture: no sRGB decoding when filtering mips\n");
+}
+
+int main(int argc, char **argv)
+{
+	TextureOptions options;
+	const char *input = nullptr;
+	const char *output = nullptr;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "--bc1") == 0)
+		{
+			options.encoding = TextureEncoding::BC1;
+		}
+		else if(std::strcmp(argv[i], "--bc7") == 0)
+		{
+			options.encoding = TextureEncoding::BC7;
+		}
+		else if(std::strcmp(argv[i], "--rgba8") == 0)
+		{
+			options.encoding = TextureEncoding::RGBA8;
+		}
+		else if(std::strcmp(argv[i], "--linear") == 0)
+		{
+			options.srgb = false;
+		}
+		else if(!input)
+		{
+			input = argv[i];
+		}
+		else if(!output)
+		{
+			output = argv[i];
+		}
+		else
+		{
+			Usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if(!input)
+	{
+		Usage();
+		return EXIT_FAILURE;
+	}
+
+	const std::string cachePath = output ? std::string(output) : TextureCachePath(input);
+
+	try
+	{
+		ThreadPool pool;
+		const Image image = LoadImage(input);
+		WriteTextureCache(cachePath.c_str(), EncodeTexture(image, options, &pool), input);
+
+		const TextureCache cache(cachePath.c_str());
+		std::printf("%s -> %s: %ux%u %s%s, %u levels, %zu bytes (RGB8 level 0: %zu bytes)\n", input, cachePath.c_str(),
+				cache.Width(), cache.Height(), TextureEncodingName(cache.Encoding()), cache.IsSrgb() ? " sRGB" : "",
+				cache.LevelCount(), cache.DataSize(), std::size_t(image.width) * image.height * 3);
+	}
+	catch(const std::exception &e)
+	{
+		std::fprintf(stderr, "texconv: %s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}